@@ -0,0 +1,137 @@
+/* Decoder comparison benchmark
+ *
+ * Streams the same data through a sender and a receiver connection for
+ * the batch and the incremental decoder, dropping frames at random, and
+ * prints the decode latency percentiles of each run. Every frame is
+ * spaced 10 us apart on the simulated clock, so latency_* is in simulated
+ * time while completion_* is the wall clock spent on the symbol that
+ * completed a generation, i.e. the spike the batch decoder adds.
+ *
+ * cargo run --release --example decode_bench [loss percent]
+*/
+
+use helix_rs::*;
+
+const DECODERS: [(u32, &str); 2] = [(0, "incremental"), (1, "batch")];
+const GENERATION_SIZES: [u32; 3] = [16, 64, 255];
+const BYTES: usize = 8 << 20;
+const FRAME_SPACING_NS: u64 = 10_000;
+
+fn to_buffer(data: &[u8]) -> FFISharedBuffer {
+    let mut b = helix_rs_buffer_acquire(data.len());
+    b.as_mut_slice().copy_from_slice(data);
+    b
+}
+
+/* Drop frames with probability loss/100, xorshift so runs are repeatable */
+struct Channel {
+    state: u64,
+    loss: u64,
+}
+
+impl Channel {
+    fn drops(&mut self) -> bool {
+        self.state ^= self.state << 13;
+        self.state ^= self.state >> 7;
+        self.state ^= self.state << 17;
+        self.state % 100 < self.loss
+    }
+}
+
+fn run(decoder: u32, generation_size: u32, loss: u64, data: &[u8]) -> FFIDecodeStats {
+    let tx = helix_rs_create_socket();
+    let rx = helix_rs_create_socket();
+    let mut config = HelixCodingConfig::default();
+    config.generation_size = generation_size;
+    config.repair_overhead = (loss as f64 / 100.0) * 1.5;
+    config.decoder = decoder;
+    assert_eq!(helix_rs_configure(tx, config), 0);
+    assert_eq!(helix_rs_configure(rx, config), 0);
+
+    let mut channel = Channel {
+        state: 0x9e3779b97f4a7c15,
+        loss,
+    };
+    let mut now = 0u64;
+    let mut received: Vec<Vec<u8>> = Vec::new();
+    helix_rs_send(tx, to_buffer(data), now);
+    helix_rs_flush(tx, now);
+    loop {
+        loop {
+            let frame = helix_rs_poll_transmit(tx);
+            if frame.as_slice().is_empty() {
+                break;
+            }
+            now += FRAME_SPACING_NS;
+            if channel.drops() {
+                helix_rs_buffer_release(frame);
+                continue;
+            }
+            helix_rs_recv(rx, frame, now);
+            loop {
+                let chunk = helix_rs_poll_recv(rx);
+                if chunk.as_slice().is_empty() {
+                    break;
+                }
+                received.push(chunk.as_slice().to_vec());
+                helix_rs_buffer_release(chunk);
+            }
+        }
+        loop {
+            let ack = helix_rs_poll_transmit(rx);
+            if ack.as_slice().is_empty() {
+                break;
+            }
+            helix_rs_recv(tx, ack, now);
+        }
+        if helix_rs_pending_generations(tx) == 0 {
+            break;
+        }
+        now = now.max(helix_rs_next_timeout(tx));
+        helix_rs_on_timeout(tx, now);
+    }
+
+    // chunks of lost symbols arrive out of order, compare them as a set
+    let mut expected: Vec<&[u8]> = data.chunks(config.symbol_size as usize - 10).collect();
+    let mut got: Vec<&[u8]> = received.iter().map(|c| c.as_slice()).collect();
+    expected.sort_unstable();
+    got.sort_unstable();
+    assert!(expected == got, "decoded data differs from the data sent");
+
+    let stats = helix_rs_decode_stats(rx);
+    helix_rs_destroy_socket(tx);
+    helix_rs_destroy_socket(rx);
+    stats
+}
+
+fn main() {
+    let loss: u64 = std::env::args()
+        .nth(1)
+        .and_then(|a| a.parse().ok())
+        .unwrap_or(10);
+    let data: Vec<u8> = (0..BYTES).map(|i| (i * 7 + i / 1014) as u8).collect();
+
+    println!("loss {}%, {} MiB per run", loss, BYTES >> 20);
+    println!(
+        "{:<12} {:>4} {:>6} {:>9} {:>12} {:>12} {:>12} {:>12} {:>12}",
+        "decoder", "k", "gens", "recovered", "lat p50 us", "lat p99 us", "cpl p50 us",
+        "cpl p99 us", "cpl max us"
+    );
+    for &generation_size in GENERATION_SIZES.iter() {
+        for &(decoder, name) in DECODERS.iter() {
+            let s = run(decoder, generation_size, loss, &data);
+            println!(
+                "{:<12} {:>4} {:>6} {:>9} {:>12.1} {:>12.1} {:>12.1} {:>12.1} {:>12.1}",
+                name,
+                generation_size,
+                s.generations,
+                s.recovered,
+                s.latency_p50 as f64 / 1e3,
+                s.latency_p99 as f64 / 1e3,
+                s.completion_p50 as f64 / 1e3,
+                s.completion_p99 as f64 / 1e3,
+                s.completion_max as f64 / 1e3
+            );
+        }
+    }
+}
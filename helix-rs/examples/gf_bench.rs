@@ -0,0 +1,58 @@
+/* GF(2^8) region kernel benchmark
+ *
+ * Times mul_add_region (dst ^= c * src) for every kernel this CPU
+ * supports over a range of symbol sizes, after checking each kernel
+ * against the scalar one. Prints GB/s of source symbol processed.
+ *
+ * cargo run --release --example gf_bench [bytes per measurement]
+*/
+
+use helix_rs::gf256::{self, Kernel};
+use std::time::Instant;
+
+const SYMBOL_SIZES: [usize; 6] = [64, 256, 1024, 1500, 4096, 16384];
+
+fn check(kernel: Kernel) {
+    let src: Vec<u8> = (0..4099).map(|i| (i * 31 + 7) as u8).collect();
+    for c in [2u8, 0x53, 0xff] {
+        let mut want = vec![0x5au8; src.len()];
+        let mut got = want.clone();
+        gf256::mul_add_region_with(Kernel::Scalar, &mut want, &src, c);
+        gf256::mul_add_region_with(kernel, &mut got, &src, c);
+        assert!(want == got, "{} mul_add disagrees with scalar", kernel.name());
+
+        gf256::mul_region_with(Kernel::Scalar, &mut want, c);
+        gf256::mul_region_with(kernel, &mut got, c);
+        assert!(want == got, "{} mul disagrees with scalar", kernel.name());
+    }
+}
+
+fn main() {
+    let total: usize = std::env::args()
+        .nth(1)
+        .and_then(|a| a.parse().ok())
+        .unwrap_or(1 << 28);
+
+    println!("active kernel: {}", gf256::active().name());
+    println!("{:<8} {:>8} {:>10}", "kernel", "symbol", "GB/s");
+    for kernel in Kernel::ALL.iter().copied().filter(|k| k.is_supported()) {
+        check(kernel);
+        for &size in SYMBOL_SIZES.iter() {
+            // a working set of a few symbols stays in L1/L2 like a generation would
+            let src: Vec<u8> = (0..size * 8).map(|i| (i * 131 + 17) as u8).collect();
+            let mut dst = vec![0u8; size];
+            let iterations = (total / size).max(1);
+
+            let start = Instant::now();
+            for i in 0..iterations {
+                let s = &src[(i % 8) * size..(i % 8 + 1) * size];
+                gf256::mul_add_region_with(kernel, &mut dst, s, (i % 254 + 2) as u8);
+            }
+            let elapsed = start.elapsed().as_secs_f64();
+            std::hint::black_box(&dst);
+
+            let gbps = (iterations * size) as f64 / elapsed / 1e9;
+            println!("{:<8} {:>8} {:>10.2}", kernel.name(), size, gbps);
+        }
+    }
+}
@@ -0,0 +1,446 @@
+/* HELIX frame format
+ *
+ * Every frame starts with a 13 byte header, big endian:
+ * - kind        (8 bits)  source symbol, repair symbol or ack
+ * - generation  (32 bits) generation the symbol belongs to
+ * - k           (16 bits) source symbols in the generation, 0 while open
+ * - index       (16 bits) < k for source symbols, >= k for repair symbols
+ * - seq         (32 bits) per-connection transmission sequence number
+ *
+ * A source symbol is sent unpadded and starts with a 10 byte prefix,
+ * the length (16 bits) and stream offset (64 bits) of the data it holds.
+ * The erasure code works on symbols zero padded to the symbol size, so
+ * the prefix is recovered along with the data. A repair symbol carries
+ * sum(c_j * source_j) over the generation; its coefficients are derived
+ * from (generation, index) so they never go on the wire.
+ *
+ * Receiver feedback is a block of LEB128 varints:
+ * - base generation the ids below are relative to
+ * - loss counters of the receiver: frames received, frames lost and the
+ *   loss bursts they were lost in, cumulative and wrapping, as seen from
+ *   the seq numbers
+ * - receive limit plus one, the stream offset the receiver has room up
+ *   to, 0 if it has no limit
+ * - count of decoded ranges, then per range the gap from the end of the
+ *   previous range (base for the first) and its length
+ * - count of generations in progress, then per generation the gap from
+ *   the previous one plus one (base for the first) and the degrees of
+ *   freedom it still misses
+ * It travels behind the symbol of a source or repair frame whose kind
+ * has FLAG_FEEDBACK set, followed by its length (16 bits), when the frame
+ * stays within a header plus a symbol; in a feedback frame of its own
+ * otherwise.
+*/
+
+pub const HEADER_LEN: usize = 13;
+pub const SOURCE_PREFIX_LEN: usize = 10;
+pub const SEQ_OFFSET: usize = 9;
+pub const FEEDBACK_LEN_LEN: usize = 2;
+pub const MAX_INTERLEAVE_DEPTH: u32 = 64;
+
+pub const KIND_SOURCE: u8 = 0;
+pub const KIND_REPAIR: u8 = 1;
+pub const KIND_FEEDBACK: u8 = 2;
+pub const FLAG_FEEDBACK: u8 = 0x80;
+
+/// Stream bytes a sender puts in generations before it heard the
+/// receive limit, and the most a receiver holds beyond its limit
+pub const INITIAL_WINDOW: u64 = 65536;
+
+#[derive(Clone, Copy, Debug, PartialEq, Eq)]
+pub struct FrameHeader {
+    pub kind: u8,
+    pub generation: u32,
+    pub k: u16,
+    pub index: u16,
+    pub seq: u32,
+}
+
+impl FrameHeader {
+    pub fn write(&self, out: &mut Vec<u8>) {
+        out.push(self.kind);
+        out.extend_from_slice(&self.generation.to_be_bytes());
+        out.extend_from_slice(&self.k.to_be_bytes());
+        out.extend_from_slice(&self.index.to_be_bytes());
+        out.extend_from_slice(&self.seq.to_be_bytes());
+    }
+
+    /* Returns the header and the frame body, None if truncated */
+    pub fn parse(frame: &[u8]) -> Option<(FrameHeader, &[u8])> {
+        if frame.len() < HEADER_LEN {
+            return None;
+        }
+        let header = FrameHeader {
+            kind: frame[0],
+            generation: u32::from_be_bytes([frame[1], frame[2], frame[3], frame[4]]),
+            k: u16::from_be_bytes([frame[5], frame[6]]),
+            index: u16::from_be_bytes([frame[7], frame[8]]),
+            seq: u32::from_be_bytes([frame[9], frame[10], frame[11], frame[12]]),
+        };
+        Some((header, &frame[HEADER_LEN..]))
+    }
+}
+
+/* Loss counters of a receiver, as reported in its feedback */
+#[repr(C)]
+#[derive(Clone, Copy, Default, Debug, PartialEq, Eq)]
+pub struct FFILossFeedback {
+    pub received: u32,
+    pub lost: u32,
+    pub bursts: u32,
+}
+
+impl FFILossFeedback {
+    /* Count a frame with sequence number seq, highest is the highest
+     * sequence number seen so far
+    */
+    pub fn on_seq(&mut self, seq: u32, highest: &mut Option<u32>) {
+        let ahead = match *highest {
+            Some(h) => seq.wrapping_sub(h),
+            None => 1,
+        };
+        if ahead == 0 {
+            return;
+        }
+        self.received = self.received.wrapping_add(1);
+        if ahead < 1 << 31 {
+            if ahead > 1 {
+                self.lost = self.lost.wrapping_add(ahead - 1);
+                self.bursts = self.bursts.wrapping_add(1);
+            }
+            *highest = Some(seq);
+        } else {
+            // reordered, it was counted as lost when the gap opened
+            self.lost = self.lost.wrapping_sub(1);
+        }
+    }
+}
+
+/* Append v as a LEB128 varint */
+pub fn write_varint(out: &mut Vec<u8>, mut v: u64) {
+    while v >= 0x80 {
+        out.push(v as u8 | 0x80);
+        v >>= 7;
+    }
+    out.push(v as u8);
+}
+
+/* Read a LEB128 varint at *pos and advance it, None if truncated */
+pub fn read_varint(data: &[u8], pos: &mut usize) -> Option<u64> {
+    let mut v = 0u64;
+    for shift in (0..64).step_by(7) {
+        let byte = *data.get(*pos)?;
+        *pos += 1;
+        v |= ((byte & 0x7f) as u64) << shift;
+        if byte & 0x80 == 0 {
+            return Some(v);
+        }
+    }
+    None
+}
+
+/* Receiver feedback, ids sorted ascending */
+#[derive(Debug, PartialEq, Eq)]
+pub struct Feedback {
+    pub loss: FFILossFeedback,
+    /* stream offset the receiver has room up to, u64::MAX if unbounded */
+    pub limit: u64,
+    /* first generation and length of every decoded range */
+    pub decoded: Vec<(u32, u32)>,
+    /* generation and the degrees of freedom it misses */
+    pub missing: Vec<(u32, u32)>,
+}
+
+impl Default for Feedback {
+    fn default() -> Feedback {
+        Feedback {
+            loss: FFILossFeedback::default(),
+            limit: u64::MAX,
+            decoded: Vec::new(),
+            missing: Vec::new(),
+        }
+    }
+}
+
+impl Feedback {
+    pub fn clear(&mut self) {
+        self.decoded.clear();
+        self.missing.clear();
+    }
+
+    pub fn write(&self, out: &mut Vec<u8>) {
+        let base = match (self.decoded.first(), self.missing.first()) {
+            (Some(&(d, _)), Some(&(m, _))) => d.min(m),
+            (Some(&(d, _)), None) => d,
+            (None, Some(&(m, _))) => m,
+            (None, None) => 0,
+        };
+        write_varint(out, base as u64);
+        write_varint(out, self.loss.received as u64);
+        write_varint(out, self.loss.lost as u64);
+        write_varint(out, self.loss.bursts as u64);
+        write_varint(out, self.limit.wrapping_add(1));
+
+        write_varint(out, self.decoded.len() as u64);
+        let mut cursor = base;
+        for &(first, count) in &self.decoded {
+            write_varint(out, first.wrapping_sub(cursor) as u64);
+            write_varint(out, count as u64);
+            cursor = first.wrapping_add(count);
+        }
+        write_varint(out, self.missing.len() as u64);
+        let mut cursor = base;
+        for &(id, missing) in &self.missing {
+            write_varint(out, id.wrapping_sub(cursor) as u64);
+            write_varint(out, missing as u64);
+            cursor = id.wrapping_add(1);
+        }
+    }
+
+    /* Overwrite self with a block built by write, false if malformed */
+    pub fn parse(&mut self, block: &[u8]) -> bool {
+        self.clear();
+        self.parse_fields(block).is_some()
+    }
+
+    fn parse_fields(&mut self, block: &[u8]) -> Option<()> {
+        let mut pos = 0;
+        let mut word = || read_varint(block, &mut pos);
+        let base = word()? as u32;
+        self.loss = FFILossFeedback {
+            received: word()? as u32,
+            lost: word()? as u32,
+            bursts: word()? as u32,
+        };
+        self.limit = word()?.wrapping_sub(1);
+        let mut cursor = base;
+        for _ in 0..word()? {
+            let first = cursor.wrapping_add(word()? as u32);
+            let count = word()? as u32;
+            self.decoded.push((first, count));
+            cursor = first.wrapping_add(count);
+        }
+        let mut cursor = base;
+        for _ in 0..word()? {
+            let id = cursor.wrapping_add(word()? as u32);
+            self.missing.push((id, word()? as u32));
+            cursor = id.wrapping_add(1);
+        }
+        Some(())
+    }
+}
+
+/* Split the body of a frame with FLAG_FEEDBACK into the symbol and the
+ * feedback block behind it, None if malformed
+*/
+pub fn split_feedback(body: &[u8]) -> Option<(&[u8], &[u8])> {
+    let end = body.len().checked_sub(FEEDBACK_LEN_LEN)?;
+    let len = u16::from_be_bytes([body[end], body[end + 1]]) as usize;
+    let start = end.checked_sub(len)?;
+    Some((&body[..start], &body[start..end]))
+}
+
+/* Append a feedback block written by Feedback::write to a source or
+ * repair frame, false and the frame untouched if it would grow beyond
+ * max_len
+*/
+pub fn append_feedback(frame: &mut Vec<u8>, block: &[u8], max_len: usize) -> bool {
+    if frame.len() + block.len() + FEEDBACK_LEN_LEN > max_len || block.len() > u16::MAX as usize {
+        return false;
+    }
+    frame[0] |= FLAG_FEEDBACK;
+    frame.extend_from_slice(block);
+    frame.extend_from_slice(&(block.len() as u16).to_be_bytes());
+    true
+}
+
+/* Overwrite the sequence number of an encoded frame */
+pub fn set_seq(frame: &mut [u8], seq: u32) {
+    frame[SEQ_OFFSET..SEQ_OFFSET + 4].copy_from_slice(&seq.to_be_bytes());
+}
+
+/* Generation of a frame built by FrameHeader::write */
+pub fn frame_generation(frame: &[u8]) -> u32 {
+    u32::from_be_bytes(frame[1..5].try_into().unwrap())
+}
+
+pub fn write_source_prefix(out: &mut Vec<u8>, len: u16, offset: u64) {
+    out.extend_from_slice(&len.to_be_bytes());
+    out.extend_from_slice(&offset.to_be_bytes());
+}
+
+/* Returns (offset, data) of a source symbol, None if malformed */
+pub fn parse_source(symbol: &[u8]) -> Option<(u64, &[u8])> {
+    if symbol.len() < SOURCE_PREFIX_LEN {
+        return None;
+    }
+    let len = u16::from_be_bytes([symbol[0], symbol[1]]) as usize;
+    let mut offset = [0u8; 8];
+    offset.copy_from_slice(&symbol[2..SOURCE_PREFIX_LEN]);
+    let data = symbol.get(SOURCE_PREFIX_LEN..SOURCE_PREFIX_LEN + len)?;
+    Some((u64::from_be_bytes(offset), data))
+}
+
+/* Coefficients of repair symbol index of a generation of k symbols
+ * Nonzero and reproducible on both ends, out is overwritten
+*/
+pub fn repair_coefficients(generation: u32, index: u16, k: usize, out: &mut Vec<u8>) {
+    let mut state = ((generation as u64) << 16 | index as u64) ^ 0x9e3779b97f4a7c15;
+    out.clear();
+    while out.len() < k {
+        // splitmix64
+        state = state.wrapping_add(0x9e3779b97f4a7c15);
+        let mut z = state;
+        z = (z ^ (z >> 30)).wrapping_mul(0xbf58476d1ce4e5b9);
+        z = (z ^ (z >> 27)).wrapping_mul(0x94d049bb133111eb);
+        z ^= z >> 31;
+        for b in z.to_le_bytes() {
+            if out.len() < k && b != 0 {
+                out.push(b);
+            }
+        }
+    }
+}
+
+/* Erasure coding parameters of a connection */
+#[repr(C)]
+#[derive(Clone, Copy, Debug)]
+pub struct HelixCodingConfig {
+    pub symbol_size: u32,
+    pub generation_size: u32,
+    pub repair_overhead: f64,
+    pub repair_timeout_ns: u64,
+    pub max_repair_rounds: u32,
+    pub decoder: u32,
+    pub interleave_depth: u32,
+    pub feedback_interval_ns: u64,
+}
+
+impl Default for HelixCodingConfig {
+    fn default() -> HelixCodingConfig {
+        HelixCodingConfig {
+            symbol_size: 1024,
+            generation_size: 32,
+            repair_overhead: 0.25,
+            repair_timeout_ns: 100_000_000,
+            max_repair_rounds: 16,
+            decoder: crate::decoder::DECODER_INCREMENTAL,
+            interleave_depth: 1,
+            feedback_interval_ns: 1_000_000,
+        }
+    }
+}
+
+impl HelixCodingConfig {
+    /* Repair symbols sent per round for a generation of k symbols */
+    pub fn repairs_per_round(&self, k: usize) -> usize {
+        ((self.repair_overhead * k as f64).ceil() as usize).max(1)
+    }
+
+    /* Data bytes carried by one source symbol */
+    pub fn data_per_symbol(&self) -> usize {
+        self.symbol_size as usize - SOURCE_PREFIX_LEN
+    }
+
+    /* Largest coded frame, a header and a full symbol */
+    pub fn max_frame_len(&self) -> usize {
+        HEADER_LEN + self.symbol_size as usize
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    fn sample_feedback() -> Feedback {
+        Feedback {
+            loss: FFILossFeedback {
+                received: u32::MAX,
+                lost: 300,
+                bursts: 2,
+            },
+            limit: 1 << 40,
+            decoded: vec![(7, 3), (12, 200)],
+            missing: vec![(212, 1), (214, 40)],
+        }
+    }
+
+    #[test]
+    fn varint_round_trip() {
+        let values = [0, 1, 0x7f, 0x80, 0x3fff, 0x4000, u32::MAX as u64, u64::MAX];
+        let mut out = Vec::new();
+        for &v in &values {
+            write_varint(&mut out, v);
+        }
+        let mut pos = 0;
+        for &v in &values {
+            assert_eq!(read_varint(&out, &mut pos), Some(v));
+        }
+        assert_eq!(pos, out.len());
+        assert_eq!(read_varint(&out, &mut pos), None);
+    }
+
+    #[test]
+    fn truncated_varint_is_rejected() {
+        let mut out = Vec::new();
+        write_varint(&mut out, u64::MAX);
+        for len in 0..out.len() {
+            let mut pos = 0;
+            assert_eq!(read_varint(&out[..len], &mut pos), None);
+        }
+    }
+
+    #[test]
+    fn feedback_round_trip() {
+        let feedback = sample_feedback();
+        let mut block = Vec::new();
+        feedback.write(&mut block);
+        let mut parsed = Feedback::default();
+        assert!(parsed.parse(&block));
+        assert_eq!(parsed, feedback);
+    }
+
+    #[test]
+    fn feedback_round_trip_across_id_wraparound() {
+        let feedback = Feedback {
+            loss: FFILossFeedback::default(),
+            limit: u64::MAX,
+            decoded: vec![(u32::MAX - 4, 3), (u32::MAX, 2)],
+            missing: vec![(u32::MAX - 1, 5), (1, 1), (3, 2)],
+        };
+        let mut block = Vec::new();
+        feedback.write(&mut block);
+        let mut parsed = Feedback::default();
+        assert!(parsed.parse(&block));
+        assert_eq!(parsed, feedback);
+    }
+
+    #[test]
+    fn truncated_feedback_is_rejected() {
+        let mut block = Vec::new();
+        sample_feedback().write(&mut block);
+        let mut parsed = Feedback::default();
+        for len in 0..block.len() {
+            assert!(!parsed.parse(&block[..len]), "parsed {} of {} bytes", len, block.len());
+        }
+    }
+
+    #[test]
+    fn feedback_only_rides_behind_a_symbol_that_leaves_room() {
+        let mut block = Vec::new();
+        sample_feedback().write(&mut block);
+        let mut frame = vec![KIND_SOURCE; HEADER_LEN + 100];
+        let max_len = frame.len() + block.len() + FEEDBACK_LEN_LEN;
+
+        let mut full = frame.clone();
+        assert!(!append_feedback(&mut full, &block, max_len - 1));
+        assert_eq!(full, frame);
+
+        assert!(append_feedback(&mut frame, &block, max_len));
+        assert_eq!(frame.len(), max_len);
+        assert_eq!(frame[0], KIND_SOURCE | FLAG_FEEDBACK);
+        let (symbol, carried) = split_feedback(&frame[HEADER_LEN..]).unwrap();
+        assert_eq!(symbol.len(), 100);
+        assert_eq!(carried, &block[..]);
+    }
+}
@@ -0,0 +1,460 @@
+/* Per-socket HELIX state
+ *
+ * One HelixConnection is created for every C++ HelixSocketImpl and handed
+ * across the FFI as an opaque pointer, so every call reaches its state
+ * with a single dereference no matter how many sockets exist.
+ *
+ * The connection does no I/O and reads no clock: C++ passes the current
+ * simulation time in, pushes application data and received frames, and
+ * pulls frames to transmit and decoded data back out.
+ *
+ * Feedback goes out when the decoder has news for the sender, at most
+ * once per feedback_interval_ns or a quarter of the smoothed RTT the
+ * socket reports, whichever is shorter. It rides behind the next coded
+ * frame if it fits there, in a frame of its own otherwise.
+*/
+
+use crate::codec::{self, FFILossFeedback, Feedback, FrameHeader, HelixCodingConfig};
+use crate::decoder::{self, Decoder, FFIDecodeStats};
+use crate::encoder::{Encoder, FFICongestionSample};
+use crate::log::{self, helix_log};
+use crate::pool;
+use crate::FFISharedBuffer;
+
+#[derive(Clone, Copy, PartialEq, Eq, Debug)]
+pub enum ConnState {
+    Created,
+    Bound,
+    Listening,
+    Connected,
+    Closed,
+}
+
+pub struct HelixConnection {
+    state: ConnState,
+    local: Vec<u8>,
+    peer: Vec<u8>,
+    tx_packets: u64,
+    rx_packets: u64,
+    tx_seq: u32,
+    rx_highest_seq: Option<u32>,
+    rx_loss: FFILossFeedback,
+    peer_loss: FFILossFeedback,
+    encoder: Encoder,
+    decoder: Decoder,
+    feedback: Feedback,
+    feedback_block: Vec<u8>,
+    feedback_interval_ns: u64,
+    rtt_ns: u64,
+    max_frame_len: usize,
+    held: Option<Vec<u8>>,
+    feedback_ready: bool,
+    feedback_due: u64,
+    last_feedback: Option<u64>,
+}
+
+impl HelixConnection {
+    pub fn new() -> HelixConnection {
+        HelixConnection {
+            state: ConnState::Created,
+            local: Vec::new(),
+            peer: Vec::new(),
+            tx_packets: 0,
+            rx_packets: 0,
+            tx_seq: 0,
+            rx_highest_seq: None,
+            rx_loss: FFILossFeedback::default(),
+            peer_loss: FFILossFeedback::default(),
+            encoder: Encoder::new(HelixCodingConfig::default()),
+            decoder: Decoder::new(),
+            feedback: Feedback::default(),
+            feedback_block: Vec::new(),
+            feedback_interval_ns: HelixCodingConfig::default().feedback_interval_ns,
+            rtt_ns: 0,
+            max_frame_len: HelixCodingConfig::default().max_frame_len(),
+            held: None,
+            feedback_ready: false,
+            feedback_due: u64::MAX,
+            last_feedback: None,
+        }
+    }
+
+    pub fn configure(&mut self, config: HelixCodingConfig) -> u8 {
+        if (config.symbol_size as usize) <= codec::SOURCE_PREFIX_LEN
+            || config.symbol_size > u16::MAX as u32
+            || config.generation_size == 0
+            || config.generation_size > u16::MAX as u32
+            || !(config.repair_overhead >= 0.0)
+            || config.decoder > decoder::DECODER_BATCH
+            || config.interleave_depth == 0
+            || config.interleave_depth > codec::MAX_INTERLEAVE_DEPTH
+        {
+            helix_log!(log::WARN, "invalid coding config {:?}", config);
+            return 1;
+        }
+        self.encoder.configure(config);
+        self.decoder.set_mode(config.decoder);
+        self.feedback_interval_ns = config.feedback_interval_ns;
+        self.max_frame_len = config.max_frame_len();
+        0
+    }
+
+    /* Smoothed RTT measured by the socket, 0 while unknown */
+    pub fn set_rtt(&mut self, rtt_ns: u64) {
+        self.rtt_ns = rtt_ns;
+    }
+
+    fn feedback_interval(&self) -> u64 {
+        match self.rtt_ns {
+            0 => self.feedback_interval_ns,
+            rtt => self.feedback_interval_ns.min(rtt / 4),
+        }
+    }
+
+    pub fn state(&self) -> ConnState {
+        self.state
+    }
+
+    pub fn bind(&mut self, address: &[u8]) -> u8 {
+        if self.state == ConnState::Closed {
+            helix_log!(log::WARN, "bind on a closed connection");
+            return 1;
+        }
+        self.local.clear();
+        self.local.extend_from_slice(address);
+        if self.state == ConnState::Created {
+            self.state = ConnState::Bound;
+        }
+        helix_log!(log::LOGIC, "bound to {} address bytes, state {:?}", address.len(), self.state);
+        0
+    }
+
+    pub fn connect(&mut self, address: &[u8]) -> u8 {
+        if self.state == ConnState::Closed {
+            helix_log!(log::WARN, "connect on a closed connection");
+            return 1;
+        }
+        self.peer.clear();
+        self.peer.extend_from_slice(address);
+        self.state = ConnState::Connected;
+        helix_log!(log::LOGIC, "connected to {} address bytes", address.len());
+        0
+    }
+
+    pub fn listen(&mut self) -> u8 {
+        if self.state == ConnState::Closed {
+            helix_log!(log::WARN, "listen on a closed connection");
+            return 1;
+        }
+        self.state = ConnState::Listening;
+        0
+    }
+
+    pub fn close(&mut self) -> u8 {
+        self.state = ConnState::Closed;
+        helix_log!(
+            log::INFO,
+            "closed after {} packets sent, {} received",
+            self.tx_packets,
+            self.rx_packets
+        );
+        0
+    }
+
+    /* Queue application data, its source symbols are sent right away */
+    pub fn send(&mut self, packet: FFISharedBuffer, now: u64) {
+        self.tx_packets += 1;
+        helix_log!(log::DEBUG, "tx packet {} of {} bytes", self.tx_packets, packet.len);
+        if self.state != ConnState::Closed {
+            self.encoder.push(packet.as_slice(), now);
+        }
+        pool::release(packet);
+    }
+
+    /* Close the open generation so its repairs go out */
+    pub fn flush(&mut self, now: u64) {
+        self.encoder.flush(now);
+    }
+
+    /* Handle a received frame
+     * Returns the number of data chunks that became ready
+    */
+    pub fn recv(&mut self, frame: FFISharedBuffer, now: u64) -> usize {
+        self.rx_packets += 1;
+        helix_log!(log::DEBUG, "rx frame {} of {} bytes", self.rx_packets, frame.len);
+        let ready = match FrameHeader::parse(frame.as_slice()) {
+            Some((mut header, mut body)) => {
+                self.rx_loss.on_seq(header.seq, &mut self.rx_highest_seq);
+                if header.kind & codec::FLAG_FEEDBACK != 0 {
+                    header.kind &= !codec::FLAG_FEEDBACK;
+                    match codec::split_feedback(body) {
+                        Some((symbol, block)) => {
+                            self.on_feedback(block, now);
+                            body = symbol;
+                        }
+                        None => body = &[],
+                    }
+                }
+                self.on_frame(&header, body, now)
+            }
+            None => {
+                helix_log!(log::WARN, "truncated frame of {} bytes", frame.len);
+                0
+            }
+        };
+        pool::release(frame);
+        self.schedule_feedback(now);
+        ready
+    }
+
+    fn on_frame(&mut self, header: &FrameHeader, body: &[u8], now: u64) -> usize {
+        match header.kind {
+            codec::KIND_SOURCE | codec::KIND_REPAIR if !body.is_empty() => {
+                self.decoder.on_symbol(header, body, now)
+            }
+            codec::KIND_FEEDBACK => {
+                self.on_feedback(body, now);
+                0
+            }
+            _ => {
+                helix_log!(log::WARN, "malformed frame of kind {}", header.kind);
+                0
+            }
+        }
+    }
+
+    fn on_feedback(&mut self, block: &[u8], now: u64) {
+        let feedback = &mut self.feedback;
+        if !feedback.parse(block) {
+            helix_log!(log::WARN, "malformed feedback of {} bytes", block.len());
+            return;
+        }
+        for &(first, count) in &feedback.decoded {
+            self.encoder.on_decoded(first, count, now);
+        }
+        for &(id, missing) in &feedback.missing {
+            self.encoder.on_missing(id, missing);
+        }
+        self.encoder.set_peer_limit(feedback.limit, now);
+        // feedback may be reordered, keep the most recent counters
+        if feedback.loss.received.wrapping_sub(self.peer_loss.received) < 1 << 31 {
+            self.peer_loss = feedback.loss;
+        }
+    }
+
+    /* Let feedback out if the decoder has news and the previous one left
+     * at least feedback_interval() ago, otherwise set feedback_due
+    */
+    fn schedule_feedback(&mut self, now: u64) {
+        if self.feedback_ready || !self.decoder.feedback_pending() {
+            return;
+        }
+        let earliest = self
+            .last_feedback
+            .map_or(0, |last| last.saturating_add(self.feedback_interval()));
+        if now >= earliest {
+            self.feedback_ready = true;
+            self.feedback_due = u64::MAX;
+            self.last_feedback = Some(now);
+        } else {
+            self.feedback_due = earliest;
+        }
+    }
+
+    /* Next frame to put on the wire, the bytes the caller allows in
+     * flight. Feedback is not limited by window: with no coded frame to
+     * carry it, it goes out on its own.
+    */
+    pub fn poll_transmit(&mut self, window: u64) -> Option<FFISharedBuffer> {
+        let mut frame = match self.held.take() {
+            Some(frame) => frame,
+            None if self.feedback_ready => self.feedback_frame(window),
+            None => self.encoder.poll_transmit(window)?,
+        };
+        codec::set_seq(&mut frame, self.tx_seq);
+        self.tx_seq = self.tx_seq.wrapping_add(1);
+        Some(pool::into_buffer(frame))
+    }
+
+    /* Frame with the pending feedback: the next coded frame if the block
+     * fits behind its symbol, a feedback frame otherwise, and the coded
+     * frame is held for the next poll_transmit
+    */
+    fn feedback_frame(&mut self, window: u64) -> Vec<u8> {
+        self.feedback_ready = false;
+        self.decoder.take_feedback(&mut self.feedback);
+        self.feedback.loss = self.rx_loss;
+        self.feedback_block.clear();
+        self.feedback.write(&mut self.feedback_block);
+        if let Some(mut frame) = self.encoder.poll_transmit(window) {
+            if codec::append_feedback(&mut frame, &self.feedback_block, self.max_frame_len) {
+                return frame;
+            }
+            self.held = Some(frame);
+        }
+        let mut frame = pool::take_vec(codec::HEADER_LEN + self.feedback_block.len());
+        FrameHeader {
+            kind: codec::KIND_FEEDBACK,
+            generation: 0,
+            k: 0,
+            index: 0,
+            seq: 0,
+        }
+        .write(&mut frame);
+        frame.extend_from_slice(&self.feedback_block);
+        frame
+    }
+
+    /* Next decoded chunk of application data and its stream offset */
+    pub fn poll_recv(&mut self) -> Option<(u64, FFISharedBuffer)> {
+        self.decoder
+            .poll_ready()
+            .map(|(offset, chunk)| (offset, pool::into_buffer(chunk)))
+    }
+
+    /* Earliest repair deadline or time held back feedback may leave */
+    pub fn next_timeout(&self) -> u64 {
+        self.encoder.next_timeout().min(self.feedback_due)
+    }
+
+    pub fn on_timeout(&mut self, now: u64) {
+        self.encoder.on_timeout(now);
+        if self.feedback_due <= now {
+            self.schedule_feedback(now);
+        }
+    }
+
+    /* Generations closed but not acked, plus the open one */
+    pub fn pending_generations(&self) -> usize {
+        self.encoder.pending_generations() + self.encoder.has_open_generation() as usize
+    }
+
+    /* Coded frames waiting for poll_transmit, feedback not included */
+    pub fn queued_frames(&self) -> usize {
+        self.encoder.queued_frames() + self.held.is_some() as usize
+    }
+
+    /* Loss counters the peer reported in its latest feedback */
+    pub fn loss_feedback(&self) -> FFILossFeedback {
+        self.peer_loss
+    }
+
+    pub fn congestion_sample(&mut self) -> FFICongestionSample {
+        self.encoder.take_congestion_sample()
+    }
+
+    pub fn decode_stats(&self) -> FFIDecodeStats {
+        self.decoder.stats()
+    }
+
+    /* Returns whether a window update waits to go out */
+    pub fn set_recv_limit(&mut self, limit: u64, now: u64) -> bool {
+        self.decoder.set_recv_limit(limit);
+        self.schedule_feedback(now);
+        self.feedback_ready || self.feedback_due != u64::MAX
+    }
+
+    /* Bytes send may still take before the peer runs out of room */
+    pub fn send_room(&self) -> u64 {
+        self.encoder.send_room()
+    }
+
+    pub fn poll_decode_latency(&mut self) -> Option<u64> {
+        self.decoder.poll_latency()
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use std::collections::BTreeMap;
+
+    const MS: u64 = 1_000_000;
+
+    /* Hand every frame from to can send over to to, dropping those lose
+     * picks
+    */
+    fn deliver(
+        from: &mut HelixConnection,
+        to: &mut HelixConnection,
+        now: u64,
+        lose: impl Fn(&FrameHeader) -> bool,
+    ) {
+        while let Some(frame) = from.poll_transmit(u64::MAX) {
+            match FrameHeader::parse(frame.as_slice()) {
+                Some((header, _)) if lose(&header) => pool::release(frame),
+                _ => {
+                    to.recv(frame, now);
+                }
+            }
+        }
+    }
+
+    #[test]
+    fn reader_pausing_past_every_repair_round_loses_nothing() {
+        let config = HelixCodingConfig::default();
+        let window = 8192;
+        let total = 200_000;
+        let pause = (config.max_repair_rounds as u64 + 4) * config.repair_timeout_ns;
+        let data_per_symbol = config.data_per_symbol() as u64;
+
+        let mut tx = HelixConnection::new();
+        let mut rx = HelixConnection::new();
+        let mut written = 0;
+        let mut read = 0;
+        let mut chunks = BTreeMap::new();
+        let mut repair_rounds = 0;
+        let mut lost_bytes = 0;
+        rx.set_recv_limit(window, 0);
+
+        let mut now = 0;
+        while read < total && now < pause + 5000 * MS {
+            // the sender writes what the receiver has room for, in whole
+            // symbols unless the rest is shorter, and closes the
+            // generation when it runs out of room
+            let room = tx.send_room().min(total - written);
+            if room >= data_per_symbol.min(total - written) && room > 0 {
+                tx.send(pool::into_buffer(vec![0u8; room as usize]), now);
+                written += room;
+            } else {
+                tx.flush(now);
+            }
+            if now % (10 * MS) == 0 {
+                tx.flush(now);
+            }
+            if tx.next_timeout() <= now {
+                tx.on_timeout(now);
+            }
+
+            // the first burst loses every fifth source and all repairs,
+            // so generations beyond the limit time out while it is short
+            deliver(&mut tx, &mut rx, now, |h| {
+                now == 0 && (h.kind == codec::KIND_REPAIR || h.index % 5 == 0)
+            });
+            while let Some((offset, chunk)) = rx.poll_recv() {
+                chunks.insert(offset, chunk.len as u64);
+                pool::release(chunk);
+            }
+            if now >= pause {
+                while let Some(len) = chunks.remove(&read) {
+                    read += len;
+                }
+            }
+            rx.set_recv_limit(read + window, now);
+            if rx.next_timeout() <= now {
+                rx.on_timeout(now);
+            }
+            deliver(&mut rx, &mut tx, now, |_| false);
+
+            let sample = tx.congestion_sample();
+            repair_rounds += sample.repair_rounds;
+            lost_bytes += sample.lost_bytes;
+            now += MS;
+        }
+
+        assert_eq!(read, total);
+        assert_eq!(repair_rounds, 0);
+        assert_eq!(lost_bytes, 0);
+        assert_eq!(rx.decode_stats().refused, 0);
+    }
+}
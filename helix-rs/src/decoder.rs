@@ -0,0 +1,859 @@
+/* Generation decoders
+ *
+ * Source symbols are delivered as soon as they arrive, a generation
+ * decoder only recovers the missing ones from repair symbols:
+ * - batch waits until a generation holds as many symbols as sources, then
+ *   cancels the known sources out of the repairs and solves for the
+ *   missing ones with a single Gauss-Jordan elimination
+ * - incremental keeps the received symbols in reduced row echelon form
+ *   and reduces every symbol as it arrives, so the O(k^3) work is spread
+ *   over the generation and a missing source is released as soon as its
+ *   row is resolved
+ * The decoder keeps what the next feedback reports: the recently decoded
+ * generations, decoded ones whose repairs still arrive (the feedback that
+ * reported them may have been lost) and the degrees of freedom missing
+ * from the generations in progress.
+ * Every feedback carries the receive limit and a sender only encodes
+ * data up to it, or up to INITIAL_WINDOW before it heard one. Decoded
+ * chunks that end beyond the limit are held until the limit grows, at
+ * most INITIAL_WINDOW bytes of source data. Source symbols beyond that
+ * are refused, along with the repairs of their generation while the
+ * limit stays short of them, so the generation remains missing until
+ * the reader catches up and a later repair round fills it in.
+*/
+
+use crate::codec::{self, Feedback, FrameHeader};
+use crate::gf256;
+use crate::log::{self, helix_log};
+use crate::pool;
+use std::collections::{BTreeSet, HashMap, VecDeque};
+use std::time::Instant;
+
+/// Decoded generations remembered for re-acking
+const MAX_DONE: usize = 4096;
+/// Generations below the newest one whose decoding every feedback repeats
+const FEEDBACK_SPAN: u32 = 128;
+/// Generations in progress a feedback reports at most
+const MAX_FEEDBACK_MISSING: usize = 64;
+/// Generations this far behind the newest one are dropped undecoded
+const MAX_GENERATION_LAG: u32 = 1024;
+/// Decoded generations the latency percentiles are computed over
+const MAX_SAMPLES: usize = 65536;
+/// Latencies kept for poll_latency, older ones are dropped unread
+pub const MAX_RECENT_LATENCIES: usize = 64;
+
+pub const DECODER_INCREMENTAL: u32 = 0;
+pub const DECODER_BATCH: u32 = 1;
+
+/* Decode latency percentiles over the most recent generations
+ * latency_* is simulation time from the first symbol of a generation to
+ * its decoding, completion_* is wall clock time spent handling the symbol
+ * that completed it, both in ns
+*/
+#[repr(C)]
+#[derive(Clone, Copy, Default, Debug)]
+pub struct FFIDecodeStats {
+    pub generations: u64,
+    pub recovered: u64,
+    pub latency_p50: u64,
+    pub latency_p90: u64,
+    pub latency_p99: u64,
+    pub latency_max: u64,
+    pub completion_p50: u64,
+    pub completion_p99: u64,
+    pub completion_max: u64,
+    /* symbols refused because their data lay beyond the receive limit */
+    pub refused: u64,
+}
+
+trait GenerationDecoder {
+    fn has_source(&self, index: usize) -> bool;
+    /* body is the unpadded source symbol */
+    fn on_source(&mut self, id: u32, index: usize, body: &[u8], recovered: &mut Vec<Vec<u8>>);
+    fn on_repair(
+        &mut self,
+        id: u32,
+        k: usize,
+        index: u16,
+        body: &[u8],
+        recovered: &mut Vec<Vec<u8>>,
+    );
+    fn is_decoded(&self) -> bool;
+    /* Symbols still needed, None while k is unknown */
+    fn missing(&self) -> Option<usize>;
+}
+
+/* -------------------- Batch -------------------- */
+
+#[derive(Default)]
+struct BatchGeneration {
+    k: usize,
+    symbol_size: usize,
+    sources: Vec<Option<Vec<u8>>>,
+    repairs: Vec<(u16, Vec<u8>)>,
+    decoded: bool,
+}
+
+impl BatchGeneration {
+    fn try_decode(&mut self, id: u32, recovered: &mut Vec<Vec<u8>>) {
+        let k = self.k;
+        let received = self.sources.iter().filter(|s| s.is_some()).count();
+        if k == 0 || received + self.repairs.len() < k {
+            return;
+        }
+        let missing: Vec<usize> = (0..k)
+            .filter(|&j| self.sources.get(j).map_or(true, |s| s.is_none()))
+            .collect();
+        if missing.is_empty() || self.solve(id, &missing, recovered) {
+            self.decoded = true;
+        }
+    }
+
+    /* Recover the missing sources of a generation
+     * Returns false if the repairs do not have full rank yet
+    */
+    fn solve(&self, id: u32, missing: &[usize], recovered: &mut Vec<Vec<u8>>) -> bool {
+        let m = missing.len();
+        let mut coefficients = Vec::new();
+
+        // cancel the known sources out of every repair, leaving rows over
+        // the missing columns only
+        let mut rows: Vec<(Vec<u8>, Vec<u8>)> = Vec::with_capacity(self.repairs.len());
+        for (index, repair) in self.repairs.iter() {
+            codec::repair_coefficients(id, *index, self.k, &mut coefficients);
+            let mut data = repair.clone();
+            for (j, source) in self.sources.iter().enumerate().take(self.k) {
+                if let Some(source) = source {
+                    gf256::mul_add_region(&mut data, source, coefficients[j]);
+                }
+            }
+            let row = missing.iter().map(|&j| coefficients[j]).collect();
+            rows.push((row, data));
+        }
+
+        // Gauss-Jordan elimination over the missing columns
+        for col in 0..m {
+            let pivot = match (col..rows.len()).find(|&r| rows[r].0[col] != 0) {
+                Some(p) => p,
+                None => return false,
+            };
+            rows.swap(col, pivot);
+            let scale = gf256::inv(rows[col].0[col]);
+            let (row, data) = &mut rows[col];
+            gf256::mul_region(row, scale);
+            gf256::mul_region(data, scale);
+
+            let (head, tail) = rows.split_at_mut(col);
+            let (pivot_row, rest) = tail.split_first_mut().unwrap();
+            for row in head.iter_mut().chain(rest.iter_mut()) {
+                let factor = row.0[col];
+                if factor == 0 {
+                    continue;
+                }
+                gf256::mul_add_region(&mut row.0, &pivot_row.0, factor);
+                gf256::mul_add_region(&mut row.1, &pivot_row.1, factor);
+            }
+        }
+
+        for (_, symbol) in rows.into_iter().take(m) {
+            recovered.push(symbol);
+        }
+        true
+    }
+}
+
+impl GenerationDecoder for BatchGeneration {
+    fn has_source(&self, index: usize) -> bool {
+        self.sources.get(index).map_or(false, |s| s.is_some())
+    }
+
+    fn on_source(&mut self, id: u32, index: usize, body: &[u8], recovered: &mut Vec<Vec<u8>>) {
+        if self.sources.len() <= index {
+            self.sources.resize(index + 1, None);
+        }
+        self.sources[index] = Some(body.to_vec());
+        self.try_decode(id, recovered);
+    }
+
+    fn on_repair(
+        &mut self,
+        id: u32,
+        k: usize,
+        index: u16,
+        body: &[u8],
+        recovered: &mut Vec<Vec<u8>>,
+    ) {
+        self.k = k;
+        self.symbol_size = body.len();
+        if !self.repairs.iter().any(|(i, _)| *i == index) {
+            self.repairs.push((index, body.to_vec()));
+        }
+        self.try_decode(id, recovered);
+    }
+
+    fn is_decoded(&self) -> bool {
+        self.decoded
+    }
+
+    fn missing(&self) -> Option<usize> {
+        if self.k == 0 {
+            return None;
+        }
+        let sources = self.sources.iter().take(self.k).filter(|s| s.is_some()).count();
+        Some(self.k.saturating_sub(sources + self.repairs.len()))
+    }
+}
+
+/* -------------------- Incremental -------------------- */
+
+struct Row {
+    coefficients: Vec<u8>,
+    data: Vec<u8>,
+}
+
+impl Row {
+    /* Whether the row holds a single source, i.e. its only nonzero
+     * coefficient is the 1 in its pivot column
+    */
+    fn is_resolved(&self, pivot: usize) -> bool {
+        self.coefficients
+            .iter()
+            .enumerate()
+            .all(|(c, &x)| x == 0 || c == pivot)
+    }
+}
+
+#[derive(Default)]
+struct IncrementalGeneration {
+    k: usize,
+    symbol_size: usize,
+    // sources received before the first repair told us k
+    early: Vec<(usize, Vec<u8>)>,
+    seen: Vec<bool>,
+    // pivots[c] has a 1 in column c and a 0 in every other pivot column
+    pivots: Vec<Option<Row>>,
+    resolved: Vec<bool>,
+    rank: usize,
+}
+
+impl IncrementalGeneration {
+    fn mark_seen(&mut self, index: usize) {
+        if self.seen.len() <= index {
+            self.seen.resize(index + 1, false);
+        }
+        self.seen[index] = true;
+    }
+
+    fn source_row(&self, index: usize, body: &[u8]) -> Row {
+        let mut coefficients = vec![0u8; self.k];
+        coefficients[index] = 1;
+        let mut data = body.to_vec();
+        data.resize(self.symbol_size, 0);
+        Row { coefficients, data }
+    }
+
+    /* Reduce a row against the pivots and keep it if it adds rank,
+     * resolved columns of sources we never received are recovered
+    */
+    fn insert(&mut self, mut row: Row, recovered: &mut Vec<Vec<u8>>) {
+        for c in 0..self.k {
+            let factor = row.coefficients[c];
+            if factor == 0 {
+                continue;
+            }
+            if let Some(pivot) = &self.pivots[c] {
+                gf256::mul_add_region(&mut row.coefficients, &pivot.coefficients, factor);
+                gf256::mul_add_region(&mut row.data, &pivot.data, factor);
+            }
+        }
+        let lead = match row.coefficients.iter().position(|&x| x != 0) {
+            Some(lead) => lead,
+            None => return,
+        };
+        let scale = gf256::inv(row.coefficients[lead]);
+        gf256::mul_region(&mut row.coefficients, scale);
+        gf256::mul_region(&mut row.data, scale);
+
+        // keep the other pivot rows reduced in the new pivot column
+        for c in 0..self.k {
+            let pivot = match &mut self.pivots[c] {
+                Some(p) if p.coefficients[lead] != 0 => p,
+                _ => continue,
+            };
+            let factor = pivot.coefficients[lead];
+            gf256::mul_add_region(&mut pivot.coefficients, &row.coefficients, factor);
+            gf256::mul_add_region(&mut pivot.data, &row.data, factor);
+            if pivot.is_resolved(c) {
+                Self::resolve(&mut self.resolved, &self.seen, c, pivot, recovered);
+            }
+        }
+        if row.is_resolved(lead) {
+            Self::resolve(&mut self.resolved, &self.seen, lead, &row, recovered);
+        }
+        self.pivots[lead] = Some(row);
+        self.rank += 1;
+    }
+
+    fn resolve(
+        resolved: &mut [bool],
+        seen: &[bool],
+        c: usize,
+        row: &Row,
+        recovered: &mut Vec<Vec<u8>>,
+    ) {
+        if resolved[c] {
+            return;
+        }
+        resolved[c] = true;
+        if !seen.get(c).copied().unwrap_or(false) {
+            recovered.push(row.data.clone());
+        }
+    }
+}
+
+impl GenerationDecoder for IncrementalGeneration {
+    fn has_source(&self, index: usize) -> bool {
+        // a source recovered before the generation decoded was delivered too
+        self.seen.get(index).copied().unwrap_or(false)
+            || self.resolved.get(index).copied().unwrap_or(false)
+    }
+
+    fn on_source(&mut self, _id: u32, index: usize, body: &[u8], recovered: &mut Vec<Vec<u8>>) {
+        self.mark_seen(index);
+        if self.k == 0 {
+            self.early.push((index, body.to_vec()));
+        } else if index < self.k && self.rank < self.k {
+            let row = self.source_row(index, body);
+            self.insert(row, recovered);
+        }
+    }
+
+    fn on_repair(
+        &mut self,
+        id: u32,
+        k: usize,
+        index: u16,
+        body: &[u8],
+        recovered: &mut Vec<Vec<u8>>,
+    ) {
+        if self.k == 0 {
+            self.k = k;
+            self.symbol_size = body.len();
+            self.pivots = (0..k).map(|_| None).collect();
+            self.resolved = vec![false; k];
+            let early = std::mem::take(&mut self.early);
+            if early.iter().filter(|(i, _)| *i < k).count() == k {
+                // nothing was lost, no need to build the rows
+                self.rank = k;
+                return;
+            }
+            // no other rows exist yet, so sources are pivots as they are
+            for (i, source) in early {
+                if i < k {
+                    self.pivots[i] = Some(self.source_row(i, &source));
+                    self.resolved[i] = true;
+                    self.rank += 1;
+                }
+            }
+        }
+        if self.rank == self.k || body.len() != self.symbol_size {
+            return;
+        }
+
+        let mut coefficients = Vec::with_capacity(k);
+        codec::repair_coefficients(id, index, k, &mut coefficients);
+        let row = Row {
+            coefficients,
+            data: body.to_vec(),
+        };
+        self.insert(row, recovered);
+    }
+
+    fn is_decoded(&self) -> bool {
+        self.k != 0 && self.rank == self.k
+    }
+
+    fn missing(&self) -> Option<usize> {
+        (self.k != 0).then(|| self.k - self.rank)
+    }
+}
+
+/* -------------------- Decoder -------------------- */
+
+/* Decoded chunks that end beyond the receive limit */
+#[derive(Default)]
+struct Withheld {
+    chunks: Vec<(u64, Vec<u8>)>,
+    bytes: u64,
+}
+
+impl Withheld {
+    /* Queue a chunk for poll_ready, or hold it if it ends beyond limit */
+    fn place(&mut self, ready: &mut VecDeque<(u64, Vec<u8>)>, limit: u64, offset: u64, chunk: Vec<u8>) {
+        if offset + chunk.len() as u64 > limit {
+            self.bytes += chunk.len() as u64;
+            self.chunks.push((offset, chunk));
+        } else {
+            ready.push_back((offset, chunk));
+        }
+    }
+
+    /* Queue the held chunks that end within limit */
+    fn release(&mut self, ready: &mut VecDeque<(u64, Vec<u8>)>, limit: u64) {
+        let mut i = 0;
+        while i < self.chunks.len() {
+            let (offset, ref chunk) = self.chunks[i];
+            if offset + chunk.len() as u64 > limit {
+                i += 1;
+                continue;
+            }
+            let (offset, chunk) = self.chunks.swap_remove(i);
+            self.bytes -= chunk.len() as u64;
+            ready.push_back((offset, chunk));
+        }
+    }
+}
+
+struct Generation {
+    first_seen: u64,
+    /* end of the furthest source refused, 0 if none was */
+    refused_end: u64,
+    decoder: Box<dyn GenerationDecoder>,
+}
+
+pub struct Decoder {
+    mode: u32,
+    gens: HashMap<u32, Generation>,
+    done: BTreeSet<u32>,
+    newest: u32,
+    recovered: Vec<Vec<u8>>,
+    ready: VecDeque<(u64, Vec<u8>)>,
+    reack: BTreeSet<u32>,
+    feedback_pending: bool,
+    stats: FFIDecodeStats,
+    latencies: Vec<u64>,
+    completions: Vec<u64>,
+    recent: VecDeque<u64>,
+    recv_limit: u64,
+    /* limit of the latest feedback, None until one was taken */
+    advertised: Option<u64>,
+    /* end of the furthest source data accepted */
+    accepted_end: u64,
+    withheld: Withheld,
+}
+
+impl Decoder {
+    pub fn new() -> Decoder {
+        Decoder {
+            mode: DECODER_INCREMENTAL,
+            gens: HashMap::new(),
+            done: BTreeSet::new(),
+            newest: 0,
+            recovered: Vec::new(),
+            ready: VecDeque::new(),
+            reack: BTreeSet::new(),
+            feedback_pending: false,
+            stats: FFIDecodeStats::default(),
+            latencies: Vec::new(),
+            completions: Vec::new(),
+            recent: VecDeque::new(),
+            recv_limit: u64::MAX,
+            advertised: None,
+            accepted_end: 0,
+            withheld: Withheld::default(),
+        }
+    }
+
+    /* Takes effect from the next generation */
+    pub fn set_mode(&mut self, mode: u32) {
+        self.mode = mode;
+    }
+
+    /* Stream offset the receiver has room up to, u64::MAX if unbounded
+     * Held chunks within it become ready. The sender hears of the new
+     * limit once the room it knows of is smaller than the room that
+     * opened up, so a reader taking a few bytes at a time does not cost
+     * one feedback per read.
+    */
+    pub fn set_recv_limit(&mut self, limit: u64) {
+        self.recv_limit = limit;
+        self.withheld.release(&mut self.ready, limit);
+        if let Some(advertised) = self.advertised {
+            let known = advertised.saturating_sub(self.accepted_end);
+            if limit > advertised && limit - advertised > known {
+                self.feedback_pending = true;
+            }
+        }
+    }
+
+    /* Handle a source or repair symbol received at time now (ns)
+     * Returns the number of data chunks that became ready
+    */
+    pub fn on_symbol(&mut self, header: &FrameHeader, body: &[u8], now: u64) -> usize {
+        let started = Instant::now();
+        let before = self.ready.len();
+        let id = header.generation;
+        if self.done.contains(&id) {
+            if header.kind == codec::KIND_REPAIR {
+                self.reack.insert(id);
+                self.feedback_pending = true;
+            }
+            return 0;
+        }
+        if id > self.newest {
+            self.newest = id;
+            self.prune();
+        }
+
+        let mode = self.mode;
+        let generation = self.gens.entry(id).or_insert_with(|| Generation {
+            first_seen: now,
+            refused_end: 0,
+            decoder: match mode {
+                DECODER_BATCH => Box::new(BatchGeneration::default()),
+                _ => Box::new(IncrementalGeneration::default()),
+            },
+        });
+        let index = header.index as usize;
+        if header.kind == codec::KIND_SOURCE {
+            if generation.decoder.has_source(index) {
+                return 0;
+            }
+            if let Some((offset, data)) = codec::parse_source(body) {
+                let end = offset + data.len() as u64;
+                if end > self.recv_limit
+                    && self.withheld.bytes + data.len() as u64 > codec::INITIAL_WINDOW
+                {
+                    generation.refused_end = generation.refused_end.max(end);
+                    self.stats.refused += 1;
+                    self.feedback_pending = true;
+                    return 0;
+                }
+                self.accepted_end = self.accepted_end.max(end);
+                self.withheld.place(&mut self.ready, self.recv_limit, offset, copy(data));
+                // the sender holds back beyond INITIAL_WINDOW until it hears the limit
+                if self.advertised.is_none() {
+                    self.feedback_pending = true;
+                }
+            }
+            generation.decoder.on_source(id, index, body, &mut self.recovered);
+        } else if header.k != 0 {
+            if generation.refused_end > self.recv_limit {
+                self.stats.refused += 1;
+                self.feedback_pending = true;
+                return 0;
+            }
+            generation.decoder.on_repair(
+                id,
+                header.k as usize,
+                header.index,
+                body,
+                &mut self.recovered,
+            );
+        }
+
+        for symbol in self.recovered.drain(..) {
+            if let Some((offset, data)) = codec::parse_source(&symbol) {
+                self.withheld.place(&mut self.ready, self.recv_limit, offset, copy(data));
+                self.stats.recovered += 1;
+            }
+        }
+        if generation.decoder.is_decoded() {
+            let latency = now.saturating_sub(generation.first_seen);
+            self.finish(id, latency, started.elapsed().as_nanos() as u64);
+        } else if header.kind == codec::KIND_REPAIR {
+            // the repairs so far fell short, the sender wants to know by how much
+            self.feedback_pending = true;
+        }
+        self.ready.len() - before
+    }
+
+    fn finish(&mut self, id: u32, latency: u64, completion: u64) {
+        helix_log!(log::LOGIC, "generation {} decoded after {} ns", id, latency);
+        self.gens.remove(&id);
+        self.done.insert(id);
+        if self.done.len() > MAX_DONE {
+            let oldest = *self.done.iter().next().unwrap();
+            self.done.remove(&oldest);
+        }
+        self.feedback_pending = true;
+
+        // the sample buffers act as rings over the last MAX_SAMPLES generations
+        let slot = (self.stats.generations as usize) % MAX_SAMPLES;
+        if self.latencies.len() < MAX_SAMPLES {
+            self.latencies.push(latency);
+            self.completions.push(completion);
+        } else {
+            self.latencies[slot] = latency;
+            self.completions[slot] = completion;
+        }
+        self.stats.generations += 1;
+        if self.recent.len() == MAX_RECENT_LATENCIES {
+            self.recent.pop_front();
+        }
+        self.recent.push_back(latency);
+    }
+
+    fn prune(&mut self) {
+        let newest = self.newest;
+        self.gens
+            .retain(|&id, _| newest.wrapping_sub(id) <= MAX_GENERATION_LAG);
+    }
+
+    /* Next decoded chunk and its offset in the sender's byte stream,
+     * recovered chunks come after the ones received after them
+    */
+    pub fn poll_ready(&mut self) -> Option<(u64, Vec<u8>)> {
+        self.ready.pop_front()
+    }
+
+    /* Whether something happened that the sender has not heard about */
+    pub fn feedback_pending(&self) -> bool {
+        self.feedback_pending
+    }
+
+    /* Fill the generation lists of a feedback, the loss counters are left
+     * alone
+    */
+    pub fn take_feedback(&mut self, out: &mut Feedback) {
+        out.clear();
+        self.feedback_pending = false;
+        out.limit = self.recv_limit;
+        self.advertised = Some(self.recv_limit);
+
+        // older re-acks sort before the recent span, so ids come in order
+        let lo = self.newest.saturating_sub(FEEDBACK_SPAN);
+        let old = self.reack.range(..lo).copied();
+        for id in old.chain(self.done.range(lo..).copied()) {
+            match out.decoded.last_mut() {
+                Some((first, count)) if first.wrapping_add(*count) == id => *count += 1,
+                _ => out.decoded.push((id, 1)),
+            }
+        }
+        self.reack.clear();
+
+        for (&id, generation) in &self.gens {
+            match generation.decoder.missing() {
+                Some(missing) if missing > 0 => out.missing.push((id, missing as u32)),
+                _ => {}
+            }
+        }
+        out.missing.sort_unstable();
+        out.missing.truncate(MAX_FEEDBACK_MISSING);
+    }
+
+    /* Latency of the oldest generation decoded since the previous call */
+    pub fn poll_latency(&mut self) -> Option<u64> {
+        self.recent.pop_front()
+    }
+
+    pub fn stats(&self) -> FFIDecodeStats {
+        let mut stats = self.stats;
+        let mut latencies = self.latencies.clone();
+        let mut completions = self.completions.clone();
+        latencies.sort_unstable();
+        completions.sort_unstable();
+        stats.latency_p50 = percentile(&latencies, 50);
+        stats.latency_p90 = percentile(&latencies, 90);
+        stats.latency_p99 = percentile(&latencies, 99);
+        stats.latency_max = latencies.last().copied().unwrap_or(0);
+        stats.completion_p50 = percentile(&completions, 50);
+        stats.completion_p99 = percentile(&completions, 99);
+        stats.completion_max = completions.last().copied().unwrap_or(0);
+        stats
+    }
+}
+
+/* Nearest-rank percentile of sorted samples, 0 if there are none */
+fn percentile(sorted: &[u64], p: usize) -> u64 {
+    if sorted.is_empty() {
+        return 0;
+    }
+    let rank = (p * sorted.len() + 99) / 100;
+    sorted[rank.clamp(1, sorted.len()) - 1]
+}
+
+fn copy(data: &[u8]) -> Vec<u8> {
+    let mut v = pool::take_vec(data.len());
+    v.extend_from_slice(data);
+    v
+}
+
+impl Drop for Decoder {
+    fn drop(&mut self) {
+        for (_, chunk) in self.ready.drain(..).chain(self.withheld.chunks.drain(..)) {
+            pool::release_vec(chunk);
+        }
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    const K: usize = 4;
+    const LEN: usize = 20;
+
+    fn source_at(offset: u64, len: usize) -> Vec<u8> {
+        let mut body = Vec::new();
+        codec::write_source_prefix(&mut body, len as u16, offset);
+        body.extend((0..len).map(|i| (offset as usize + i * 7) as u8));
+        body
+    }
+
+    fn source(generation: u32, index: usize) -> Vec<u8> {
+        source_at(((generation as usize * K + index) * LEN) as u64, LEN)
+    }
+
+    fn repair(generation: u32, index: u16) -> Vec<u8> {
+        let mut coefficients = Vec::new();
+        codec::repair_coefficients(generation, index, K, &mut coefficients);
+        let mut body = vec![0u8; codec::SOURCE_PREFIX_LEN + LEN];
+        for (j, &c) in coefficients.iter().enumerate() {
+            gf256::mul_add_region(&mut body, &source(generation, j), c);
+        }
+        body
+    }
+
+    fn header(kind: u8, generation: u32, index: u16) -> FrameHeader {
+        FrameHeader {
+            kind,
+            generation,
+            k: K as u16,
+            index,
+            seq: 0,
+        }
+    }
+
+    fn feed_source(decoder: &mut Decoder, generation: u32, index: usize) -> usize {
+        let header = header(codec::KIND_SOURCE, generation, index as u16);
+        decoder.on_symbol(&header, &source(generation, index), 0)
+    }
+
+    fn feed_repair(decoder: &mut Decoder, generation: u32, index: u16) -> usize {
+        let header = header(codec::KIND_REPAIR, generation, index);
+        decoder.on_symbol(&header, &repair(generation, index), 0)
+    }
+
+    fn drain(decoder: &mut Decoder) -> Vec<(u64, Vec<u8>)> {
+        std::iter::from_fn(|| decoder.poll_ready()).collect()
+    }
+
+    /* (offset, data) of every source of a generation, in order */
+    fn expected(generation: u32) -> Vec<(u64, Vec<u8>)> {
+        (0..K)
+            .map(|i| {
+                let body = source(generation, i);
+                let (offset, data) = codec::parse_source(&body).unwrap();
+                (offset, data.to_vec())
+            })
+            .collect()
+    }
+
+    #[test]
+    fn lost_sources_are_recovered_by_either_decoder() {
+        for mode in [DECODER_INCREMENTAL, DECODER_BATCH] {
+            let mut decoder = Decoder::new();
+            decoder.set_mode(mode);
+            assert_eq!(feed_source(&mut decoder, 1, 0), 1);
+            assert_eq!(feed_source(&mut decoder, 1, 2), 1);
+            assert_eq!(feed_repair(&mut decoder, 1, 0), 0);
+            assert_eq!(feed_repair(&mut decoder, 1, 1), 2);
+
+            let mut chunks = drain(&mut decoder);
+            chunks.sort();
+            assert_eq!(chunks, expected(1));
+            let stats = decoder.stats();
+            assert_eq!(stats.recovered, 2);
+            assert_eq!(stats.generations, 1);
+        }
+    }
+
+    #[test]
+    fn duplicate_source_is_delivered_once() {
+        let mut decoder = Decoder::new();
+        assert_eq!(feed_source(&mut decoder, 0, 1), 1);
+        assert_eq!(feed_source(&mut decoder, 0, 1), 0);
+        assert_eq!(drain(&mut decoder).len(), 1);
+    }
+
+    #[test]
+    fn late_source_after_recovery_is_not_delivered_twice() {
+        // look for a generation whose first two repairs resolve one of
+        // the three missing sources on their own, before it decodes
+        for generation in 0..4096 {
+            let mut decoder = Decoder::new();
+            feed_source(&mut decoder, generation, 0);
+            feed_repair(&mut decoder, generation, 0);
+            if feed_repair(&mut decoder, generation, 1) == 0 {
+                continue;
+            }
+            let mut chunks = drain(&mut decoder);
+            let recovered = (chunks[1].0 / LEN as u64) as usize - generation as usize * K;
+
+            assert_eq!(feed_source(&mut decoder, generation, recovered), 0);
+            assert_eq!(decoder.stats().recovered, 1);
+            assert!(drain(&mut decoder).is_empty());
+
+            // one more source completes the generation
+            let next = (1..K).find(|&i| i != recovered).unwrap();
+            feed_source(&mut decoder, generation, next);
+            chunks.extend(drain(&mut decoder));
+            chunks.sort();
+            assert_eq!(chunks, expected(generation));
+            assert_eq!(decoder.stats().recovered, 2);
+            assert_eq!(decoder.stats().generations, 1);
+            return;
+        }
+        panic!("no generation resolves a source early");
+    }
+
+    #[test]
+    fn data_beyond_the_limit_waits_for_room() {
+        let mut decoder = Decoder::new();
+        decoder.set_recv_limit(2 * LEN as u64);
+        for i in 0..K {
+            feed_source(&mut decoder, 0, i);
+        }
+        assert_eq!(drain(&mut decoder), expected(0)[..2].to_vec());
+        decoder.set_recv_limit((K * LEN) as u64);
+        assert_eq!(drain(&mut decoder), expected(0)[2..].to_vec());
+    }
+
+    #[test]
+    fn source_beyond_the_initial_window_is_refused() {
+        let mut decoder = Decoder::new();
+        decoder.set_recv_limit(0);
+        let len = (codec::INITIAL_WINDOW / 2 + 1) as usize;
+        let first = header(codec::KIND_SOURCE, 0, 0);
+        assert_eq!(decoder.on_symbol(&first, &source_at(0, len), 0), 0);
+        let second = header(codec::KIND_SOURCE, 0, 1);
+        assert_eq!(decoder.on_symbol(&second, &source_at(len as u64, len), 0), 0);
+        assert_eq!(decoder.stats().refused, 1);
+
+        // the refused source is taken once the reader made room
+        decoder.set_recv_limit(2 * len as u64);
+        assert_eq!(drain(&mut decoder).len(), 1);
+        assert_eq!(decoder.on_symbol(&second, &source_at(len as u64, len), 0), 1);
+    }
+
+    #[test]
+    fn feedback_reports_limit_decoded_and_missing() {
+        let mut decoder = Decoder::new();
+        decoder.set_recv_limit(1000);
+        for i in 0..K {
+            feed_source(&mut decoder, 0, i);
+        }
+        feed_repair(&mut decoder, 0, 0);
+        feed_source(&mut decoder, 1, 0);
+        feed_repair(&mut decoder, 1, 0);
+        assert!(decoder.feedback_pending());
+
+        let mut feedback = Feedback::default();
+        decoder.take_feedback(&mut feedback);
+        assert!(!decoder.feedback_pending());
+        assert_eq!(feedback.limit, 1000);
+        assert_eq!(feedback.decoded, vec![(0, 1)]);
+        assert_eq!(feedback.missing, vec![(1, (K - 2) as u32)]);
+    }
+}
@@ -0,0 +1,473 @@
+/* Systematic streaming encoder
+ *
+ * Application data is cut into source symbols that go on the wire right
+ * away. Every generation_size symbols (or on flush) the generation is
+ * closed: a first round of repair symbols is queued and the generation
+ * is kept until the receiver acks it. Each repair_timeout without an ack
+ * queues another round of fresh repair symbols, so losses are repaired
+ * without retransmitting anything; a generation is given up after
+ * max_repair_rounds rounds. When the receiver reported how many degrees
+ * of freedom a generation misses, queued repairs beyond that are dropped
+ * and the next round is sized to it instead of to the generation.
+ *
+ * With an interleave depth d > 1, d generations are open at a time and
+ * consecutive source symbols go to them in turn, as do the repairs of a
+ * round. A burst of b lost frames then costs each generation about b / d
+ * symbols, which its repairs absorb, instead of wiping out one of them.
+ * The d generations close together once the last one is full.
+ *
+ * Data is only encoded up to the receive limit the receiver last
+ * reported, see send_room. A generation the receiver has no room for
+ * yet is not repaired round after round: each timeout sends a single
+ * probe repair, which brings back feedback with the current limit, and
+ * counts neither as a repair round nor as a loss. Once the limit covers
+ * the generation it gets a full round right away.
+ *
+ * The encoder also keeps the congestion signals of the sender: the bytes
+ * put on the wire for generations that were not acked yet, the bytes and
+ * round trip times of acked generations, and the repair rounds that had
+ * to be sent because the first round did not cover the losses. Frame
+ * losses the first round of repairs absorbed never show up here, the
+ * coding already recovered them.
+*/
+
+use crate::codec::{self, FrameHeader, HelixCodingConfig};
+use crate::gf256;
+use crate::log::{self, helix_log};
+use crate::pool;
+use std::collections::VecDeque;
+
+/* Congestion signals gathered since the previous sample
+ *
+ * acked_bytes and lost_bytes count the frames sent for generations that
+ * were acked or given up, in_flight the frames sent for generations
+ * still waiting for an ack. rtt_ns is the time from closing to acking the
+ * last generation acked without a repair round, 0 if there was none.
+ * repair_rounds counts the rounds that a timeout triggered, i.e. losses
+ * beyond what the first round repaired.
+*/
+#[repr(C)]
+#[derive(Clone, Copy, Default, Debug)]
+pub struct FFICongestionSample {
+    pub acked_bytes: u64,
+    pub lost_bytes: u64,
+    pub in_flight: u64,
+    pub rtt_ns: u64,
+    pub repair_rounds: u32,
+}
+
+struct Generation {
+    id: u32,
+    k: usize,
+    symbol_size: usize,
+    symbols: Vec<u8>,
+    next_repair: u16,
+    rounds: u32,
+    deadline: u64,
+    closed_at: u64,
+    sent: u64,
+    missing: Option<u32>,
+    round_repairs: usize,
+    /* end of the data of its source symbols in the stream */
+    end: u64,
+    /* beyond the receive limit at its latest timeout */
+    blocked: bool,
+    /* was blocked once, its acks say nothing about the rtt */
+    stalled: bool,
+}
+
+/* An open generation, lane i of the stripe is generation next_generation + i */
+#[derive(Default)]
+struct Lane {
+    symbols: Vec<u8>,
+    count: usize,
+    sent: u64,
+    end: u64,
+}
+
+pub struct Encoder {
+    config: HelixCodingConfig,
+    next_generation: u32,
+    lanes: Vec<Lane>,
+    open_count: usize,
+    unacked: VecDeque<Generation>,
+    due: Vec<usize>,
+    spare: Vec<Vec<u8>>,
+    coefficients: Vec<u8>,
+    next_offset: u64,
+    tx: VecDeque<Vec<u8>>,
+    sample: FFICongestionSample,
+    peer_limit: Option<u64>,
+}
+
+impl Encoder {
+    pub fn new(config: HelixCodingConfig) -> Encoder {
+        Encoder {
+            config,
+            next_generation: 0,
+            lanes: Vec::new(),
+            open_count: 0,
+            unacked: VecDeque::new(),
+            due: Vec::new(),
+            spare: Vec::new(),
+            coefficients: Vec::new(),
+            next_offset: 0,
+            tx: VecDeque::new(),
+            sample: FFICongestionSample::default(),
+            peer_limit: None,
+        }
+    }
+
+    /* Takes effect from the next generation, the open ones keep their
+     * symbol size and interleave depth
+    */
+    pub fn configure(&mut self, mut config: HelixCodingConfig) {
+        if self.open_count != 0 {
+            config.symbol_size = self.config.symbol_size;
+        }
+        self.config = config;
+    }
+
+    /* Cut data into source symbols and queue them */
+    pub fn push(&mut self, data: &[u8], now: u64) {
+        let cap = self.config.data_per_symbol();
+        for chunk in data.chunks(cap) {
+            self.push_symbol(chunk, now);
+        }
+    }
+
+    fn push_symbol(&mut self, chunk: &[u8], now: u64) {
+        let symbol_size = self.config.symbol_size as usize;
+        if self.open_count == 0 {
+            self.open_stripe();
+        }
+        let depth = self.lanes.len();
+        let lane_index = self.open_count % depth;
+        let lane = &mut self.lanes[lane_index];
+
+        // the padded symbol is kept for repairs, only the used part is sent
+        let start = lane.symbols.len();
+        codec::write_source_prefix(&mut lane.symbols, chunk.len() as u16, self.next_offset);
+        lane.symbols.extend_from_slice(chunk);
+        let used = lane.symbols.len() - start;
+        lane.symbols.resize(start + symbol_size, 0);
+
+        let mut frame = pool::take_vec(codec::HEADER_LEN + used);
+        FrameHeader {
+            kind: codec::KIND_SOURCE,
+            generation: self.next_generation.wrapping_add(lane_index as u32),
+            k: 0,
+            index: lane.count as u16,
+            seq: 0,
+        }
+        .write(&mut frame);
+        frame.extend_from_slice(&lane.symbols[start..start + used]);
+        self.tx.push_back(frame);
+
+        lane.count += 1;
+        self.next_offset += chunk.len() as u64;
+        lane.end = self.next_offset;
+        self.open_count += 1;
+        if self.open_count >= depth * self.config.generation_size as usize {
+            self.close_stripe(now);
+        }
+    }
+
+    fn open_stripe(&mut self) {
+        let depth = self.config.interleave_depth.max(1) as usize;
+        self.lanes.resize_with(depth, Lane::default);
+        for lane in self.lanes.iter_mut() {
+            lane.symbols = self.spare.pop().unwrap_or_default();
+            lane.symbols.clear();
+        }
+    }
+
+    /* Close the open generations even if they are not full */
+    pub fn flush(&mut self, now: u64) {
+        self.close_stripe(now);
+    }
+
+    fn close_stripe(&mut self, now: u64) {
+        if self.open_count == 0 {
+            return;
+        }
+        let symbol_size = self.config.symbol_size as usize;
+        let first = self.unacked.len();
+        // lanes fill in turn, the ones that got symbols are a prefix
+        for (i, lane) in self.lanes.iter_mut().enumerate() {
+            if lane.count == 0 {
+                self.spare.push(std::mem::take(&mut lane.symbols));
+                continue;
+            }
+            self.unacked.push_back(Generation {
+                id: self.next_generation.wrapping_add(i as u32),
+                k: lane.count,
+                symbol_size,
+                symbols: std::mem::take(&mut lane.symbols),
+                next_repair: lane.count as u16,
+                rounds: 0,
+                deadline: now.saturating_add(self.config.repair_timeout_ns),
+                closed_at: now,
+                sent: std::mem::take(&mut lane.sent),
+                missing: None,
+                round_repairs: self.config.repairs_per_round(lane.count),
+                end: lane.end,
+                blocked: false,
+                stalled: false,
+            });
+            lane.count = 0;
+            self.due.push(self.unacked.len() - 1);
+        }
+        self.next_generation = self.next_generation.wrapping_add((self.unacked.len() - first) as u32);
+        self.open_count = 0;
+
+        for generation in self.unacked.range(first..) {
+            helix_log!(
+                log::LOGIC,
+                "closed generation {} with {} symbols, {} repairs",
+                generation.id,
+                generation.k,
+                generation.round_repairs
+            );
+        }
+        self.queue_rounds();
+    }
+
+    /* Queue a round of repairs for the generations at the due positions
+     * of unacked, one repair of each in turn
+    */
+    fn queue_rounds(&mut self) {
+        let mut round = 0;
+        loop {
+            let mut queued = false;
+            for &i in &self.due {
+                let generation = &mut self.unacked[i];
+                if round < generation.round_repairs {
+                    self.tx.push_back(repair_frame(generation, &mut self.coefficients));
+                    queued = true;
+                }
+            }
+            if !queued {
+                break;
+            }
+            round += 1;
+        }
+        self.due.clear();
+    }
+
+    /* The receiver reported count generations from first decoded at
+     * time now (ns)
+    */
+    pub fn on_decoded(&mut self, first: u32, count: u32, now: u64) {
+        while let Some(pos) = self.unacked.iter().position(|g| g.id.wrapping_sub(first) < count) {
+            let generation = self.unacked.remove(pos).unwrap();
+            helix_log!(log::LOGIC, "generation {} acked", generation.id);
+            // an ack after a repair round is ambiguous about which round
+            // completed it, only first round acks give rtt samples
+            if generation.rounds == 0 && !generation.stalled {
+                self.sample.rtt_ns = now.saturating_sub(generation.closed_at);
+            }
+            self.sample.acked_bytes += generation.sent;
+            self.sample.in_flight = self.sample.in_flight.saturating_sub(generation.sent);
+            self.drop_queued(generation.id, 0);
+            self.spare.push(generation.symbols);
+        }
+    }
+
+    /* The receiver reported a generation missing that many degrees of
+     * freedom, queued repairs beyond them would only be wasted
+    */
+    pub fn on_missing(&mut self, id: u32, missing: u32) {
+        if let Some(generation) = self.unacked.iter_mut().find(|g| g.id == id) {
+            generation.missing = Some(missing);
+            self.drop_queued(id, missing as usize);
+        }
+    }
+
+    /* The receiver reported room up to stream offset limit at time now
+     * (ns), the generations it covers that were blocked are repaired
+     * right away
+    */
+    pub fn set_peer_limit(&mut self, limit: u64, now: u64) {
+        // the limit only grows, a smaller one comes from reordered feedback
+        if self.peer_limit.map_or(false, |known| limit < known) {
+            return;
+        }
+        self.peer_limit = Some(limit);
+        for generation in self.unacked.iter_mut() {
+            if generation.blocked && generation.end <= limit {
+                generation.deadline = now;
+            }
+        }
+    }
+
+    /* Bytes push may still take before the data runs past the receive
+     * limit, INITIAL_WINDOW in all until the receiver reported one
+    */
+    pub fn send_room(&self) -> u64 {
+        self.peer_limit
+            .unwrap_or(codec::INITIAL_WINDOW)
+            .saturating_sub(self.next_offset)
+    }
+
+    /* Drop the queued frames of a generation but the first keep ones */
+    fn drop_queued(&mut self, id: u32, keep: usize) {
+        if self.tx.iter().filter(|f| codec::frame_generation(f) == id).count() <= keep {
+            return;
+        }
+        let mut kept = 0;
+        for frame in std::mem::take(&mut self.tx) {
+            if codec::frame_generation(&frame) != id {
+                self.tx.push_back(frame);
+            } else if kept < keep {
+                kept += 1;
+                self.tx.push_back(frame);
+            } else {
+                pool::release_vec(frame);
+            }
+        }
+    }
+
+    /* Earliest repair deadline, u64::MAX if nothing waits for an ack */
+    pub fn next_timeout(&self) -> u64 {
+        self.unacked.iter().map(|g| g.deadline).min().unwrap_or(u64::MAX)
+    }
+
+    /* Queue another repair round for every generation past its deadline */
+    pub fn on_timeout(&mut self, now: u64) {
+        for mut generation in std::mem::take(&mut self.unacked) {
+            if generation.deadline > now {
+                self.unacked.push_back(generation);
+                continue;
+            }
+            // what was sent got no ack because the receiver had no room,
+            // not because it was lost
+            let blocked = generation.end > self.peer_limit.unwrap_or(u64::MAX);
+            if blocked || generation.blocked {
+                self.sample.in_flight = self.sample.in_flight.saturating_sub(generation.sent);
+                generation.sent = 0;
+                generation.blocked = blocked;
+                generation.stalled = true;
+                generation.deadline = now.saturating_add(self.config.repair_timeout_ns);
+                generation.round_repairs = match generation.missing.take() {
+                    Some(missing) => {
+                        missing as usize + self.config.repairs_per_round(missing as usize)
+                    }
+                    None if blocked => 1,
+                    None => self.config.repairs_per_round(generation.k),
+                };
+                self.due.push(self.unacked.len());
+                self.unacked.push_back(generation);
+                continue;
+            }
+            if generation.rounds >= self.config.max_repair_rounds {
+                helix_log!(
+                    log::WARN,
+                    "giving up on generation {} after {} repair rounds",
+                    generation.id,
+                    generation.rounds
+                );
+                self.sample.lost_bytes += generation.sent;
+                self.sample.in_flight = self.sample.in_flight.saturating_sub(generation.sent);
+                self.drop_queued(generation.id, 0);
+                self.spare.push(generation.symbols);
+                continue;
+            }
+            // like a tcp rto, what was sent before the deadline is taken
+            // as lost so the repairs of this round fit in the window
+            self.sample.lost_bytes += generation.sent;
+            self.sample.in_flight = self.sample.in_flight.saturating_sub(generation.sent);
+            self.sample.repair_rounds += 1;
+            generation.sent = 0;
+            generation.rounds += 1;
+            generation.deadline = now.saturating_add(self.config.repair_timeout_ns);
+            // a reported deficit, with the usual margin for loss, beats a
+            // round sized for the whole generation
+            generation.round_repairs = match generation.missing.take() {
+                Some(missing) => missing as usize + self.config.repairs_per_round(missing as usize),
+                None => self.config.repairs_per_round(generation.k),
+            };
+            self.due.push(self.unacked.len());
+            self.unacked.push_back(generation);
+        }
+        self.queue_rounds();
+    }
+
+    /* Generations closed but not acked yet */
+    pub fn pending_generations(&self) -> usize {
+        self.unacked.len()
+    }
+
+    /* Frames queued but not handed out by poll_transmit yet */
+    pub fn queued_frames(&self) -> usize {
+        self.tx.len()
+    }
+
+    /* Whether source symbols are waiting for their generation to close */
+    pub fn has_open_generation(&self) -> bool {
+        self.open_count != 0
+    }
+
+    /* Next frame to send, None if none is queued or in_flight already
+     * reached window bytes
+    */
+    pub fn poll_transmit(&mut self, window: u64) -> Option<Vec<u8>> {
+        if self.sample.in_flight >= window {
+            return None;
+        }
+        let frame = self.tx.pop_front()?;
+        let len = frame.len() as u64;
+        let id = codec::frame_generation(&frame);
+        let lane = id.wrapping_sub(self.next_generation) as usize;
+        if lane < self.lanes.len() {
+            self.lanes[lane].sent += len;
+        } else if let Some(generation) = self.unacked.iter_mut().rev().find(|g| g.id == id) {
+            generation.sent += len;
+        }
+        self.sample.in_flight += len;
+        Some(frame)
+    }
+
+    /* Congestion signals since the previous call */
+    pub fn take_congestion_sample(&mut self) -> FFICongestionSample {
+        let sample = self.sample;
+        self.sample = FFICongestionSample {
+            in_flight: sample.in_flight,
+            ..FFICongestionSample::default()
+        };
+        sample
+    }
+}
+
+/* Next repair symbol of a generation, coefficients is scratch space */
+fn repair_frame(generation: &mut Generation, coefficients: &mut Vec<u8>) -> Vec<u8> {
+    let symbol_size = generation.symbol_size;
+    let index = generation.next_repair;
+    generation.next_repair = generation.next_repair.wrapping_add(1).max(generation.k as u16);
+    codec::repair_coefficients(generation.id, index, generation.k, coefficients);
+
+    let mut frame = pool::take_vec(codec::HEADER_LEN + symbol_size);
+    FrameHeader {
+        kind: codec::KIND_REPAIR,
+        generation: generation.id,
+        k: generation.k as u16,
+        index,
+        seq: 0,
+    }
+    .write(&mut frame);
+    frame.resize(codec::HEADER_LEN + symbol_size, 0);
+
+    let body = &mut frame[codec::HEADER_LEN..];
+    for (j, symbol) in generation.symbols.chunks(symbol_size).enumerate() {
+        gf256::mul_add_region(body, symbol, coefficients[j]);
+    }
+    frame
+}
+
+impl Drop for Encoder {
+    fn drop(&mut self) {
+        for frame in self.tx.drain(..) {
+            pool::release_vec(frame);
+        }
+    }
+}
@@ -0,0 +1,409 @@
+/* GF(2^8) arithmetic for the HELIX erasure code
+ *
+ * Field polynomial x^8 + x^4 + x^3 + x^2 + 1 (0x11d), generator 2.
+ * Region kernels multiply a whole symbol by a coefficient using split
+ * nibble lookups, c * x = lo[x & 0xf] ^ hi[x >> 4], so one byte shuffle
+ * performs 16, 32 or 64 table lookups at once (SSSE3, AVX2, AVX-512BW).
+ * The scalar kernel uses the same two tables and is the portable
+ * fallback. The kernel is picked once from the CPU features.
+*/
+
+use crate::log::{self, helix_log};
+use std::sync::OnceLock;
+
+const POLY: u16 = 0x11d;
+
+struct Tables {
+    exp: [u8; 512],
+    log: [u8; 256],
+}
+
+const fn build_tables() -> Tables {
+    let mut exp = [0u8; 512];
+    let mut log = [0u8; 256];
+    let mut x: u16 = 1;
+    let mut i = 0;
+    while i < 255 {
+        exp[i] = x as u8;
+        exp[i + 255] = x as u8;
+        log[x as usize] = i as u8;
+        x <<= 1;
+        if x & 0x100 != 0 {
+            x ^= POLY;
+        }
+        i += 1;
+    }
+    exp[510] = exp[255];
+    exp[511] = exp[256];
+    Tables { exp, log }
+}
+
+static TABLES: Tables = build_tables();
+
+const fn const_mul(a: u8, b: u8) -> u8 {
+    if a == 0 || b == 0 {
+        return 0;
+    }
+    TABLES.exp[TABLES.log[a as usize] as usize + TABLES.log[b as usize] as usize]
+}
+
+/* Split nibble tables of every coefficient
+ * NIBBLES[c][0..16] = c * i, NIBBLES[c][16..32] = c * (i << 4)
+*/
+const fn build_nibbles() -> [[u8; 32]; 256] {
+    let mut t = [[0u8; 32]; 256];
+    let mut c = 0;
+    while c < 256 {
+        let mut i = 0;
+        while i < 16 {
+            t[c][i] = const_mul(c as u8, i as u8);
+            t[c][16 + i] = const_mul(c as u8, (i << 4) as u8);
+            i += 1;
+        }
+        c += 1;
+    }
+    t
+}
+
+static NIBBLES: [[u8; 32]; 256] = build_nibbles();
+
+#[inline]
+pub fn mul(a: u8, b: u8) -> u8 {
+    const_mul(a, b)
+}
+
+/* Multiplicative inverse
+ * Panics on 0
+*/
+#[inline]
+pub fn inv(a: u8) -> u8 {
+    assert!(a != 0, "0 has no inverse in GF(2^8)");
+    TABLES.exp[255 - TABLES.log[a as usize] as usize]
+}
+
+/* a to the power n, used to build Vandermonde coefficients */
+#[inline]
+pub fn pow(a: u8, n: usize) -> u8 {
+    if a == 0 {
+        return if n == 0 { 1 } else { 0 };
+    }
+    TABLES.exp[(TABLES.log[a as usize] as usize * n) % 255]
+}
+
+#[derive(Clone, Copy, PartialEq, Eq, Debug)]
+pub enum Kernel {
+    Scalar,
+    Ssse3,
+    Avx2,
+    Avx512,
+}
+
+impl Kernel {
+    pub const ALL: [Kernel; 4] = [Kernel::Scalar, Kernel::Ssse3, Kernel::Avx2, Kernel::Avx512];
+
+    pub fn name(self) -> &'static str {
+        match self {
+            Kernel::Scalar => "scalar",
+            Kernel::Ssse3 => "ssse3",
+            Kernel::Avx2 => "avx2",
+            Kernel::Avx512 => "avx512",
+        }
+    }
+
+    pub fn is_supported(self) -> bool {
+        match self {
+            Kernel::Scalar => true,
+            #[cfg(any(target_arch = "x86", target_arch = "x86_64"))]
+            Kernel::Ssse3 => is_x86_feature_detected!("ssse3"),
+            #[cfg(any(target_arch = "x86", target_arch = "x86_64"))]
+            Kernel::Avx2 => is_x86_feature_detected!("avx2"),
+            #[cfg(any(target_arch = "x86", target_arch = "x86_64"))]
+            Kernel::Avx512 => {
+                is_x86_feature_detected!("avx512f") && is_x86_feature_detected!("avx512bw")
+            }
+            #[cfg(not(any(target_arch = "x86", target_arch = "x86_64")))]
+            _ => false,
+        }
+    }
+}
+
+static ACTIVE: OnceLock<Kernel> = OnceLock::new();
+
+/* The kernel used by mul_region and mul_add_region
+ * Detected on first use, the widest supported kernel wins
+*/
+pub fn active() -> Kernel {
+    *ACTIVE.get_or_init(|| {
+        let kernel = Kernel::ALL
+            .iter()
+            .rev()
+            .copied()
+            .find(|k| k.is_supported())
+            .unwrap_or(Kernel::Scalar);
+        helix_log!(log::INFO, "GF(2^8) kernel: {}", kernel.name());
+        kernel
+    })
+}
+
+/* dst ^= c * src */
+#[inline]
+pub fn mul_add_region(dst: &mut [u8], src: &[u8], c: u8) {
+    mul_add_region_with(active(), dst, src, c);
+}
+
+/* dst = c * dst */
+#[inline]
+pub fn mul_region(dst: &mut [u8], c: u8) {
+    mul_region_with(active(), dst, c);
+}
+
+/* dst ^= c * src with a given kernel
+ * Panics if the kernel is not supported by this CPU
+*/
+pub fn mul_add_region_with(kernel: Kernel, dst: &mut [u8], src: &[u8], c: u8) {
+    let n = dst.len().min(src.len());
+    match c {
+        0 => {}
+        1 => xor_region(&mut dst[..n], &src[..n]),
+        _ => unsafe {
+            region::<true>(kernel, dst.as_mut_ptr(), src.as_ptr(), n, &NIBBLES[c as usize])
+        },
+    }
+}
+
+/* dst = c * dst with a given kernel
+ * Panics if the kernel is not supported by this CPU
+*/
+pub fn mul_region_with(kernel: Kernel, dst: &mut [u8], c: u8) {
+    match c {
+        0 => dst.fill(0),
+        1 => {}
+        // the kernels load each block of src before storing it to dst
+        _ => unsafe {
+            let p = dst.as_mut_ptr();
+            region::<false>(kernel, p, p, dst.len(), &NIBBLES[c as usize])
+        },
+    }
+}
+
+/* dst ^= src, left to the auto-vectorizer */
+#[inline]
+pub fn xor_region(dst: &mut [u8], src: &[u8]) {
+    for (d, s) in dst.iter_mut().zip(src) {
+        *d ^= *s;
+    }
+}
+
+/* Multiply len bytes of src into dst
+ * dst and src are either disjoint or equal
+*/
+unsafe fn region<const ACC: bool>(
+    kernel: Kernel,
+    dst: *mut u8,
+    src: *const u8,
+    len: usize,
+    t: &[u8; 32],
+) {
+    assert!(kernel.is_supported(), "GF(2^8) kernel {} not supported", kernel.name());
+    match kernel {
+        Kernel::Scalar => scalar::<ACC>(dst, src, len, t),
+        #[cfg(target_arch = "x86_64")]
+        Kernel::Ssse3 => x86::ssse3::<ACC>(dst, src, len, t),
+        #[cfg(target_arch = "x86_64")]
+        Kernel::Avx2 => x86::avx2::<ACC>(dst, src, len, t),
+        #[cfg(target_arch = "x86_64")]
+        Kernel::Avx512 => x86::avx512::<ACC>(dst, src, len, t),
+        #[cfg(not(target_arch = "x86_64"))]
+        _ => scalar::<ACC>(dst, src, len, t),
+    }
+}
+
+#[inline]
+unsafe fn scalar<const ACC: bool>(dst: *mut u8, src: *const u8, len: usize, t: &[u8; 32]) {
+    for i in 0..len {
+        let s = *src.add(i);
+        let p = t[(s & 0x0f) as usize] ^ t[16 + (s >> 4) as usize];
+        *dst.add(i) = if ACC { *dst.add(i) ^ p } else { p };
+    }
+}
+
+#[cfg(target_arch = "x86_64")]
+mod x86 {
+    use std::arch::x86_64::*;
+
+    #[target_feature(enable = "ssse3")]
+    pub unsafe fn ssse3<const ACC: bool>(dst: *mut u8, src: *const u8, len: usize, t: &[u8; 32]) {
+        let lo = _mm_loadu_si128(t.as_ptr() as *const __m128i);
+        let hi = _mm_loadu_si128(t.as_ptr().add(16) as *const __m128i);
+        let mask = _mm_set1_epi8(0x0f);
+        let n = len & !15;
+        let mut i = 0;
+        while i < n {
+            let x = _mm_loadu_si128(src.add(i) as *const __m128i);
+            let l = _mm_and_si128(x, mask);
+            let h = _mm_and_si128(_mm_srli_epi64(x, 4), mask);
+            let mut p = _mm_xor_si128(_mm_shuffle_epi8(lo, l), _mm_shuffle_epi8(hi, h));
+            if ACC {
+                p = _mm_xor_si128(p, _mm_loadu_si128(dst.add(i) as *const __m128i));
+            }
+            _mm_storeu_si128(dst.add(i) as *mut __m128i, p);
+            i += 16;
+        }
+        super::scalar::<ACC>(dst.add(n), src.add(n), len - n, t);
+    }
+
+    #[target_feature(enable = "avx2")]
+    pub unsafe fn avx2<const ACC: bool>(dst: *mut u8, src: *const u8, len: usize, t: &[u8; 32]) {
+        let lo = _mm256_broadcastsi128_si256(_mm_loadu_si128(t.as_ptr() as *const __m128i));
+        let hi =
+            _mm256_broadcastsi128_si256(_mm_loadu_si128(t.as_ptr().add(16) as *const __m128i));
+        let mask = _mm256_set1_epi8(0x0f);
+        let n = len & !31;
+        let mut i = 0;
+        while i < n {
+            let x = _mm256_loadu_si256(src.add(i) as *const __m256i);
+            let l = _mm256_and_si256(x, mask);
+            let h = _mm256_and_si256(_mm256_srli_epi64(x, 4), mask);
+            let mut p =
+                _mm256_xor_si256(_mm256_shuffle_epi8(lo, l), _mm256_shuffle_epi8(hi, h));
+            if ACC {
+                p = _mm256_xor_si256(
+                    p,
+                    _mm256_loadu_si256(dst.add(i) as *const __m256i),
+                );
+            }
+            _mm256_storeu_si256(dst.add(i) as *mut __m256i, p);
+            i += 32;
+        }
+        super::scalar::<ACC>(dst.add(n), src.add(n), len - n, t);
+    }
+
+    #[target_feature(enable = "avx512f,avx512bw")]
+    pub unsafe fn avx512<const ACC: bool>(dst: *mut u8, src: *const u8, len: usize, t: &[u8; 32]) {
+        let lo = _mm512_broadcast_i32x4(_mm_loadu_si128(t.as_ptr() as *const __m128i));
+        let hi = _mm512_broadcast_i32x4(_mm_loadu_si128(t.as_ptr().add(16) as *const __m128i));
+        let mask = _mm512_set1_epi8(0x0f);
+        let n = len & !63;
+        let mut i = 0;
+        while i < n {
+            let x = _mm512_loadu_si512(src.add(i) as *const _);
+            let l = _mm512_and_si512(x, mask);
+            let h = _mm512_and_si512(_mm512_srli_epi64(x, 4), mask);
+            let mut p =
+                _mm512_xor_si512(_mm512_shuffle_epi8(lo, l), _mm512_shuffle_epi8(hi, h));
+            if ACC {
+                p = _mm512_xor_si512(p, _mm512_loadu_si512(dst.add(i) as *const _));
+            }
+            _mm512_storeu_si512(dst.add(i) as *mut _, p);
+            i += 64;
+        }
+        super::scalar::<ACC>(dst.add(n), src.add(n), len - n, t);
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    const LENGTHS: [usize; 8] = [0, 1, 15, 31, 63, 64, 65, 129];
+    const COEFFICIENTS: [u8; 5] = [0, 1, 2, 0x53, 255];
+
+    /* Shift and add multiplication, independent of the tables */
+    fn slow_mul(mut a: u8, mut b: u8) -> u8 {
+        let mut p = 0u8;
+        while b != 0 {
+            if b & 1 != 0 {
+                p ^= a;
+            }
+            let carry = a & 0x80 != 0;
+            a <<= 1;
+            if carry {
+                a ^= (POLY & 0xff) as u8;
+            }
+            b >>= 1;
+        }
+        p
+    }
+
+    fn pattern(len: usize, seed: u8) -> Vec<u8> {
+        (0..len).map(|i| (i as u8).wrapping_mul(97).wrapping_add(seed)).collect()
+    }
+
+    fn supported() -> Vec<Kernel> {
+        let kernels: Vec<Kernel> =
+            Kernel::ALL.iter().copied().filter(|k| k.is_supported()).collect();
+        assert!(kernels.contains(&active()));
+        kernels
+    }
+
+    #[test]
+    fn mul_matches_shift_and_add() {
+        for a in 0..=255u8 {
+            for b in 0..=255u8 {
+                assert_eq!(mul(a, b), slow_mul(a, b), "{} * {}", a, b);
+            }
+        }
+    }
+
+    #[test]
+    fn inverse_and_powers() {
+        for a in 1..=255u8 {
+            assert_eq!(mul(a, inv(a)), 1, "inv({})", a);
+            assert_eq!(pow(a, 255), 1);
+            assert_eq!(pow(a, 0), 1);
+            assert_eq!(pow(a, 1), a);
+        }
+        assert_eq!(pow(0, 0), 1);
+        assert_eq!(pow(0, 3), 0);
+
+        // 2 generates the multiplicative group, log and exp invert each other
+        let mut seen = [false; 256];
+        for i in 0..255 {
+            let x = pow(2, i);
+            assert!(!seen[x as usize], "2^{} repeats", i);
+            seen[x as usize] = true;
+            assert_eq!(TABLES.exp[i], x);
+            assert_eq!(TABLES.log[x as usize] as usize, i);
+            assert_eq!(TABLES.exp[i + 255], x);
+        }
+    }
+
+    #[test]
+    fn kernels_match_scalar_mul_add() {
+        for kernel in supported() {
+            for &len in &LENGTHS {
+                for &c in &COEFFICIENTS {
+                    let src = pattern(len, 11);
+                    let mut expected = pattern(len, 200);
+                    mul_add_region_with(Kernel::Scalar, &mut expected, &src, c);
+                    for (i, e) in expected.iter().enumerate() {
+                        assert_eq!(*e, pattern(len, 200)[i] ^ slow_mul(c, src[i]));
+                    }
+
+                    let mut dst = pattern(len, 200);
+                    mul_add_region_with(kernel, &mut dst, &src, c);
+                    assert_eq!(dst, expected, "{} len {} c {}", kernel.name(), len, c);
+                }
+            }
+        }
+    }
+
+    #[test]
+    fn kernels_match_scalar_mul() {
+        for kernel in supported() {
+            for &len in &LENGTHS {
+                for &c in &COEFFICIENTS {
+                    let mut expected = pattern(len, 5);
+                    mul_region_with(Kernel::Scalar, &mut expected, c);
+                    let reference: Vec<u8> =
+                        pattern(len, 5).iter().map(|&x| slow_mul(c, x)).collect();
+                    assert_eq!(expected, reference);
+
+                    let mut dst = pattern(len, 5);
+                    mul_region_with(kernel, &mut dst, c);
+                    assert_eq!(dst, expected, "{} len {} c {}", kernel.name(), len, c);
+                }
+            }
+        }
+    }
+}
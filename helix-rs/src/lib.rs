@@ -1,6 +1,27 @@
 #![feature(vec_into_raw_parts)]
 #![crate_type = "cdylib"]
 
+pub mod codec;
+mod connection;
+mod decoder;
+mod encoder;
+pub mod gf256;
+mod log;
+mod pool;
+
+use log::helix_log;
+
+pub use codec::{FFILossFeedback, HelixCodingConfig};
+pub use connection::HelixConnection;
+pub use decoder::FFIDecodeStats;
+pub use encoder::FFICongestionSample;
+pub use pool::FFIPoolStats;
+
+/* Buffer shared across the FFI
+ * When state is null the buffer is a read-only view lent by C++ for the
+ * duration of the call, Rust must neither free it nor keep it.
+ * Otherwise state holds the capacity of a Rust-owned Vec.
+*/
 #[repr(C)]
 pub struct FFISharedBuffer {
     ptr: *mut u8,
@@ -8,101 +29,478 @@ pub struct FFISharedBuffer {
     state: *mut (),
 }
 
+impl FFISharedBuffer {
+    pub fn empty() -> FFISharedBuffer {
+        FFISharedBuffer {
+            ptr: std::ptr::null_mut(),
+            len: 0,
+            state: std::ptr::null_mut(),
+        }
+    }
+
+    pub fn as_slice(&self) -> &[u8] {
+        if self.ptr.is_null() {
+            return &[];
+        }
+        unsafe { std::slice::from_raw_parts(self.ptr, self.len) }
+    }
+
+    /* Writable view of a Rust-owned buffer, empty for a view lent by C++ */
+    pub fn as_mut_slice(&mut self) -> &mut [u8] {
+        if self.ptr.is_null() || self.state.is_null() {
+            return &mut [];
+        }
+        unsafe { std::slice::from_raw_parts_mut(self.ptr, self.len) }
+    }
+}
+
 #[no_mangle]
 pub extern "C" fn helix_rs_create_vec() -> FFISharedBuffer {
-    let (ptr, len, cap) = (vec![0; 42]).into_raw_parts();
-    FFISharedBuffer {
-        ptr,
-        len,
-        state: cap as *mut (),
-    }
+    pool::acquire(42)
+}
+
+/* Add the buffer pool size classes of a symbol size
+ * Classes are multiples of symbol_size and sit next to those of the other
+ * symbol sizes in use, only the least recently configured sizes lose
+ * theirs
+*/
+#[no_mangle]
+pub extern "C" fn helix_rs_pool_configure(symbol_size: usize) {
+    pool::configure(symbol_size);
+}
+
+/* Take a buffer of len bytes from the pool
+ * Returns a Rust-owned FFISharedBuffer, give it back with helix_rs_buffer_release
+*/
+#[no_mangle]
+pub extern "C" fn helix_rs_buffer_acquire(len: usize) -> FFISharedBuffer {
+    pool::acquire(len)
+}
+
+/* Give a buffer back to the pool
+ * Borrowed views (null state) are ignored
+*/
+#[no_mangle]
+pub extern "C" fn helix_rs_buffer_release(buffer: FFISharedBuffer) {
+    pool::release(buffer);
+}
+
+/* Pool hit/miss/high-water statistics
+ * Returns FFIPoolStats
+*/
+#[no_mangle]
+pub extern "C" fn helix_rs_pool_stats() -> FFIPoolStats {
+    pool::stats()
+}
+
+/* Route helix-rs logging to a C++ callback
+ * mask holds the ns-3 LogLevel bits to forward, a null callback turns
+ * logging off
+ * Returns void
+*/
+#[no_mangle]
+pub extern "C" fn helix_rs_set_log_callback(callback: Option<log::LogCallback>, mask: u32) -> () {
+    log::set_callback(callback, mask);
+}
+
+/* Change the forwarded ns-3 LogLevel bits without touching the callback
+ * Returns void
+*/
+#[no_mangle]
+pub extern "C" fn helix_rs_set_log_mask(mask: u32) -> () {
+    log::set_mask(mask);
 }
 
 // c++ wrapper for every function
 // focus on creating interface
 
+unsafe fn conn_mut<'a>(conn: *mut HelixConnection) -> Option<&'a mut HelixConnection> {
+    conn.as_mut()
+}
+
+unsafe fn address_slice<'a>(address: *const u8, len: usize) -> &'a [u8] {
+    if address.is_null() {
+        return &[];
+    }
+    std::slice::from_raw_parts(address, len)
+}
+
 
 /* Create a socket
- * Returns u8
+ * Returns an opaque handle that scopes every other call to this socket,
+ * free it with helix_rs_destroy_socket
 */
 #[no_mangle]
-pub extern "C" fn helix_rs_create_socket() -> u8 {
-    println!("HELIX - RS: Create Socket");
-    return 0;
+pub extern "C" fn helix_rs_create_socket() -> *mut HelixConnection {
+    helix_log!(log::FUNCTION, "Create Socket");
+    Box::into_raw(Box::new(HelixConnection::new()))
+}
+
+/* Destroy a socket created by helix_rs_create_socket
+ * Returns void
+*/
+#[no_mangle]
+pub extern "C" fn helix_rs_destroy_socket(conn: *mut HelixConnection) -> () {
+    helix_log!(log::FUNCTION, "Destroy Socket");
+    if !conn.is_null() {
+        drop(unsafe { Box::from_raw(conn) });
+    }
 }
 
-/* Bind to a peer
- * Takes a refernece to the socket object and the peer address to bind to
+/* Bind to a local address
+ * Takes the socket handle and the serialized address to bind to
  * Returns u8
 */
 #[no_mangle]
-pub extern "C" fn helix_rs_bind() -> u8 {
-    println!("HELIX - RS: Bind");
-    return 0;
+pub extern "C" fn helix_rs_bind(conn: *mut HelixConnection, address: *const u8, len: usize) -> u8 {
+    helix_log!(log::FUNCTION, "Bind");
+    match unsafe { conn_mut(conn) } {
+        Some(c) => c.bind(unsafe { address_slice(address, len) }),
+        None => 1,
+    }
 }
 
-/* Connect to a peer and connects to the peer
- * Takes a refernece to the socket object
+/* Connect to a peer
+ * Takes the socket handle and the serialized peer address
  * Returns u8
 */
 #[no_mangle]
-pub extern "C" fn helix_rs_connect() -> u8 {
-    println!("HELIX - RS: Connect");
-    return 0;
+pub extern "C" fn helix_rs_connect(
+    conn: *mut HelixConnection,
+    address: *const u8,
+    len: usize,
+) -> u8 {
+    helix_log!(log::FUNCTION, "Connect");
+    match unsafe { conn_mut(conn) } {
+        Some(c) => c.connect(unsafe { address_slice(address, len) }),
+        None => 1,
+    }
 }
 
 /* Listens to a socket
  * Returns u8
 */
 #[no_mangle]
-pub extern "C" fn helix_rs_listen() -> u8 {
-    println!("HELIX - RS: Listen");
-    return 0;
+pub extern "C" fn helix_rs_listen(conn: *mut HelixConnection) -> u8 {
+    helix_log!(log::FUNCTION, "Listen");
+    match unsafe { conn_mut(conn) } {
+        Some(c) => c.listen(),
+        None => 1,
+    }
+}
+
+/* Erasure coding parameters a new socket starts with
+ * Returns HelixCodingConfig
+*/
+#[no_mangle]
+pub extern "C" fn helix_rs_default_coding_config() -> HelixCodingConfig {
+    HelixCodingConfig::default()
+}
+
+/* Set the erasure coding parameters of a socket
+ * Returns u8, 0 on success
+*/
+#[no_mangle]
+pub extern "C" fn helix_rs_configure(conn: *mut HelixConnection, config: HelixCodingConfig) -> u8 {
+    helix_log!(log::FUNCTION, "Configure");
+    match unsafe { conn_mut(conn) } {
+        Some(c) => c.configure(config),
+        None => 1,
+    }
+}
+
+/* Handles an incoming frame at time now (ns)
+ * Returns the number of decoded packets ready for helix_rs_poll_recv
+*/
+#[no_mangle]
+pub extern "C" fn helix_rs_recv(
+    conn: *mut HelixConnection,
+    packet: FFISharedBuffer,
+    now: u64,
+) -> usize {
+    helix_log!(log::FUNCTION, "Recv packet");
+    match unsafe { conn_mut(conn) } {
+        Some(c) => c.recv(packet, now),
+        None => {
+            pool::release(packet);
+            0
+        }
+    }
+}
+
+/* Handles count incoming frames in one call
+ * Returns the number of decoded packets ready for helix_rs_poll_recv
+*/
+#[no_mangle]
+pub extern "C" fn helix_rs_recv_batch(
+    conn: *mut HelixConnection,
+    packets: *const FFISharedBuffer,
+    count: usize,
+    now: u64,
+) -> usize {
+    helix_log!(log::FUNCTION, "Recv batch of {} packets", count);
+    let c = match unsafe { conn_mut(conn) } {
+        Some(c) => c,
+        None => return 0,
+    };
+    if packets.is_null() {
+        helix_log!(log::ERROR, "Recv batch called with a null array");
+        return 0;
+    }
+    let mut ready = 0;
+    for i in 0..count {
+        ready += c.recv(unsafe { std::ptr::read(packets.add(i)) }, now);
+    }
+    ready
+}
+
+/* Next decoded packet
+ * Returns a pooled FFISharedBuffer the caller releases, empty if none
+*/
+#[no_mangle]
+pub extern "C" fn helix_rs_poll_recv(conn: *mut HelixConnection) -> FFISharedBuffer {
+    helix_rs_poll_recv_at(conn, std::ptr::null_mut())
 }
 
-/* Handles an incoming packet
- * Returns a decoded packet
+/* Next decoded packet, its offset in the sender's byte stream is written
+ * to offset unless it is null. Chunks come out of order when a loss was
+ * recovered, the offset tells where they go.
+ * Returns a pooled FFISharedBuffer the caller releases, empty if none
 */
 #[no_mangle]
-pub extern "C" fn helix_rs_recv(packet: FFISharedBuffer) -> FFISharedBuffer {
-    println!("HELIX - RS: Recv packet");
-    return packet;
+pub extern "C" fn helix_rs_poll_recv_at(
+    conn: *mut HelixConnection,
+    offset: *mut u64,
+) -> FFISharedBuffer {
+    match unsafe { conn_mut(conn) }.and_then(|c| c.poll_recv()) {
+        Some((at, chunk)) => {
+            if !offset.is_null() {
+                unsafe { *offset = at };
+            }
+            chunk
+        }
+        None => FFISharedBuffer::empty(),
+    }
 }
 
+/* Hands application data to the encoder at time now (ns)
+ * Returns void, the frames are fetched with helix_rs_poll_transmit
+*/
+#[no_mangle]
+pub extern "C" fn helix_rs_send(conn: *mut HelixConnection, packet: FFISharedBuffer, now: u64) -> () {
+    helix_log!(log::FUNCTION, "Send packet");
+    match unsafe { conn_mut(conn) } {
+        Some(c) => c.send(packet, now),
+        None => pool::release(packet),
+    }
+}
 
-/* Sends a given FFISharedBuffer
+/* Sends count buffers in one call
  * Returns void
 */
 #[no_mangle]
-pub extern "C" fn helix_rs_send(_packet: FFISharedBuffer) -> () {
-    println!("HELIX - RS: Send packet");
+pub extern "C" fn helix_rs_send_batch(
+    conn: *mut HelixConnection,
+    packets: *const FFISharedBuffer,
+    count: usize,
+    now: u64,
+) -> () {
+    helix_log!(log::FUNCTION, "Send batch of {} packets", count);
+    let c = match unsafe { conn_mut(conn) } {
+        Some(c) => c,
+        None => return,
+    };
+    if packets.is_null() {
+        helix_log!(log::ERROR, "Send batch called with a null array");
+        return;
+    }
+    for i in 0..count {
+        c.send(unsafe { std::ptr::read(packets.add(i)) }, now);
+    }
 }
 
-/* Close a socket
- * Returns u8
+/* Close the open generation so its repair symbols are queued
+ * Returns void
 */
 #[no_mangle]
-pub extern "C" fn helix_rs_close() -> u8 {
-    println!("HELIX - RS: Close Socket");
-    return 0;
+pub extern "C" fn helix_rs_flush(conn: *mut HelixConnection, now: u64) -> () {
+    helix_log!(log::FUNCTION, "Flush");
+    if let Some(c) = unsafe { conn_mut(conn) } {
+        c.flush(now);
+    }
+}
+
+/* Next frame to put on the wire
+ * Returns a pooled FFISharedBuffer the caller releases, empty if none
+*/
+#[no_mangle]
+pub extern "C" fn helix_rs_poll_transmit(conn: *mut HelixConnection) -> FFISharedBuffer {
+    helix_rs_poll_transmit_window(conn, u64::MAX)
 }
 
-/* Takes a FFISharedBuffer and encodes it in a HELIX wrapper
- * Returns FFISharedBuffer
+/* Next frame to put on the wire if fewer than window bytes are in flight,
+ * feedback is always returned
+ * Returns a pooled FFISharedBuffer the caller releases, empty if none
 */
 #[no_mangle]
-pub extern "C" fn helix_rs_encode_packet(packet: FFISharedBuffer) -> FFISharedBuffer {
-    println!("HELIX - RS: Encode Packet");
-    packet
+pub extern "C" fn helix_rs_poll_transmit_window(
+    conn: *mut HelixConnection,
+    window: u64,
+) -> FFISharedBuffer {
+    match unsafe { conn_mut(conn) } {
+        Some(c) => c.poll_transmit(window).unwrap_or_else(FFISharedBuffer::empty),
+        None => FFISharedBuffer::empty(),
+    }
 }
 
+/* Congestion signals gathered since the previous call, see
+ * FFICongestionSample
+ * Returns FFICongestionSample, zeroed for a null handle
+*/
+#[no_mangle]
+pub extern "C" fn helix_rs_congestion_sample(conn: *mut HelixConnection) -> FFICongestionSample {
+    match unsafe { conn_mut(conn) } {
+        Some(c) => c.congestion_sample(),
+        None => FFICongestionSample::default(),
+    }
+}
+
+/* Time (ns) at which helix_rs_on_timeout should be called
+ * Returns u64::MAX when no timer is needed
+*/
+#[no_mangle]
+pub extern "C" fn helix_rs_next_timeout(conn: *mut HelixConnection) -> u64 {
+    match unsafe { conn_mut(conn) } {
+        Some(c) => c.next_timeout(),
+        None => u64::MAX,
+    }
+}
+
+/* Fire the repair timer at time now (ns)
+ * Returns void
+*/
+#[no_mangle]
+pub extern "C" fn helix_rs_on_timeout(conn: *mut HelixConnection, now: u64) -> () {
+    helix_log!(log::FUNCTION, "Timeout");
+    if let Some(c) = unsafe { conn_mut(conn) } {
+        c.on_timeout(now);
+    }
+}
+
+/* Generations the peer has not acked yet
+ * Returns usize
+*/
+#[no_mangle]
+pub extern "C" fn helix_rs_pending_generations(conn: *mut HelixConnection) -> usize {
+    match unsafe { conn_mut(conn) } {
+        Some(c) => c.pending_generations(),
+        None => 0,
+    }
+}
+
+/* Coded frames queued for transmission, so the caller can hold data
+ * back instead of queueing it behind them
+ * Returns usize
+*/
+#[no_mangle]
+pub extern "C" fn helix_rs_queued_frames(conn: *mut HelixConnection) -> usize {
+    match unsafe { conn_mut(conn) } {
+        Some(c) => c.queued_frames(),
+        None => 0,
+    }
+}
+
+/* Decode latency percentiles of a socket
+ * Returns FFIDecodeStats, zeroed for a null handle
+*/
+#[no_mangle]
+pub extern "C" fn helix_rs_decode_stats(conn: *mut HelixConnection) -> FFIDecodeStats {
+    match unsafe { conn_mut(conn) } {
+        Some(c) => c.decode_stats(),
+        None => FFIDecodeStats::default(),
+    }
+}
+
+/* Decode latency of the next generation decoded since the previous call,
+ * in ns from its first symbol; only the 64 most recent are kept
+ * Returns u64, u64::MAX if there is none
+*/
+#[no_mangle]
+pub extern "C" fn helix_rs_poll_decode_latency(conn: *mut HelixConnection) -> u64 {
+    match unsafe { conn_mut(conn) } {
+        Some(c) => c.poll_decode_latency().unwrap_or(u64::MAX),
+        None => u64::MAX,
+    }
+}
+
+/* Stream offset the receiver has room up to at time now (ns), decoded
+ * data beyond it is held back and source symbols far beyond it are
+ * refused; u64::MAX lifts the limit. The limit goes to the peer in the
+ * feedback, a grown one as a window update.
+ * Returns u8, 1 if a window update waits to go out
+*/
+#[no_mangle]
+pub extern "C" fn helix_rs_set_recv_limit(conn: *mut HelixConnection, limit: u64, now: u64) -> u8 {
+    match unsafe { conn_mut(conn) } {
+        Some(c) => c.set_recv_limit(limit, now) as u8,
+        None => 0,
+    }
+}
+
+/* Bytes helix_rs_send may still take before the data runs past the
+ * receive limit the peer reported
+ * Returns u64, 0 for a null handle
+*/
+#[no_mangle]
+pub extern "C" fn helix_rs_send_room(conn: *mut HelixConnection) -> u64 {
+    match unsafe { conn_mut(conn) } {
+        Some(c) => c.send_room(),
+        None => 0,
+    }
+}
+
+/* Smoothed RTT of the socket, feedback then goes out at least every
+ * quarter RTT; 0 leaves the feedback interval alone
+ * Returns void
+*/
+#[no_mangle]
+pub extern "C" fn helix_rs_set_rtt(conn: *mut HelixConnection, rtt_ns: u64) -> () {
+    if let Some(c) = unsafe { conn_mut(conn) } {
+        c.set_rtt(rtt_ns);
+    }
+}
+
+/* Loss counters the peer reported in its latest feedback, cumulative and
+ * wrapping, so the caller works with differences between two reports
+ * Returns FFILossFeedback, zeroed for a null handle
+*/
+#[no_mangle]
+pub extern "C" fn helix_rs_loss_feedback(conn: *mut HelixConnection) -> FFILossFeedback {
+    match unsafe { conn_mut(conn) } {
+        Some(c) => c.loss_feedback(),
+        None => FFILossFeedback::default(),
+    }
+}
+
+/* Close a socket
+ * The handle stays valid until helix_rs_destroy_socket
+ * Returns u8
+*/
+#[no_mangle]
+pub extern "C" fn helix_rs_close(conn: *mut HelixConnection) -> u8 {
+    helix_log!(log::FUNCTION, "Close Socket");
+    match unsafe { conn_mut(conn) } {
+        Some(c) => c.close(),
+        None => 1,
+    }
+}
 
 /* Create a socket
  * Returns u8
 */
 #[no_mangle]
 pub extern "C" fn helix_rs_set_callback_function() -> u8 {
-    println!("HELIX - RS: Set Callback");
+    helix_log!(log::FUNCTION, "Set Callback");
     return 0;
 }
 
@@ -0,0 +1,80 @@
+/* Logging bridged to the ns-3 log system
+ *
+ * C++ registers a callback together with the mask of ns-3 log levels
+ * enabled on its HelixRsInterface component. helix_log! tests the mask
+ * before building its format_args!, so a disabled level is a single
+ * atomic load and nothing is formatted or written.
+ * Level values are the ns-3 LogLevel bits.
+*/
+
+use std::cell::RefCell;
+use std::fmt::Write;
+use std::sync::atomic::{AtomicU32, AtomicUsize, Ordering};
+
+pub const ERROR: u32 = 0x00000001;
+pub const WARN: u32 = 0x00000002;
+pub const DEBUG: u32 = 0x00000004;
+pub const INFO: u32 = 0x00000008;
+pub const FUNCTION: u32 = 0x00000010;
+pub const LOGIC: u32 = 0x00000020;
+
+pub type LogCallback = extern "C" fn(level: u32, message: *const u8, len: usize);
+
+static CALLBACK: AtomicUsize = AtomicUsize::new(0);
+static MASK: AtomicU32 = AtomicU32::new(0);
+
+thread_local! {
+    static LINE: RefCell<String> = RefCell::new(String::new());
+}
+
+pub fn set_callback(callback: Option<LogCallback>, mask: u32) {
+    match callback {
+        Some(cb) => {
+            CALLBACK.store(cb as usize, Ordering::Relaxed);
+            MASK.store(mask, Ordering::Relaxed);
+        }
+        None => {
+            MASK.store(0, Ordering::Relaxed);
+            CALLBACK.store(0, Ordering::Relaxed);
+        }
+    }
+}
+
+pub fn set_mask(mask: u32) {
+    if CALLBACK.load(Ordering::Relaxed) != 0 {
+        MASK.store(mask, Ordering::Relaxed);
+    }
+}
+
+#[inline(always)]
+pub fn enabled(level: u32) -> bool {
+    MASK.load(Ordering::Relaxed) & level != 0
+}
+
+/* Format and hand a line to C++
+ * Only called once enabled() said yes, the line buffer is reused
+*/
+#[cold]
+pub fn emit(level: u32, args: std::fmt::Arguments) {
+    let cb = CALLBACK.load(Ordering::Relaxed);
+    if cb == 0 {
+        return;
+    }
+    let cb: LogCallback = unsafe { std::mem::transmute(cb) };
+    LINE.with(|line| {
+        let mut line = line.borrow_mut();
+        line.clear();
+        let _ = line.write_fmt(args);
+        cb(level, line.as_ptr(), line.len());
+    });
+}
+
+macro_rules! helix_log {
+    ($level:expr, $($arg:tt)*) => {
+        if $crate::log::enabled($level) {
+            $crate::log::emit($level, format_args!($($arg)*));
+        }
+    };
+}
+
+pub(crate) use helix_log;
@@ -0,0 +1,229 @@
+/* Buffer pool shared by both sides of the FFI
+ *
+ * Buffers are handed out in size classes that are multiples of the
+ * symbol sizes in use (1x, 2x, 4x, 8x), a request gets the smallest class
+ * it fits in. A released buffer goes back onto the free list of its
+ * class, so once the pool is warm a transfer recycles the same
+ * allocations between send and receive.
+ * The pool is shared by every connection of the thread, configuring a
+ * new symbol size adds its classes next to those of the sizes already in
+ * use, so sockets with different symbol sizes do not flush each other's
+ * free lists. Only the MAX_SYMBOL_SIZES most recently configured sizes
+ * keep their classes.
+ * Requests larger than the biggest class are served from the heap and
+ * freed on release; they are counted as misses.
+*/
+
+use crate::FFISharedBuffer;
+use std::cell::RefCell;
+use std::collections::BTreeMap;
+
+const NUM_CLASSES: usize = 4;
+const DEFAULT_SYMBOL_SIZE: usize = 1024;
+const MAX_FREE_PER_CLASS: usize = 8192;
+const MAX_SYMBOL_SIZES: usize = 8;
+
+#[repr(C)]
+#[derive(Clone, Copy, Default)]
+pub struct FFIPoolStats {
+    pub hits: u64,
+    pub misses: u64,
+    pub in_use: u64,
+    pub high_water: u64,
+    pub free: u64,
+}
+
+struct Pool {
+    /* symbol sizes in use, the most recently configured last */
+    symbol_sizes: Vec<usize>,
+    /* free list of every class, by class size */
+    free: BTreeMap<usize, Vec<Vec<u8>>>,
+    stats: FFIPoolStats,
+}
+
+impl Pool {
+    fn new() -> Pool {
+        let mut pool = Pool {
+            symbol_sizes: Vec::new(),
+            free: BTreeMap::new(),
+            stats: FFIPoolStats::default(),
+        };
+        pool.configure(DEFAULT_SYMBOL_SIZE);
+        pool
+    }
+
+    fn classes(symbol_size: usize) -> impl Iterator<Item = usize> {
+        (0..NUM_CLASSES).map(move |c| symbol_size << c)
+    }
+
+    fn configure(&mut self, symbol_size: usize) {
+        if symbol_size == 0 {
+            return;
+        }
+        if let Some(i) = self.symbol_sizes.iter().position(|&s| s == symbol_size) {
+            let size = self.symbol_sizes.remove(i);
+            self.symbol_sizes.push(size);
+            return;
+        }
+        self.symbol_sizes.push(symbol_size);
+        for size in Pool::classes(symbol_size) {
+            self.free.entry(size).or_default();
+        }
+        if self.symbol_sizes.len() <= MAX_SYMBOL_SIZES {
+            return;
+        }
+
+        // outstanding buffers of the dropped classes are freed when released
+        let oldest = self.symbol_sizes.remove(0);
+        for size in Pool::classes(oldest) {
+            let shared = self
+                .symbol_sizes
+                .iter()
+                .any(|&s| Pool::classes(s).any(|c| c == size));
+            if !shared {
+                if let Some(list) = self.free.remove(&size) {
+                    self.stats.free -= list.len() as u64;
+                }
+            }
+        }
+    }
+
+    /* Returns an empty Vec with room for at least len bytes */
+    fn take(&mut self, len: usize) -> Vec<u8> {
+        let v = match self.free.range_mut(len..).next() {
+            Some((&size, list)) => match list.pop() {
+                Some(v) => {
+                    self.stats.hits += 1;
+                    self.stats.free -= 1;
+                    v
+                }
+                None => {
+                    self.stats.misses += 1;
+                    Vec::with_capacity(size)
+                }
+            },
+            None => {
+                self.stats.misses += 1;
+                Vec::with_capacity(len)
+            }
+        };
+
+        self.stats.in_use += 1;
+        self.stats.high_water = self.stats.high_water.max(self.stats.in_use);
+        v
+    }
+
+    fn release(&mut self, mut v: Vec<u8>) {
+        self.stats.in_use = self.stats.in_use.saturating_sub(1);
+        if let Some(list) = self.free.get_mut(&v.capacity()) {
+            if list.len() < MAX_FREE_PER_CLASS {
+                v.clear();
+                list.push(v);
+                self.stats.free += 1;
+            }
+        }
+    }
+}
+
+thread_local! {
+    static POOL: RefCell<Pool> = RefCell::new(Pool::new());
+}
+
+/* Take a buffer of len bytes out of the pool */
+pub fn acquire(len: usize) -> FFISharedBuffer {
+    let mut v = POOL.with(|p| p.borrow_mut().take(len));
+    v.resize(len, 0);
+    into_ffi(v)
+}
+
+/* Take an empty Vec with room for len bytes out of the pool
+ * Hand it to C++ with into_buffer or give it back with release_vec
+*/
+pub fn take_vec(len: usize) -> Vec<u8> {
+    POOL.with(|p| p.borrow_mut().take(len))
+}
+
+/* Turn a Vec from take_vec into a Rust-owned FFISharedBuffer */
+pub fn into_buffer(v: Vec<u8>) -> FFISharedBuffer {
+    into_ffi(v)
+}
+
+/* Give a Vec from take_vec back to the pool */
+pub fn release_vec(v: Vec<u8>) {
+    POOL.with(|p| p.borrow_mut().release(v));
+}
+
+/* Give a buffer back to the pool, borrowed views are ignored */
+pub fn release(buffer: FFISharedBuffer) {
+    if buffer.ptr.is_null() || buffer.state.is_null() {
+        return;
+    }
+    let v = unsafe { Vec::from_raw_parts(buffer.ptr, buffer.len, buffer.state as usize) };
+    POOL.with(|p| p.borrow_mut().release(v));
+}
+
+pub fn configure(symbol_size: usize) {
+    POOL.with(|p| p.borrow_mut().configure(symbol_size));
+}
+
+pub fn stats() -> FFIPoolStats {
+    POOL.with(|p| p.borrow().stats)
+}
+
+fn into_ffi(v: Vec<u8>) -> FFISharedBuffer {
+    let (ptr, len, cap) = v.into_raw_parts();
+    FFISharedBuffer {
+        ptr,
+        len,
+        state: cap as *mut (),
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn mixed_symbol_sizes_keep_their_free_lists() {
+        let mut pool = Pool::new();
+        pool.configure(4096);
+        let large = pool.take(4096 + 13);
+        pool.configure(1024);
+        let small = pool.take(1024 + 13);
+        pool.release(large);
+        pool.release(small);
+
+        pool.configure(4096);
+        assert_eq!(pool.take(4096 + 13).capacity(), 8192);
+        pool.configure(1024);
+        assert_eq!(pool.take(1024 + 13).capacity(), 2048);
+        assert_eq!(pool.stats.hits, 2);
+    }
+
+    #[test]
+    fn oldest_symbol_size_loses_its_classes() {
+        let mut pool = Pool::new();
+        for i in 0..=MAX_SYMBOL_SIZES {
+            pool.configure(100 + i);
+        }
+        assert!(!pool.free.contains_key(&DEFAULT_SYMBOL_SIZE));
+        assert!(pool.free.contains_key(&(100 + MAX_SYMBOL_SIZES)));
+    }
+
+    #[test]
+    fn only_owned_buffers_are_writable() {
+        let mut owned = acquire(5);
+        owned.as_mut_slice().copy_from_slice(b"helix");
+        assert_eq!(owned.as_slice(), b"helix");
+        release(owned);
+
+        let data = *b"lent";
+        let mut lent = FFISharedBuffer {
+            ptr: data.as_ptr() as *mut u8,
+            len: data.len(),
+            state: std::ptr::null_mut(),
+        };
+        assert!(lent.as_mut_slice().is_empty());
+        assert_eq!(lent.as_slice(), b"lent");
+    }
+}
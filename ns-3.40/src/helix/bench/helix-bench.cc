@@ -0,0 +1,527 @@
+/**
+ * Microbenchmarks of the HELIX codec and FFI paths
+ *
+ * - codec-encode, codec-decode: whole generations pushed through
+ *   HelixRsInterface at several generation and symbol sizes, one op is
+ *   one source symbol
+ * - convert-to-ffi, convert-from-ffi: HelixRsInterface::ConvertPacketToFFIBuff
+ *   and HelixRsInterface::ConvertFFIBuffToPacket, one op is one conversion
+ * - socket-loopback: HelixSocketImpl::Send to HelixSocketImpl::Recv
+ *   between two sockets whose inner sockets hand frames straight to each
+ *   other, without nodes or links, one op is one write
+ *
+ * Results are printed as CSV, one row per run, so they can be diffed and
+ * plotted across releases. allocs/op counts the allocations made through
+ * the C++ operator new of this program, helix-rs allocates on its own
+ * heap and is not part of it.
+ *
+ *  Usage (e.g.): ./ns3 run "helix-bench --symbols=65536"
+ */
+
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+
+#include "ns3/helix-rs-interface.h"
+#include "ns3/helix-socket-impl.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <deque>
+#include <iostream>
+#include <limits>
+#include <new>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace ns3;
+
+NS_LOG_COMPONENT_DEFINE("HelixBench");
+
+/// Number of times operator new was called
+static uint64_t g_allocations = 0;
+
+void*
+operator new(std::size_t size)
+{
+    g_allocations++;
+    if (void* p = std::malloc(size ? size : 1))
+    {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void*
+operator new[](std::size_t size)
+{
+    return operator new(size);
+}
+
+void
+operator delete(void* p) noexcept
+{
+    std::free(p);
+}
+
+void
+operator delete[](void* p) noexcept
+{
+    std::free(p);
+}
+
+void
+operator delete(void* p, std::size_t) noexcept
+{
+    std::free(p);
+}
+
+void
+operator delete[](void* p, std::size_t) noexcept
+{
+    std::free(p);
+}
+
+/// Length and offset helix-rs puts in front of the data of a source symbol
+static const uint32_t SOURCE_PREFIX_SIZE = 10;
+
+/**
+ * Wall clock time and allocations of a measured section.
+ */
+class Measurement
+{
+  public:
+    /// Start measuring
+    void Start()
+    {
+        m_allocations = g_allocations;
+        m_start = std::chrono::steady_clock::now();
+    }
+
+    /// Stop measuring, the time and allocations add up over several sections
+    void Stop()
+    {
+        m_elapsed += std::chrono::steady_clock::now() - m_start;
+        m_allocationCount += g_allocations - m_allocations;
+    }
+
+    /**
+     * Print a CSV row.
+     *
+     * \param name The benchmark.
+     * \param generationSize The generation size, 0 if not applicable.
+     * \param size The symbol or packet size in bytes.
+     * \param ops The number of operations measured.
+     * \param bytes The number of payload bytes they carried.
+     */
+    void Print(const std::string& name,
+               uint32_t generationSize,
+               uint32_t size,
+               uint64_t ops,
+               uint64_t bytes) const
+    {
+        double ns = std::chrono::duration<double, std::nano>(m_elapsed).count();
+        std::cout << name << "," << generationSize << "," << size << "," << ops << ","
+                  << ns / ops << "," << (ns > 0 ? bytes * 1e9 / ns : 0) << ","
+                  << static_cast<double>(m_allocationCount) / ops << std::endl;
+    }
+
+  private:
+    std::chrono::steady_clock::time_point m_start;   //!< start of the current section
+    std::chrono::steady_clock::duration m_elapsed{0}; //!< time of the sections so far
+    uint64_t m_allocations{0};                        //!< allocations at the start
+    uint64_t m_allocationCount{0};                    //!< allocations of the sections so far
+};
+
+/**
+ * Encode and decode whole generations.
+ *
+ * \param generationSize Source symbols per generation.
+ * \param symbolSize Symbol size in bytes.
+ * \param nSymbols Number of source symbols to push through.
+ */
+static void
+RunCodec(uint32_t generationSize, uint32_t symbolSize, uint32_t nSymbols)
+{
+    Ptr<HelixRsInterface> tx = CreateObject<HelixRsInterface>();
+    Ptr<HelixRsInterface> rx = CreateObject<HelixRsInterface>();
+    for (Ptr<HelixRsInterface> rs : {tx, rx})
+    {
+        HelixCodingConfig config = rs->GetCodingConfig();
+        config.generation_size = generationSize;
+        config.symbol_size = symbolSize;
+        rs->SetCodingConfig(config);
+        rs->SetSymbolSize(symbolSize);
+    }
+
+    uint32_t payload = symbolSize - SOURCE_PREFIX_SIZE;
+    uint32_t generations = std::max<uint32_t>(nSymbols / generationSize, 1);
+    std::vector<Ptr<Packet>> batch;
+    std::vector<Ptr<Packet>> frames;
+    std::vector<Ptr<Packet>> feedback;
+    Measurement encode;
+    Measurement decode;
+    for (uint32_t g = 0; g < generations; g++)
+    {
+        batch.clear();
+        for (uint32_t i = 0; i < generationSize; i++)
+        {
+            batch.push_back(Create<Packet>(payload));
+        }
+
+        encode.Start();
+        tx->SendBatch(batch);
+        tx->Flush();
+        frames.clear();
+        for (Ptr<Packet> frame = tx->PollTransmit(); frame; frame = tx->PollTransmit())
+        {
+            frames.push_back(frame);
+        }
+        encode.Stop();
+
+        decode.Start();
+        rx->RecvBatch(frames);
+        while (rx->PollRecv())
+        {
+        }
+        decode.Stop();
+
+        // acks let the encoder release the generation
+        feedback.clear();
+        for (Ptr<Packet> frame = rx->PollTransmit(); frame; frame = rx->PollTransmit())
+        {
+            feedback.push_back(frame);
+        }
+        tx->RecvBatch(feedback);
+    }
+
+    uint64_t symbols = static_cast<uint64_t>(generations) * generationSize;
+    encode.Print("codec-encode", generationSize, symbolSize, symbols, symbols * payload);
+    decode.Print("codec-decode", generationSize, symbolSize, symbols, symbols * payload);
+    tx->Dispose();
+    rx->Dispose();
+}
+
+/**
+ * Convert packets to FFI buffers and back.
+ *
+ * \param size Packet size in bytes.
+ * \param nOps Number of conversions of each kind.
+ */
+static void
+RunConvert(uint32_t size, uint32_t nOps)
+{
+    Ptr<HelixRsInterface> rs = CreateObject<HelixRsInterface>();
+    Ptr<Packet> p = Create<Packet>(size);
+    std::vector<uint8_t> bytes(size);
+    FFISharedBuffer buffer{bytes.data(), size, nullptr};
+
+    Measurement toFfi;
+    toFfi.Start();
+    for (uint32_t i = 0; i < nOps; i++)
+    {
+        rs->ConvertPacketToFFIBuff(p);
+    }
+    toFfi.Stop();
+
+    Measurement fromFfi;
+    fromFfi.Start();
+    for (uint32_t i = 0; i < nOps; i++)
+    {
+        rs->ConvertFFIBuffToPacket(buffer);
+    }
+    fromFfi.Stop();
+
+    toFfi.Print("convert-to-ffi", 0, size, nOps, static_cast<uint64_t>(nOps) * size);
+    fromFfi.Print("convert-from-ffi", 0, size, nOps, static_cast<uint64_t>(nOps) * size);
+    rs->Dispose();
+}
+
+/**
+ * Inner socket of the loopback benchmark, frames sent on one end are
+ * received on the other in the next event.
+ */
+class LoopbackSocket : public Socket
+{
+  public:
+    /**
+     * Connect two ends.
+     *
+     * \param peer The other end.
+     * \param address The address frames sent from this end come from.
+     */
+    void Pair(Ptr<LoopbackSocket> peer, const Address& address)
+    {
+        m_peer = peer;
+        m_address = address;
+    }
+
+    /// Break the reference cycle between both ends
+    void Unpair()
+    {
+        m_peer = nullptr;
+        m_queue.clear();
+    }
+
+    int SendTo(Ptr<Packet> p, uint32_t flags, const Address& toAddress) override
+    {
+        return Send(p, flags);
+    }
+
+    int Send(Ptr<Packet> p, uint32_t flags) override
+    {
+        m_peer->m_queue.emplace_back(p, m_address);
+        if (m_peer->m_queue.size() == 1)
+        {
+            Simulator::ScheduleNow(&LoopbackSocket::Deliver, m_peer);
+        }
+        return p->GetSize();
+    }
+
+    Ptr<Packet> RecvFrom(uint32_t maxSize, uint32_t flags, Address& fromAddress) override
+    {
+        if (m_queue.empty())
+        {
+            return nullptr;
+        }
+        Ptr<Packet> p = m_queue.front().first;
+        fromAddress = m_queue.front().second;
+        m_queue.pop_front();
+        return p;
+    }
+
+    Ptr<Packet> Recv(uint32_t maxSize, uint32_t flags) override
+    {
+        Address fromAddress;
+        return RecvFrom(maxSize, flags, fromAddress);
+    }
+
+    uint32_t GetRxAvailable() const override
+    {
+        return m_queue.empty() ? 0 : m_queue.front().first->GetSize();
+    }
+
+    SocketErrno GetErrno() const override
+    {
+        return ERROR_NOTERROR;
+    }
+
+    SocketType GetSocketType() const override
+    {
+        return NS3_SOCK_DGRAM;
+    }
+
+    Ptr<Node> GetNode() const override
+    {
+        return nullptr;
+    }
+
+    int Bind(const Address& address) override
+    {
+        return 0;
+    }
+
+    int Bind() override
+    {
+        return 0;
+    }
+
+    int Bind6() override
+    {
+        return 0;
+    }
+
+    int Close() override
+    {
+        return 0;
+    }
+
+    int ShutdownSend() override
+    {
+        return 0;
+    }
+
+    int ShutdownRecv() override
+    {
+        return 0;
+    }
+
+    int Connect(const Address& address) override
+    {
+        return 0;
+    }
+
+    int Listen() override
+    {
+        return 0;
+    }
+
+    uint32_t GetTxAvailable() const override
+    {
+        return std::numeric_limits<uint32_t>::max();
+    }
+
+    int GetSockName(Address& address) const override
+    {
+        address = m_address;
+        return 0;
+    }
+
+    int GetPeerName(Address& address) const override
+    {
+        return -1;
+    }
+
+    bool SetAllowBroadcast(bool allowBroadcast) override
+    {
+        return !allowBroadcast;
+    }
+
+    bool GetAllowBroadcast() const override
+    {
+        return false;
+    }
+
+  private:
+    /// Hand the queued frames to the receive callback
+    void Deliver()
+    {
+        NotifyDataRecv();
+    }
+
+    Ptr<LoopbackSocket> m_peer;                          //!< the other end
+    Address m_address;                                   //!< address of this end
+    std::deque<std::pair<Ptr<Packet>, Address>> m_queue; //!< frames not read yet
+};
+
+/// Bytes the loopback sender writes per Send()
+static const uint32_t LOOPBACK_WRITE_SIZE = 1040;
+
+/// Bytes the loopback sender has written so far
+static uint64_t g_loopbackSent = 0;
+
+/// Bytes the loopback sender writes in total
+static uint64_t g_loopbackTotal = 0;
+
+/// Bytes the loopback receiver has read so far
+static uint64_t g_loopbackReceived = 0;
+
+/**
+ * Write until the transmit buffer is full or everything was written.
+ *
+ * \param socket The sending socket.
+ * \param txSpace The free space in its transmit buffer.
+ */
+static void
+LoopbackWrite(Ptr<Socket> socket, uint32_t txSpace)
+{
+    while (g_loopbackSent < g_loopbackTotal && socket->GetTxAvailable() >= LOOPBACK_WRITE_SIZE)
+    {
+        if (socket->Send(Create<Packet>(LOOPBACK_WRITE_SIZE)) < 0)
+        {
+            break;
+        }
+        g_loopbackSent += LOOPBACK_WRITE_SIZE;
+    }
+}
+
+/**
+ * Read everything the receiving socket holds.
+ *
+ * \param socket The receiving socket.
+ */
+static void
+LoopbackRead(Ptr<Socket> socket)
+{
+    for (Ptr<Packet> p = socket->Recv(); p; p = socket->Recv())
+    {
+        g_loopbackReceived += p->GetSize();
+    }
+}
+
+/**
+ * Send from one socket to another and read everything.
+ *
+ * \param nWrites Number of writes.
+ */
+static void
+RunLoopback(uint32_t nWrites)
+{
+    Ptr<LoopbackSocket> txInner = CreateObject<LoopbackSocket>();
+    Ptr<LoopbackSocket> rxInner = CreateObject<LoopbackSocket>();
+    InetSocketAddress txAddress(Ipv4Address("10.0.0.1"), 49153);
+    InetSocketAddress rxAddress(Ipv4Address("10.0.0.2"), 50000);
+    txInner->Pair(rxInner, txAddress);
+    rxInner->Pair(txInner, rxAddress);
+
+    Ptr<HelixSocketImpl> tx = CreateObject<HelixSocketImpl>();
+    Ptr<HelixSocketImpl> rx = CreateObject<HelixSocketImpl>();
+    tx->SetUdpSocket(txInner);
+    rx->SetUdpSocket(rxInner);
+    rx->Listen();
+    rx->SetRecvCallback(MakeCallback(&LoopbackRead));
+    tx->Connect(rxAddress);
+    tx->SetSendCallback(MakeCallback(&LoopbackWrite));
+
+    g_loopbackSent = 0;
+    g_loopbackReceived = 0;
+    g_loopbackTotal = static_cast<uint64_t>(nWrites) * LOOPBACK_WRITE_SIZE;
+
+    Measurement loopback;
+    loopback.Start();
+    Simulator::ScheduleNow(&LoopbackWrite, tx, tx->GetTxAvailable());
+    Simulator::Stop(Seconds(3600));
+    Simulator::Run();
+    loopback.Stop();
+
+    if (g_loopbackReceived != g_loopbackTotal)
+    {
+        NS_LOG_WARN("loopback received " << g_loopbackReceived << " of " << g_loopbackTotal
+                                         << " bytes");
+    }
+    UintegerValue generationSize;
+    tx->GetAttribute("GenerationSize", generationSize);
+    loopback.Print("socket-loopback",
+                   generationSize.Get(),
+                   LOOPBACK_WRITE_SIZE,
+                   nWrites,
+                   g_loopbackReceived);
+
+    txInner->Unpair();
+    rxInner->Unpair();
+    tx->Dispose();
+    rx->Dispose();
+    Simulator::Destroy();
+}
+
+int
+main(int argc, char* argv[])
+{
+    uint32_t nSymbols = 32768;
+    uint32_t nConversions = 1000000;
+    uint32_t nWrites = 16384;
+
+    CommandLine cmd(__FILE__);
+    cmd.AddValue("symbols", "Source symbols pushed through each codec configuration", nSymbols);
+    cmd.AddValue("conversions", "Conversions of each kind and packet size", nConversions);
+    cmd.AddValue("writes", "Writes of 1040 bytes of the loopback benchmark", nWrites);
+    cmd.Parse(argc, argv);
+
+    std::cout << "benchmark,generation_size,size,ops,ns_per_op,bytes_per_s,allocs_per_op"
+              << std::endl;
+    for (uint32_t symbolSize : {256, 1024, 4096})
+    {
+        for (uint32_t generationSize : {8, 32, 128})
+        {
+            RunCodec(generationSize, symbolSize, nSymbols);
+        }
+    }
+    for (uint32_t size : {64, 1024, 4096})
+    {
+        RunConvert(size, nConversions);
+    }
+    RunLoopback(nWrites);
+
+    return 0;
+}
@@ -0,0 +1,189 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+//
+// Network topology
+//
+//           10Mb/s, 10ms
+//       n0-----------------n1
+//
+// n0 streams constant bit rate data to n1 over a HELIX socket. A
+// RateErrorModel on n1's device drops packets at a rate that changes
+// every 5 seconds (0%, 5%, 20%, 1%), and every change of the sender's
+// RepairRatio is printed together with the loss it was derived from.
+//
+// With --interleave=0 the sender also spreads consecutive symbols over
+// as many generations as a loss burst is long.
+//
+//  Usage (e.g.): ./ns3 run "helix-adaptive-redundancy --burst=3 --interleave=0"
+
+#include "ns3/core-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/network-module.h"
+#include "ns3/point-to-point-module.h"
+
+#include "ns3/helix-helper.h"
+#include "ns3/helix-socket-factory.h"
+#include "ns3/helix-socket-impl.h"
+
+#include <iostream>
+
+using namespace ns3;
+
+NS_LOG_COMPONENT_DEFINE("HelixAdaptiveRedundancy");
+
+/// Bytes handed to the sending socket per write.
+static const uint32_t writeSize = 1000;
+/// Bytes decoded by the receiver.
+static uint64_t rxBytes = 0;
+
+/**
+ * Write one chunk and schedule the next one.
+ *
+ * \param socket The sending socket.
+ * \param interval Time between two writes.
+ */
+static void
+SendChunk(Ptr<Socket> socket, Time interval)
+{
+    socket->Send(Create<Packet>(writeSize));
+    Simulator::Schedule(interval, &SendChunk, socket, interval);
+}
+
+/**
+ * Drain the receiving socket.
+ *
+ * \param socket The receiving socket.
+ */
+static void
+HandleRead(Ptr<Socket> socket)
+{
+    Ptr<Packet> packet;
+    while ((packet = socket->Recv()))
+    {
+        rxBytes += packet->GetSize();
+    }
+}
+
+/**
+ * Print a repair ratio change.
+ *
+ * \param socket The sending socket, for the loss estimates.
+ * \param oldRatio The previous repair ratio.
+ * \param newRatio The new repair ratio.
+ */
+static void
+RepairRatioChanged(Ptr<HelixSocketImpl> socket, double oldRatio, double newRatio)
+{
+    PointerValue controller;
+    socket->GetAttribute("RedundancyController", controller);
+    Ptr<HelixRedundancyController> redundancy = controller.Get<HelixRedundancyController>();
+    std::cout << Simulator::Now().As(Time::S) << " repair ratio " << oldRatio << " -> "
+              << newRatio << " (loss " << redundancy->GetLossRate() << ", burst "
+              << redundancy->GetBurstLength() << ", " << rxBytes << " bytes decoded)"
+              << std::endl;
+}
+
+int
+main(int argc, char* argv[])
+{
+    uint32_t burst = 1;
+    uint32_t interleave = 1;
+    DataRate rate("4Mbps");
+
+    CommandLine cmd(__FILE__);
+    cmd.AddValue("burst", "Packets dropped per loss event", burst);
+    cmd.AddValue("rate", "Application data rate", rate);
+    cmd.AddValue("interleave", "HELIX interleave depth, 0 to adapt it", interleave);
+    cmd.Parse(argc, argv);
+
+    Config::SetDefault("ns3::HelixSocket::InterleaveDepth", UintegerValue(interleave));
+
+    NodeContainer nodes;
+    nodes.Create(2);
+
+    PointToPointHelper p2p;
+    p2p.SetDeviceAttribute("DataRate", DataRateValue(DataRate(10000000)));
+    p2p.SetChannelAttribute("Delay", TimeValue(MilliSeconds(10)));
+    NetDeviceContainer devices = p2p.Install(nodes);
+
+    // a burst of b drops per event keeps the packet loss rate at the
+    // scheduled value, only its burstiness changes
+    Ptr<RateErrorModel> errors = CreateObject<RateErrorModel>();
+    errors->SetUnit(RateErrorModel::ERROR_UNIT_PACKET);
+    errors->SetRate(0);
+    devices.Get(1)->SetAttribute("ReceiveErrorModel", PointerValue(errors));
+    Ptr<BurstErrorModel> bursts;
+    if (burst > 1)
+    {
+        bursts = CreateObject<BurstErrorModel>();
+        bursts->SetAttribute("BurstSize",
+                             StringValue("ns3::ConstantRandomVariable[Constant=" +
+                                         std::to_string(burst) + "]"));
+        bursts->SetBurstRate(0);
+        devices.Get(1)->SetAttribute("ReceiveErrorModel", PointerValue(bursts));
+    }
+
+    const double lossRates[] = {0, 0.05, 0.2, 0.01};
+    for (uint32_t i = 0; i < 4; i++)
+    {
+        if (bursts)
+        {
+            Simulator::Schedule(Seconds(5 * i),
+                                &BurstErrorModel::SetBurstRate,
+                                bursts,
+                                lossRates[i] / burst);
+        }
+        else
+        {
+            Simulator::Schedule(Seconds(5 * i), &RateErrorModel::SetRate, errors, lossRates[i]);
+        }
+    }
+
+    InternetStackHelper internet;
+    internet.Install(nodes);
+    HelixStackHelper helixStackHelper;
+    helixStackHelper.Install(nodes);
+
+    Ipv4AddressHelper ipv4;
+    ipv4.SetBase("10.1.1.0", "255.255.255.0");
+    Ipv4InterfaceContainer interfaces = ipv4.Assign(devices);
+
+    uint16_t port = 50000;
+    Ptr<Socket> sink = Socket::CreateSocket(nodes.Get(1), HelixSocketFactory::GetTypeId());
+    sink->Bind(InetSocketAddress(interfaces.GetAddress(1), port));
+    sink->Listen();
+    sink->SetRecvCallback(MakeCallback(&HandleRead));
+
+    Ptr<Socket> source = Socket::CreateSocket(nodes.Get(0), HelixSocketFactory::GetTypeId());
+    source->Bind();
+    source->Connect(InetSocketAddress(interfaces.GetAddress(1), port));
+
+    // the sender is the only socket on node 0
+    Config::ConnectWithoutContext(
+        "/NodeList/0/$ns3::HelixL4Protocol/SocketList/*/RedundancyController/RepairRatio",
+        MakeBoundCallback(&RepairRatioChanged, DynamicCast<HelixSocketImpl>(source)));
+
+    Time interval = rate.CalculateBytesTxTime(writeSize);
+    Simulator::ScheduleNow(&SendChunk, source, interval);
+
+    Simulator::Stop(Seconds(20));
+    Simulator::Run();
+    std::cout << rxBytes << " bytes decoded" << std::endl;
+    Simulator::Destroy();
+
+    return 0;
+}
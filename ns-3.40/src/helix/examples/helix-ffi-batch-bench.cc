@@ -0,0 +1,118 @@
+/**
+ * Microbenchmark for the batched helix-rs FFI entry points
+ *
+ * Pushes the same number of packets through HelixRsInterface::SendBatch
+ * and HelixRsInterface::RecvBatch at batch sizes 1, 8, 32 and 128 and
+ * reports the cost per call and per packet, so the amortization of the
+ * per-call FFI overhead can be compared. The send side includes encoding
+ * and draining the coded frames, the receive side decodes those frames
+ * on a second interface and drains the decoded packets.
+ *
+ *  Usage (e.g.): ./ns3 run "helix-ffi-batch-bench --packets=100000"
+ */
+
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+
+#include "ns3/helix-rs-interface.h"
+
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+using namespace ns3;
+
+NS_LOG_COMPONENT_DEFINE("HelixFfiBatchBench");
+
+/**
+ * Run one batch size and print a result row.
+ *
+ * \param tx The sending interface under test.
+ * \param rx The receiving interface under test.
+ * \param batchSize Number of packets per FFI call.
+ * \param nPackets Total number of packets to push through each path.
+ * \param packetSize Size of each packet in bytes.
+ */
+static void
+RunBatchSize(Ptr<HelixRsInterface> tx,
+             Ptr<HelixRsInterface> rx,
+             uint32_t batchSize,
+             uint32_t nPackets,
+             uint32_t packetSize)
+{
+    std::vector<Ptr<Packet>> batch;
+    std::vector<Ptr<Packet>> frames;
+    batch.reserve(batchSize);
+    uint32_t calls = nPackets / batchSize;
+
+    std::chrono::steady_clock::duration sendTime{0};
+    std::chrono::steady_clock::duration recvTime{0};
+    for (uint32_t c = 0; c < calls; c++)
+    {
+        batch.clear();
+        for (uint32_t i = 0; i < batchSize; i++)
+        {
+            batch.push_back(Create<Packet>(packetSize));
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        tx->SendBatch(batch);
+        frames.clear();
+        Ptr<Packet> frame;
+        while ((frame = tx->PollTransmit()))
+        {
+            frames.push_back(frame);
+        }
+        auto mid = std::chrono::steady_clock::now();
+        rx->RecvBatch(frames);
+        while (rx->PollRecv())
+        {
+        }
+        auto end = std::chrono::steady_clock::now();
+
+        sendTime += mid - start;
+        recvTime += end - mid;
+    }
+
+    double sendNs = std::chrono::duration<double, std::nano>(sendTime).count();
+    double recvNs = std::chrono::duration<double, std::nano>(recvTime).count();
+    double packets = static_cast<double>(calls) * batchSize;
+
+    std::cout << std::setw(6) << batchSize << std::setw(12) << calls << std::fixed
+              << std::setprecision(1) << std::setw(14) << sendNs / calls << std::setw(14)
+              << sendNs / packets << std::setw(14) << recvNs / calls << std::setw(14)
+              << recvNs / packets << std::setw(16) << std::setprecision(0)
+              << packets * 1e9 / recvNs << std::endl;
+}
+
+int
+main(int argc, char* argv[])
+{
+    uint32_t nPackets = 131072;
+    uint32_t packetSize = 1000;
+
+    CommandLine cmd(__FILE__);
+    cmd.AddValue("packets", "Number of packets pushed through each path", nPackets);
+    cmd.AddValue("packetSize",
+                 "Packet size in bytes, up to 1014 fits one 1024 byte symbol",
+                 packetSize);
+    cmd.Parse(argc, argv);
+
+    Ptr<HelixRsInterface> tx = CreateObject<HelixRsInterface>();
+    Ptr<HelixRsInterface> rx = CreateObject<HelixRsInterface>();
+
+    std::cout << std::setw(6) << "batch" << std::setw(12) << "calls" << std::setw(14)
+              << "send ns/call" << std::setw(14) << "send ns/pkt" << std::setw(14)
+              << "recv ns/call" << std::setw(14) << "recv ns/pkt" << std::setw(16) << "recv pkt/s"
+              << std::endl;
+
+    for (uint32_t batchSize : {1, 8, 32, 128})
+    {
+        RunBatchSize(tx, rx, batchSize, nPackets, packetSize);
+    }
+
+    tx->Dispose();
+    rx->Dispose();
+    return 0;
+}
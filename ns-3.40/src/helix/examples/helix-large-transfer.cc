@@ -20,7 +20,12 @@
 //           10Mb/s, 10ms       10Mb/s, 10ms
 //       n0-----------------n1-----------------n2
 //
-//
+// - the flow runs over HELIX, TCP or UDP (--transport), with the same
+//   link rate and delay (--bandwidth, --delay) and frame loss on the
+//   n1-n2 link (--loss), so the transports can be compared
+// - prints a CSV row with the goodput and completion time, and writes
+//   the throughput of every second to "helix-large-transfer-$transport.csv";
+//   the decode stats of HELIX go to stderr so stdout stays CSV
 // - Tracing of queues and packet receptions to file
 //   "tcp-large-transfer.tr"
 // - pcap traces also generated in the following files
@@ -39,6 +44,7 @@
 
 #include "ns3/helix-helper.h"
 #include "ns3/helix-socket.h"
+#include "ns3/helix-socket-impl.h"
 #include "ns3/helix-l4-protocol.h"
 #include "ns3/helix-socket-factory-impl.h"
 
@@ -53,9 +59,19 @@ NS_LOG_COMPONENT_DEFINE("HelixLargeTransfer");
 // NS_LOG_COMPONENT_DEFINE("HelixExample");
 
 /// The number of bytes to send in this simulation.
-static const uint32_t totalTxBytes = 2000000;
+static uint32_t totalTxBytes = 2000000;
 /// The actual number of sent bytes.
 static uint32_t currentTxBytes = 0;
+/// The number of bytes the receiver read.
+static uint64_t currentRxBytes = 0;
+/// The number of bytes the receiver had read at the previous sample.
+static uint64_t sampledRxBytes = 0;
+/// When the last byte was read.
+static Time lastRxTime;
+/// When all bytes were read, negative until then.
+static Time completionTime = Seconds(-1);
+/// Rate UDP writes are paced at, UDP has no congestion control.
+static DataRate udpRate;
 
 // Perform series of 1040 byte writes (this is a multiple of 26 since
 // we want to detect data splicing in the output stream)
@@ -86,9 +102,59 @@ void StartFlow(Ptr<Socket> localSocket, Ipv4Address servAddress, uint16_t servPo
  */
 void WriteUntilBufferFull(Ptr<Socket> localSocket, uint32_t txSpace);
 
+/**
+ * Write one datagram and schedule the next at udpRate.
+ *
+ * \param localSocket The UDP socket.
+ */
+void WriteUdp(Ptr<Socket> localSocket);
+
+/**
+ * Hook up a connection accepted by the TCP sink.
+ *
+ * \param socket The accepted socket.
+ * \param from The peer address.
+ */
+void HandleAccept(Ptr<Socket> socket, const Address& from);
+
+/**
+ * Write the throughput of the last second, until every byte arrived or
+ * the simulation stops.
+ *
+ * \param stream The output stream.
+ */
+void SampleThroughput(Ptr<OutputStreamWrapper> stream);
+
 void CloseSocket(Ptr<Socket> socket);
 void HandleRead(Ptr<Socket> socket);
 
+/**
+ * Write a changed traced value to a file.
+ *
+ * \param stream The output stream.
+ * \param oldValue The previous value.
+ * \param newValue The new value.
+ */
+template <typename T>
+void
+TraceChange(Ptr<OutputStreamWrapper> stream, T oldValue, T newValue)
+{
+    *stream->GetStream() << Simulator::Now().GetSeconds() << " " << newValue << std::endl;
+}
+
+/**
+ * Write the decode latency of a generation to a file.
+ *
+ * \param stream The output stream.
+ * \param latency The decode latency.
+ */
+void
+TraceLatency(Ptr<OutputStreamWrapper> stream, Time latency)
+{
+    *stream->GetStream() << Simulator::Now().GetSeconds() << " " << latency.GetSeconds()
+                         << std::endl;
+}
+
 
 int
 main(int argc, char* argv[])
@@ -97,11 +163,59 @@ main(int argc, char* argv[])
     // for selected modules; the below lines suggest how to do this
     //  LogComponentEnable("HelixpL4Protocol", LOG_LEVEL_ALL);
     //  LogComponentEnable("HelixSocketImpl", LOG_LEVEL_ALL);
-    LogComponentEnable("HelixLargeTransfer", LOG_LEVEL_ALL);
+    //  LogComponentEnable("HelixLargeTransfer", LOG_LEVEL_ALL);
+
+    std::string transport = "helix";
+    DataRate bandwidth("10Mbps");
+    Time delay = MilliSeconds(10);
+    double loss = 0.0;
+    std::string decoder = "Incremental";
+    std::string congestion = "NewReno";
+    bool pacing = true;
+    uint32_t rcvLowat = 1;
+    Time notifyDelay = Time(0);
+    bool traces = false;
 
     CommandLine cmd(__FILE__);
+    cmd.AddValue("transport", "Transport of the flow, helix, tcp or udp", transport);
+    cmd.AddValue("bytes", "Bytes to transfer", totalTxBytes);
+    cmd.AddValue("bandwidth", "Rate of both links", bandwidth);
+    cmd.AddValue("delay", "Delay of both links", delay);
+    cmd.AddValue("loss", "Frame loss rate of the n1-n2 link, in each direction", loss);
+    cmd.AddValue("decoder", "HELIX decoder, Incremental or Batch", decoder);
+    cmd.AddValue("congestion", "HELIX congestion control, NewReno or Bbr", congestion);
+    cmd.AddValue("pacing", "Pace HELIX frames at the congestion control's rate", pacing);
+    cmd.AddValue("rcvLowat", "Readable bytes the HELIX receive callback waits for", rcvLowat);
+    cmd.AddValue("notifyDelay", "Time HELIX receive notifications are coalesced over", notifyDelay);
+    cmd.AddValue("traces", "Write the sender's window, rtt and the receiver's decode latency", traces);
     cmd.Parse(argc, argv);
 
+    TypeId factory;
+    if (transport == "helix")
+    {
+        factory = HelixSocketFactory::GetTypeId();
+    }
+    else if (transport == "tcp")
+    {
+        factory = TcpSocketFactory::GetTypeId();
+    }
+    else if (transport == "udp")
+    {
+        factory = UdpSocketFactory::GetTypeId();
+    }
+    else
+    {
+        NS_ABORT_MSG("Unknown transport " << transport << ", use helix, tcp or udp");
+    }
+    udpRate = bandwidth;
+
+    Config::SetDefault("ns3::HelixSocket::Decoder", StringValue(decoder));
+    Config::SetDefault("ns3::HelixL4Protocol::CongestionOps",
+                       TypeIdValue(TypeId::LookupByName("ns3::Helix" + congestion)));
+    Config::SetDefault("ns3::HelixSocket::Pacing", BooleanValue(pacing));
+    Config::SetDefault("ns3::HelixSocket::RcvLowat", UintegerValue(rcvLowat));
+    Config::SetDefault("ns3::HelixSocket::NotifyDelay", TimeValue(notifyDelay));
+
     // initialize the tx buffer.
     for (uint32_t i = 0; i < writeSize; ++i)
     {
@@ -124,22 +238,32 @@ main(int argc, char* argv[])
     // First make and configure the helper, so that it will put the appropriate
     // attributes on the network interfaces and channels we are about to install.
     PointToPointHelper p2p;
-    p2p.SetDeviceAttribute("DataRate", DataRateValue(DataRate(10000000)));
-    p2p.SetChannelAttribute("Delay", TimeValue(MilliSeconds(10)));
+    p2p.SetDeviceAttribute("DataRate", DataRateValue(bandwidth));
+    p2p.SetChannelAttribute("Delay", TimeValue(delay));
 
     // And then install devices and channels connecting our topology.
     NetDeviceContainer dev0 = p2p.Install(n0n1);
     NetDeviceContainer dev1 = p2p.Install(n1n2);
 
+    // data and acks are both lost on the second link
+    if (loss > 0)
+    {
+        for (uint32_t i = 0; i < dev1.GetN(); i++)
+        {
+            Ptr<RateErrorModel> em = CreateObject<RateErrorModel>();
+            em->SetUnit(RateErrorModel::ERROR_UNIT_PACKET);
+            em->SetRate(loss);
+            dev1.Get(i)->SetAttribute("ReceiveErrorModel", PointerValue(em));
+        }
+    }
+
     // Now add ip/tcp stack to all nodes.
     InternetStackHelper internet;
     internet.InstallAll();
 
     // Aggregate helix onto nodes
     HelixStackHelper helixStackHelper;
-    helixStackHelper.AddHelix(n0n1.Get(0)); // TODO: figure out why you only have to do aggregation on one node?
-    helixStackHelper.AddHelix(n0n1.Get(1));
-    helixStackHelper.AddHelix(n1n2.Get(1));
+    helixStackHelper.InstallAll();
 
     // Later, we add IP addresses.
     Ipv4AddressHelper ipv4;
@@ -154,7 +278,7 @@ main(int argc, char* argv[])
     ///////////////////////////////////////////////////////////////////////////
     // Simulation 1
     //
-    // Send 2000000 bytes over a connection to server port 50000 at time 0
+    // Send totalTxBytes bytes over a connection to server port 50000 at time 0
     // Should observe SYN exchange, a lot of data segments and ACKS, and FIN
     // exchange.  FIN exchange isn't quite compliant with TCP spec (see release
     // notes for more info)
@@ -164,10 +288,18 @@ main(int argc, char* argv[])
     uint16_t servPort = 50000;
 
     // Create a packet sink to receive these packets on n2...
-    Ptr<Socket> remoteSocket = Socket::CreateSocket(n1n2.Get(1), HelixSocketFactory::GetTypeId());
+    Ptr<Socket> remoteSocket = Socket::CreateSocket(n1n2.Get(1), factory);
     remoteSocket->Bind(InetSocketAddress(ipInterfs.GetAddress(1), servPort));
     remoteSocket->Listen();
-    remoteSocket->SetRecvCallback(MakeCallback(&HandleRead));
+    if (transport == "tcp")
+    {
+        remoteSocket->SetAcceptCallback(MakeNullCallback<bool, Ptr<Socket>, const Address&>(),
+                                        MakeCallback(&HandleAccept));
+    }
+    else
+    {
+        remoteSocket->SetRecvCallback(MakeCallback(&HandleRead));
+    }
 
 
     // Create a source to send packets from n0.  Instead of a full Application
@@ -176,23 +308,71 @@ main(int argc, char* argv[])
     // "Application".
 
     // Create and bind the sockets...
-    Ptr<Socket> localSocket = Socket::CreateSocket(n0n1.Get(0), HelixSocketFactory::GetTypeId());
+    Ptr<Socket> localSocket = Socket::CreateSocket(n0n1.Get(0), factory);
     localSocket->Bind();
 
     // ...and schedule the sending "Application"; This is similar to what an
     // ns3::Application subclass would do internally.
     Simulator::ScheduleNow(&StartFlow, localSocket, ipInterfs.GetAddress(1), servPort);
 
-    // Ask for ASCII and pcap traces of network traffic
+    // the same paths work for any socket of any node
     AsciiTraceHelper ascii;
+    if (traces && transport == "helix")
+    {
+        Config::ConnectWithoutContext(
+            "/NodeList/0/$ns3::HelixL4Protocol/SocketList/*/CongestionWindow",
+            MakeBoundCallback(&TraceChange<uint32_t>,
+                              ascii.CreateFileStream("helix-large-transfer-cwnd.data")));
+        Config::ConnectWithoutContext(
+            "/NodeList/0/$ns3::HelixL4Protocol/SocketList/*/RTT",
+            MakeBoundCallback(&TraceChange<Time>,
+                              ascii.CreateFileStream("helix-large-transfer-rtt.data")));
+        Config::ConnectWithoutContext(
+            "/NodeList/2/$ns3::HelixL4Protocol/SocketList/*/DecodeLatency",
+            MakeBoundCallback(&TraceLatency,
+                              ascii.CreateFileStream("helix-large-transfer-latency.data")));
+    }
+
+    // Ask for ASCII and pcap traces of network traffic
     p2p.EnableAsciiAll(ascii.CreateFileStream("helix-large-transfer.tr"));
     p2p.EnablePcapAll("helix-large-transfer");
 
+    Ptr<OutputStreamWrapper> throughput =
+        ascii.CreateFileStream("helix-large-transfer-" + transport + ".csv");
+    *throughput->GetStream() << "time_s,throughput_mbps" << std::endl;
+    Simulator::Schedule(Seconds(1), &SampleThroughput, throughput);
+
     // Finally, set up the simulator to run.  The 1000 second hard limit is a
     // failsafe in case some change above causes the simulation to never end
     Simulator::Schedule(Seconds(999), &CloseSocket, remoteSocket);
     Simulator::Stop(Seconds(1000));
     Simulator::Run();
+
+    // goodput up to the last byte read, which is the completion time
+    // unless bytes were lost for good
+    double seconds = lastRxTime.GetSeconds();
+    std::cout << "transport,bandwidth_bps,delay_ms,loss,bytes_sent,bytes_received,goodput_mbps,"
+                 "completion_s"
+              << std::endl;
+    std::cout << transport << "," << bandwidth.GetBitRate() << "," << delay.GetMilliSeconds()
+              << "," << loss << "," << currentTxBytes << "," << currentRxBytes << ","
+              << (seconds > 0 ? currentRxBytes * 8 / seconds / 1e6 : 0) << ","
+              << completionTime.GetSeconds() << std::endl;
+
+    Ptr<HelixSocketImpl> helixSink = DynamicCast<HelixSocketImpl>(remoteSocket);
+    if (helixSink)
+    {
+        FFIDecodeStats stats = helixSink->GetDecodeStats();
+        std::cerr << decoder << " decoder: " << stats.generations << " generations, "
+                  << stats.recovered << " symbols recovered" << std::endl;
+        std::cerr << "  decode latency p50/p90/p99/max: "
+                  << NanoSeconds(stats.latency_p50).As(Time::MS) << " "
+                  << NanoSeconds(stats.latency_p90).As(Time::MS) << " "
+                  << NanoSeconds(stats.latency_p99).As(Time::MS) << " "
+                  << NanoSeconds(stats.latency_max).As(Time::MS) << std::endl;
+        std::cerr << "  completing symbol cpu p50/p99/max: " << stats.completion_p50 << " "
+                  << stats.completion_p99 << " " << stats.completion_max << " ns" << std::endl;
+    }
     Simulator::Destroy();
 
     return 0;
@@ -208,6 +388,12 @@ StartFlow(Ptr<Socket> localSocket, Ipv4Address servAddress, uint16_t servPort)
     NS_LOG_LOGIC("Starting flow at time " << Simulator::Now().GetSeconds());
     localSocket->Connect(InetSocketAddress(servAddress, servPort)); // connect
 
+    // udp never asks for more, it is paced at the link rate instead
+    if (DynamicCast<UdpSocket>(localSocket))
+    {
+        WriteUdp(localSocket);
+        return;
+    }
 
     // tell the helix implementation to call WriteUntilBufferFull again
     // if we blocked and new tx buffer space becomes available
@@ -239,6 +425,46 @@ WriteUntilBufferFull(Ptr<Socket> localSocket, uint32_t txSpace)
     }
 }
 
+void
+WriteUdp(Ptr<Socket> localSocket)
+{
+    uint32_t toWrite = std::min(writeSize, totalTxBytes - currentTxBytes);
+    int amountSent = localSocket->Send(&data[0], toWrite, 0);
+    if (amountSent > 0)
+    {
+        currentTxBytes += amountSent;
+    }
+    if (currentTxBytes >= totalTxBytes)
+    {
+        CloseSocket(localSocket);
+        return;
+    }
+    // with the udp, ip and ppp headers so the link queue does not grow
+    Simulator::Schedule(udpRate.CalculateBytesTxTime(toWrite + 30), &WriteUdp, localSocket);
+}
+
+void
+HandleAccept(Ptr<Socket> socket, const Address& from)
+{
+    socket->SetRecvCallback(MakeCallback(&HandleRead));
+}
+
+void
+SampleThroughput(Ptr<OutputStreamWrapper> stream)
+{
+    uint64_t bytes = currentRxBytes - sampledRxBytes;
+    sampledRxBytes = currentRxBytes;
+    *stream->GetStream() << Simulator::Now().GetSeconds() << "," << bytes * 8 / 1e6 << std::endl;
+
+    // a quiet second may be a repair timeout or a stall, only the end of
+    // the transfer or Simulator::Stop ends the series
+    if (currentRxBytes >= totalTxBytes)
+    {
+        return;
+    }
+    Simulator::Schedule(Seconds(1), &SampleThroughput, stream);
+}
+
 void
 HandleRead(Ptr<Socket> socket)
 {
@@ -246,6 +472,12 @@ HandleRead(Ptr<Socket> socket)
     Address from;
     while ((packet = socket->RecvFrom(from)))
     {
+        currentRxBytes += packet->GetSize();
+        lastRxTime = Simulator::Now();
+        if (completionTime.IsNegative() && currentRxBytes >= totalTxBytes)
+        {
+            completionTime = Simulator::Now();
+        }
         if (InetSocketAddress::IsMatchingType(from))
         {
             NS_LOG_INFO("At time " << Simulator::Now().As(Time::S) << " server received "
@@ -0,0 +1,359 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+//
+// Network topology
+//
+//       s0                                   r0
+//         \ leafRate                leafRate /
+//       s1 --- router0 ------------- router1 --- r1
+//         /     bottleneckRate, loss         \ .
+//       sN-1                                 rM-1
+//
+// - flows HELIX flows, flow i goes from sender i % N to receiver i % M,
+//   each on its own pair of sockets, started at random within startWindow
+// - every flow writes flowBytes then closes, or keeps writing if 0
+// - loss drops frames at the receiving end of the bottleneck, both ways
+// - idleSockets sockets are spread over the receivers and never used
+//
+// Reports the simulated goodput, over the time each flow was active from
+// its start to the last byte read, along with the cost of simulating it:
+// wall clock time, simulator events per second and the peak resident
+// set size of the process. With idleSockets, the resident set size
+// before and after creating the idle sockets is reported too.
+//
+//  Usage (e.g.): ./ns3 run "helix-many-flows --senders=50 --receivers=50 --flows=2000"
+//                ./ns3 run "helix-many-flows --flows=0 --idleSockets=100000"
+
+#include "ns3/core-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/ipv4-global-routing-helper.h"
+#include "ns3/network-module.h"
+#include "ns3/point-to-point-layout-module.h"
+#include "ns3/point-to-point-module.h"
+
+#include "ns3/helix-helper.h"
+#include "ns3/helix-l4-protocol.h"
+#include "ns3/helix-socket-factory-impl.h"
+#include "ns3/helix-socket.h"
+
+#include <sys/resource.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+using namespace ns3;
+
+NS_LOG_COMPONENT_DEFINE("HelixManyFlows");
+
+/// Bytes per Send() of every flow
+static const uint32_t writeSize = 1040;
+
+/// Bytes each flow writes, 0 to write until the simulation stops
+static uint64_t flowBytes = 0;
+
+/// Bytes written by each flow
+static std::vector<uint64_t> sentBytes;
+
+/// Bytes read by each flow
+static std::vector<uint64_t> receivedBytes;
+
+/// When each flow started writing
+static std::vector<Time> flowStart;
+
+/// When each flow read its last byte
+static std::vector<Time> flowLastRx;
+
+/**
+ * Connect a flow and start writing.
+ *
+ * \param flow The flow index.
+ * \param socket The sending socket.
+ * \param address The receiver address.
+ */
+void StartFlow(uint32_t flow, Ptr<Socket> socket, InetSocketAddress address);
+
+/**
+ * Write until the transmit buffer is full, close once flowBytes were written.
+ *
+ * \param flow The flow index.
+ * \param socket The sending socket.
+ * \param txSpace The free space in the transmit buffer.
+ */
+void WriteUntilBufferFull(uint32_t flow, Ptr<Socket> socket, uint32_t txSpace);
+
+/**
+ * Read everything a receiving socket holds.
+ *
+ * \param flow The flow index.
+ * \param socket The receiving socket.
+ */
+void HandleRead(uint32_t flow, Ptr<Socket> socket);
+
+/**
+ * Get the peak resident set size of this process.
+ *
+ * \return peak RSS in bytes
+ */
+static uint64_t
+PeakRss()
+{
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+    return usage.ru_maxrss;
+#else
+    return static_cast<uint64_t>(usage.ru_maxrss) * 1024;
+#endif
+}
+
+/**
+ * Get the resident set size of this process.
+ *
+ * \return RSS in bytes, the peak RSS where the current one is unknown
+ */
+static uint64_t
+CurrentRss()
+{
+#ifdef __linux__
+    std::ifstream statm("/proc/self/statm");
+    uint64_t size = 0;
+    uint64_t resident = 0;
+    if (statm >> size >> resident)
+    {
+        return resident * static_cast<uint64_t>(sysconf(_SC_PAGESIZE));
+    }
+#endif
+    return PeakRss();
+}
+
+int
+main(int argc, char* argv[])
+{
+    uint32_t nSenders = 10;
+    uint32_t nReceivers = 10;
+    uint32_t nFlows = 100;
+    uint32_t nIdle = 0;
+    DataRate leafRate("100Mbps");
+    DataRate bottleneckRate("1Gbps");
+    Time delay = MilliSeconds(5);
+    double loss = 0.0;
+    Time startWindow = Seconds(1);
+    Time duration = Seconds(10);
+    uint32_t seed = 1;
+
+    CommandLine cmd(__FILE__);
+    cmd.AddValue("senders", "Number of sender nodes", nSenders);
+    cmd.AddValue("receivers", "Number of receiver nodes", nReceivers);
+    cmd.AddValue("flows", "Number of HELIX flows", nFlows);
+    cmd.AddValue("idleSockets", "Sockets created and never used, to measure their memory", nIdle);
+    cmd.AddValue("flowBytes", "Bytes written by each flow, 0 to write until the end", flowBytes);
+    cmd.AddValue("leafRate", "Rate of the links to the routers", leafRate);
+    cmd.AddValue("bottleneckRate", "Rate of the link between the routers", bottleneckRate);
+    cmd.AddValue("delay", "Delay of every link", delay);
+    cmd.AddValue("loss", "Frame loss rate of the bottleneck, in each direction", loss);
+    cmd.AddValue("startWindow", "Flows start at random within this time", startWindow);
+    cmd.AddValue("duration", "Simulated time", duration);
+    cmd.AddValue("seed", "Run number of the random streams", seed);
+    cmd.Parse(argc, argv);
+
+    RngSeedManager::SetRun(seed);
+
+    PointToPointHelper leaf;
+    leaf.SetDeviceAttribute("DataRate", DataRateValue(leafRate));
+    leaf.SetChannelAttribute("Delay", TimeValue(delay));
+    PointToPointHelper bottleneck;
+    bottleneck.SetDeviceAttribute("DataRate", DataRateValue(bottleneckRate));
+    bottleneck.SetChannelAttribute("Delay", TimeValue(delay));
+    PointToPointDumbbellHelper dumbbell(nSenders, leaf, nReceivers, leaf, bottleneck);
+
+    // the bottleneck devices were installed first on both routers
+    if (loss > 0)
+    {
+        for (Ptr<Node> router : {dumbbell.GetLeft(), dumbbell.GetRight()})
+        {
+            Ptr<RateErrorModel> em = CreateObject<RateErrorModel>();
+            em->SetUnit(RateErrorModel::ERROR_UNIT_PACKET);
+            em->SetRate(loss);
+            router->GetDevice(0)->SetAttribute("ReceiveErrorModel", PointerValue(em));
+        }
+    }
+
+    InternetStackHelper internet;
+    dumbbell.InstallStack(internet);
+    dumbbell.AssignIpv4Addresses(Ipv4AddressHelper("10.1.0.0", "255.255.255.0"),
+                                 Ipv4AddressHelper("10.2.0.0", "255.255.255.0"),
+                                 Ipv4AddressHelper("10.3.0.0", "255.255.255.0"));
+    Ipv4GlobalRoutingHelper::PopulateRoutingTables();
+
+    HelixStackHelper helixStackHelper;
+    for (uint32_t i = 0; i < nSenders; i++)
+    {
+        helixStackHelper.Install(dumbbell.GetLeft(i));
+    }
+    for (uint32_t i = 0; i < nReceivers; i++)
+    {
+        helixStackHelper.Install(dumbbell.GetRight(i));
+    }
+
+    // a socket that is never bound holds no helix-rs connection and no
+    // UDP socket, this shows what is left
+    std::vector<Ptr<Socket>> idleSockets;
+    if (nIdle > 0)
+    {
+        idleSockets.reserve(nIdle);
+        uint64_t before = CurrentRss();
+        for (uint32_t i = 0; i < nIdle; i++)
+        {
+            idleSockets.push_back(Socket::CreateSocket(dumbbell.GetRight(i % nReceivers),
+                                                       HelixSocketFactory::GetTypeId()));
+        }
+        uint64_t after = CurrentRss();
+        uint64_t grown = after > before ? after - before : 0;
+        std::cout << nIdle << " idle sockets: RSS " << before / (1024.0 * 1024.0)
+                  << " MiB before, " << after / (1024.0 * 1024.0) << " MiB after, "
+                  << grown / nIdle << " bytes per socket" << std::endl;
+    }
+
+    sentBytes.assign(nFlows, 0);
+    receivedBytes.assign(nFlows, 0);
+    flowStart.assign(nFlows, Time(0));
+    flowLastRx.assign(nFlows, Time(0));
+    Ptr<UniformRandomVariable> start = CreateObject<UniformRandomVariable>();
+    start->SetAttribute("Max", DoubleValue(startWindow.GetSeconds()));
+    for (uint32_t flow = 0; flow < nFlows; flow++)
+    {
+        uint32_t receiver = flow % nReceivers;
+        InetSocketAddress address(dumbbell.GetRightIpv4Address(receiver),
+                                  static_cast<uint16_t>(10000 + flow / nReceivers));
+
+        Ptr<Socket> sink =
+            Socket::CreateSocket(dumbbell.GetRight(receiver), HelixSocketFactory::GetTypeId());
+        sink->Bind(address);
+        sink->Listen();
+        sink->SetRecvCallback(MakeBoundCallback(&HandleRead, flow));
+
+        Ptr<Socket> source = Socket::CreateSocket(dumbbell.GetLeft(flow % nSenders),
+                                                  HelixSocketFactory::GetTypeId());
+        source->Bind();
+        Simulator::Schedule(Seconds(start->GetValue()), &StartFlow, flow, source, address);
+    }
+
+    std::cout << "Simulating " << nFlows << " flows from " << nSenders << " to " << nReceivers
+              << " nodes for " << duration.As(Time::S) << std::endl;
+
+    Simulator::Stop(duration);
+    auto wallStart = std::chrono::steady_clock::now();
+    Simulator::Run();
+    double wall =
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - wallStart).count();
+
+    // flows start at random and finished ones stop reading, so every
+    // goodput is taken over the time its flows were active
+    uint64_t received = 0;
+    uint32_t completed = 0;
+    uint32_t active = 0;
+    double goodputSum = 0;
+    double goodputMin = 0;
+    double goodputMax = 0;
+    Time firstStart = Time::Max();
+    Time lastRx = Time(0);
+    for (uint32_t flow = 0; flow < nFlows; flow++)
+    {
+        received += receivedBytes[flow];
+        completed += flowBytes > 0 && receivedBytes[flow] >= flowBytes;
+        if (receivedBytes[flow] == 0)
+        {
+            continue;
+        }
+        double goodput = receivedBytes[flow] * 8 /
+                         (flowLastRx[flow] - flowStart[flow]).GetSeconds() / 1e6;
+        goodputSum += goodput;
+        goodputMin = active == 0 ? goodput : std::min(goodputMin, goodput);
+        goodputMax = std::max(goodputMax, goodput);
+        active++;
+        firstStart = std::min(firstStart, flowStart[flow]);
+        lastRx = std::max(lastRx, flowLastRx[flow]);
+    }
+    uint64_t events = Simulator::GetEventCount();
+
+    double seconds = active > 0 ? (lastRx - firstStart).GetSeconds() : 0;
+    std::cout << "  goodput: " << (active > 0 ? received * 8 / seconds / 1e6 : 0)
+              << " Mb/s over " << seconds << " s, " << received << " bytes";
+    if (flowBytes > 0)
+    {
+        std::cout << ", " << completed << "/" << nFlows << " flows complete";
+    }
+    std::cout << std::endl;
+    std::cout << "  goodput per flow mean/min/max: " << (active > 0 ? goodputSum / active : 0)
+              << " " << goodputMin << " " << goodputMax << " Mb/s, " << active << "/" << nFlows
+              << " flows received data" << std::endl;
+    std::cout << "  wall clock: " << wall << " s, " << duration.GetSeconds() / wall
+              << " simulated s per s" << std::endl;
+    std::cout << "  events: " << events << ", " << events / wall << " per s" << std::endl;
+    std::cout << "  peak RSS: " << PeakRss() / (1024.0 * 1024.0) << " MiB" << std::endl;
+
+    Simulator::Destroy();
+    return 0;
+}
+
+void
+StartFlow(uint32_t flow, Ptr<Socket> socket, InetSocketAddress address)
+{
+    flowStart[flow] = Simulator::Now();
+    socket->Connect(address);
+    socket->SetSendCallback(MakeBoundCallback(&WriteUntilBufferFull, flow));
+    WriteUntilBufferFull(flow, socket, socket->GetTxAvailable());
+}
+
+void
+WriteUntilBufferFull(uint32_t flow, Ptr<Socket> socket, uint32_t txSpace)
+{
+    while ((flowBytes == 0 || sentBytes[flow] < flowBytes) && socket->GetTxAvailable() > 0)
+    {
+        uint32_t toWrite = std::min(writeSize, socket->GetTxAvailable());
+        if (flowBytes > 0)
+        {
+            toWrite =
+                static_cast<uint32_t>(std::min<uint64_t>(toWrite, flowBytes - sentBytes[flow]));
+        }
+        int amountSent = socket->Send(Create<Packet>(toWrite));
+        if (amountSent < 0)
+        {
+            // we will be called again when new tx space becomes available
+            return;
+        }
+        sentBytes[flow] += amountSent;
+    }
+    if (flowBytes > 0 && sentBytes[flow] >= flowBytes)
+    {
+        socket->Close();
+    }
+}
+
+void
+HandleRead(uint32_t flow, Ptr<Socket> socket)
+{
+    for (Ptr<Packet> packet = socket->Recv(); packet; packet = socket->Recv())
+    {
+        receivedBytes[flow] += packet->GetSize();
+        flowLastRx[flow] = Simulator::Now();
+    }
+}
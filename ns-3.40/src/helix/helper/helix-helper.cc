@@ -1,25 +1,52 @@
 #include "helix-helper.h"
-#include "ns3/helix-socket-factory-impl.h"
 #include "ns3/node.h"
 #include "ns3/assert.h"
+#include "ns3/log.h"
 
 namespace ns3
 {
 
+NS_LOG_COMPONENT_DEFINE("HelixStackHelper");
+
+void
+HelixStackHelper::Install(Ptr<Node> node) const
+{
+    NS_ASSERT(node);
+
+    if (node->GetObject<HelixL4Protocol>())
+    {
+        NS_LOG_WARN("HELIX is already installed on node " << node->GetId());
+        return;
+    }
+    // the protocol sets its node and aggregates the socket factory once
+    // it sees the IP stack of the node
+    node->AggregateObject(CreateObject<HelixL4Protocol>());
+}
+
+void
+HelixStackHelper::Install(NodeContainer c) const
+{
+    for (auto i = c.Begin(); i != c.End(); ++i)
+    {
+        Install(*i);
+    }
+}
+
+void
+HelixStackHelper::InstallAll() const
+{
+    Install(NodeContainer::GetGlobal());
+}
+
 void
 HelixStackHelper::AddHelix(Ptr<Node> node, Ptr<HelixL4Protocol> helix)
 {
     NS_ASSERT(node);
 
-    // aggregate helix l4 protocol into node
+    // aggregate helix l4 protocol into node, it aggregates its own
+    // socket factory
     if (!helix) helix = CreateObject<HelixL4Protocol>();
-    helix->SetNode(node);
     node->AggregateObject(helix);
-
-    // aggregate helix socket factory impl into node
-    Ptr<HelixSocketFactoryImpl> helixFactoryImpl = CreateObject<HelixSocketFactoryImpl>();
-    helixFactoryImpl->SetHelix(helix);
-    node->AggregateObject(helixFactoryImpl);
 }
 
 void
@@ -27,8 +54,7 @@ HelixStackHelper::AddHelix(Ptr<Node> node)
 {
     NS_ASSERT(node);
 
-    Ptr<HelixL4Protocol> helix = CreateObject<HelixL4Protocol>();
-    AddHelix(node, helix);
+    Install(node);
 }
 
 } // namespace ns3
@@ -5,6 +5,7 @@
 #include "ns3/helix-l4-protocol.h"
 #include "ns3/core-module.h"
 #include "ns3/node.h"
+#include "ns3/node-container.h"
 
 
 namespace ns3
@@ -15,17 +16,38 @@ class Node;
 
 class HelixL4Protocol;
 
-// Each class should be documented using Doxygen,
-// and have an \ingroup helix directive
-
-/* ... */
-
+/**
+ * \ingroup helix
+ *
+ * \brief Aggregate HELIX onto nodes
+ *
+ * Every node gets one HelixL4Protocol. The protocol aggregates the one
+ * HelixSocketFactory of the node itself, as soon as the node has an IP
+ * stack, so HELIX can be installed before or after InternetStackHelper.
+ */
 class HelixStackHelper
 {
   public:
     HelixStackHelper() {}
     ~HelixStackHelper() {}
 
+    /**
+     * \brief Install HELIX on a node, nodes that already have it are skipped
+     * \param node the node
+     */
+    void Install(Ptr<Node> node) const;
+
+    /**
+     * \brief Install HELIX on every node of a container
+     * \param c the nodes
+     */
+    void Install(NodeContainer c) const;
+
+    /**
+     * \brief Install HELIX on every node of the simulation
+     */
+    void InstallAll() const;
+
     // Adds given helix l4 protocol to a node
     void AddHelix(Ptr<Node> node, Ptr<HelixL4Protocol> helix);
 
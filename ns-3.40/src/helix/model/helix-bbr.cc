@@ -0,0 +1,210 @@
+
+#include "helix-bbr.h"
+
+#include "ns3/double.h"
+#include "ns3/log.h"
+#include "ns3/uinteger.h"
+
+#include <algorithm>
+#include <limits>
+
+namespace ns3
+{
+
+NS_LOG_COMPONENT_DEFINE("HelixBbr");
+
+NS_OBJECT_ENSURE_REGISTERED(HelixBbr);
+
+/// Pacing gains of the PROBE_BW phases, one phase per round
+static const double PROBE_BW_GAINS[] = {1.25, 0.75, 1, 1, 1, 1, 1, 1};
+
+TypeId
+HelixBbr::GetTypeId()
+{
+    static TypeId tid =
+        TypeId("ns3::HelixBbr")
+            .SetParent<HelixCongestionOps>()
+            .SetGroupName("Internet")
+            .AddConstructor<HelixBbr>()
+            .AddAttribute("HighGain",
+                          "Pacing and cwnd gain of STARTUP, 2/ln(2) doubles the rate every round",
+                          DoubleValue(2.885),
+                          MakeDoubleAccessor(&HelixBbr::m_highGain),
+                          MakeDoubleChecker<double>(1))
+            .AddAttribute("CwndGain",
+                          "Congestion window in bandwidth delay products after STARTUP",
+                          DoubleValue(2),
+                          MakeDoubleAccessor(&HelixBbr::m_cwndGain),
+                          MakeDoubleChecker<double>(1))
+            .AddAttribute("BwWindowLength",
+                          "Rounds over which the max delivery rate is taken",
+                          UintegerValue(10),
+                          MakeUintegerAccessor(&HelixBbr::m_bwWindow),
+                          MakeUintegerChecker<uint32_t>(1))
+            .AddAttribute("MinRttWindow",
+                          "Lifetime of a min rtt sample",
+                          TimeValue(Seconds(10)),
+                          MakeTimeAccessor(&HelixBbr::m_minRttWindow),
+                          MakeTimeChecker());
+    return tid;
+}
+
+HelixBbr::HelixBbr()
+    : m_highGain(2.885),
+      m_cwndGain(2),
+      m_bwWindow(10),
+      m_minRttWindow(Seconds(10)),
+      m_mode(STARTUP),
+      m_pacingGain(2.885),
+      m_cycleIndex(0),
+      m_round(0),
+      m_minRtt(Time(0)),
+      m_minRttStamp(Time(0)),
+      m_roundStart(Time(0)),
+      m_roundBytes(0),
+      m_fullBw(DataRate(0)),
+      m_fullBwCount(0)
+{
+    NS_LOG_FUNCTION(this);
+}
+
+HelixBbr::~HelixBbr()
+{
+    NS_LOG_FUNCTION(this);
+}
+
+std::string
+HelixBbr::GetName() const
+{
+    return "HelixBbr";
+}
+
+HelixBbr::BbrMode_t
+HelixBbr::GetMode() const
+{
+    return m_mode;
+}
+
+DataRate
+HelixBbr::GetBottleneckBandwidth() const
+{
+    return m_bwSamples.empty() ? DataRate(0) : m_bwSamples.front().second;
+}
+
+Time
+HelixBbr::GetMinRtt() const
+{
+    return m_minRtt;
+}
+
+uint64_t
+HelixBbr::TargetInFlight(double gain) const
+{
+    return static_cast<uint64_t>(gain * GetBottleneckBandwidth().GetBitRate() / 8 *
+                                 m_minRtt.GetSeconds());
+}
+
+void
+HelixBbr::OnSample(const FFICongestionSample& sample, Time now)
+{
+    NS_LOG_FUNCTION(this << sample.acked_bytes << sample.in_flight << sample.rtt_ns << now);
+
+    if (sample.rtt_ns > 0)
+    {
+        Time rtt = NanoSeconds(sample.rtt_ns);
+        if (m_minRtt.IsZero() || rtt <= m_minRtt || now - m_minRttStamp > m_minRttWindow)
+        {
+            m_minRtt = rtt;
+            m_minRttStamp = now;
+        }
+    }
+
+    // rounds need the min rtt, until then only the window grows
+    if (m_minRtt.IsZero())
+    {
+        m_roundStart = now;
+    }
+    else
+    {
+        m_roundBytes += sample.acked_bytes;
+        Time elapsed = now - m_roundStart;
+        if (elapsed >= m_minRtt)
+        {
+            OnRoundEnd(DataRate(static_cast<uint64_t>(m_roundBytes * 8 / elapsed.GetSeconds())),
+                       sample.in_flight);
+            m_roundStart = now;
+            m_roundBytes = 0;
+        }
+    }
+
+    // loss is not a signal here, only the model of the path is
+    uint64_t cwnd = m_cWnd;
+    uint64_t target = TargetInFlight(m_mode == STARTUP ? m_highGain : m_cwndGain);
+    if (m_mode != STARTUP)
+    {
+        cwnd = std::min(cwnd + sample.acked_bytes, target);
+    }
+    else if (cwnd < target || target == 0)
+    {
+        cwnd += sample.acked_bytes;
+    }
+    cwnd = std::max<uint64_t>(cwnd, 4 * m_segmentSize);
+    m_cWnd = static_cast<uint32_t>(
+        std::min<uint64_t>(cwnd, std::numeric_limits<uint32_t>::max()));
+
+    DataRate bw = GetBottleneckBandwidth();
+    if (bw.GetBitRate() > 0)
+    {
+        m_pacingRate = DataRate(static_cast<uint64_t>(m_pacingGain * bw.GetBitRate()));
+    }
+}
+
+void
+HelixBbr::OnRoundEnd(DataRate rate, uint64_t inFlight)
+{
+    NS_LOG_FUNCTION(this << rate << inFlight);
+
+    // windowed max: keep the samples that can still become the max
+    m_round++;
+    while (!m_bwSamples.empty() && m_bwSamples.back().second <= rate)
+    {
+        m_bwSamples.pop_back();
+    }
+    m_bwSamples.emplace_back(m_round, rate);
+    while (m_bwSamples.front().first + m_bwWindow <= m_round)
+    {
+        m_bwSamples.pop_front();
+    }
+    DataRate bw = GetBottleneckBandwidth();
+
+    if (m_mode == STARTUP)
+    {
+        if (bw.GetBitRate() >= m_fullBw.GetBitRate() * 1.25)
+        {
+            m_fullBw = bw;
+            m_fullBwCount = 0;
+        }
+        else if (++m_fullBwCount >= 3)
+        {
+            NS_LOG_LOGIC("pipe full at " << bw << ", draining");
+            m_mode = DRAIN;
+            m_pacingGain = 1 / m_highGain;
+        }
+    }
+    if (m_mode == DRAIN)
+    {
+        if (inFlight <= TargetInFlight(1))
+        {
+            m_mode = PROBE_BW;
+            m_cycleIndex = 2;
+            m_pacingGain = PROBE_BW_GAINS[m_cycleIndex];
+        }
+    }
+    else if (m_mode == PROBE_BW)
+    {
+        m_cycleIndex = (m_cycleIndex + 1) % 8;
+        m_pacingGain = PROBE_BW_GAINS[m_cycleIndex];
+    }
+}
+
+} // namespace ns3
@@ -0,0 +1,110 @@
+/*
+ * BBR-like congestion control for HELIX sockets
+ *
+ * The sender models the path by its bottleneck bandwidth (windowed max of
+ * the delivery rate) and its propagation delay (windowed min of the round
+ * trip time) and sends at that rate instead of backing off on loss, which
+ * suits a coded transport whose losses are mostly repaired anyway.
+ *
+ * Delivery rate samples are taken once per minimum round trip time from
+ * the bytes of the generations acked in it, which also serves as the
+ * round counter. The state machine is STARTUP, DRAIN and an 8 phase
+ * PROBE_BW gain cycle; there is no PROBE_RTT, the minimum round trip time
+ * simply expires after MinRttWindow.
+ */
+#ifndef HELIX_BBR_H
+#define HELIX_BBR_H
+
+#include "helix-congestion-ops.h"
+
+#include <deque>
+#include <utility>
+
+namespace ns3
+{
+
+/**
+ * \ingroup helix
+ *
+ * \brief BBR-like rate based congestion control, ignoring loss
+ */
+class HelixBbr : public HelixCongestionOps
+{
+  public:
+    /**
+     * \brief Get the type ID.
+     * \return the object TypeId
+     */
+    static TypeId GetTypeId();
+
+    /**
+     * \brief BBR modes
+     */
+    enum BbrMode_t
+    {
+        STARTUP,  //!< double the sending rate every round until the bandwidth stops growing
+        DRAIN,    //!< drain the queue STARTUP built up
+        PROBE_BW, //!< cycle the pacing gain around the bottleneck bandwidth
+    };
+
+    HelixBbr();
+    ~HelixBbr() override;
+
+    std::string GetName() const override;
+    void OnSample(const FFICongestionSample& sample, Time now) override;
+
+    /**
+     * \brief Get the current mode
+     * \return mode
+     */
+    BbrMode_t GetMode() const;
+
+    /**
+     * \brief Get the bottleneck bandwidth estimate
+     * \return max delivery rate over the last BwWindowLength rounds
+     */
+    DataRate GetBottleneckBandwidth() const;
+
+    /**
+     * \brief Get the propagation delay estimate
+     * \return min round trip time, zero before the first sample
+     */
+    Time GetMinRtt() const;
+
+  private:
+    /**
+     * \brief Close a round: record its delivery rate and advance the
+     *        state machine
+     * \param rate delivery rate of the round
+     * \param inFlight bytes in flight
+     */
+    void OnRoundEnd(DataRate rate, uint64_t inFlight);
+
+    /**
+     * \brief Bandwidth delay product times gain
+     * \param gain gain
+     * \return bytes
+     */
+    uint64_t TargetInFlight(double gain) const;
+
+    double m_highGain;       //!< pacing and cwnd gain of STARTUP
+    double m_cwndGain;       //!< cwnd gain outside of STARTUP
+    uint32_t m_bwWindow;     //!< rounds the bandwidth filter covers
+    Time m_minRttWindow;     //!< lifetime of a min rtt sample
+
+    BbrMode_t m_mode;        //!< current mode
+    double m_pacingGain;     //!< current pacing gain
+    uint32_t m_cycleIndex;   //!< phase of the PROBE_BW gain cycle
+    uint64_t m_round;        //!< rounds completed
+    std::deque<std::pair<uint64_t, DataRate>> m_bwSamples; //!< (round, rate), rates decreasing
+    Time m_minRtt;           //!< min rtt within m_minRttWindow
+    Time m_minRttStamp;      //!< when m_minRtt was taken
+    Time m_roundStart;       //!< start of the current round
+    uint64_t m_roundBytes;   //!< bytes acked in the current round
+    DataRate m_fullBw;       //!< bandwidth STARTUP last grew to
+    uint32_t m_fullBwCount;  //!< rounds without 25% growth
+};
+
+} // namespace ns3
+
+#endif /* HELIX_BBR_H */
@@ -0,0 +1,172 @@
+
+#include "helix-congestion-ops.h"
+
+#include "ns3/double.h"
+#include "ns3/log.h"
+#include "ns3/trace-source-accessor.h"
+#include "ns3/uinteger.h"
+
+#include <algorithm>
+#include <limits>
+
+namespace ns3
+{
+
+NS_LOG_COMPONENT_DEFINE("HelixCongestionOps");
+
+NS_OBJECT_ENSURE_REGISTERED(HelixCongestionOps);
+
+TypeId
+HelixCongestionOps::GetTypeId()
+{
+    static TypeId tid =
+        TypeId("ns3::HelixCongestionOps")
+            .SetParent<Object>()
+            .SetGroupName("Internet")
+            .AddAttribute("InitialCwnd",
+                          "Initial congestion window in frames",
+                          UintegerValue(10),
+                          MakeUintegerAccessor(&HelixCongestionOps::m_initialCwnd),
+                          MakeUintegerChecker<uint32_t>(1))
+            .AddTraceSource("CongestionWindow",
+                            "Bytes of coded frames allowed in flight",
+                            MakeTraceSourceAccessor(&HelixCongestionOps::m_cWnd),
+                            "ns3::TracedValueCallback::Uint32")
+            .AddTraceSource("PacingRate",
+                            "Rate at which coded frames are paced, 0 if unpaced",
+                            MakeTraceSourceAccessor(&HelixCongestionOps::m_pacingRate),
+                            "ns3::TracedValueCallback::DataRate");
+    return tid;
+}
+
+HelixCongestionOps::HelixCongestionOps()
+    : m_segmentSize(helix_rs_default_coding_config().symbol_size + FRAME_HEADER_SIZE),
+      m_initialCwnd(10),
+      m_cWnd(m_initialCwnd * m_segmentSize),
+      m_pacingRate(DataRate(0))
+{
+    NS_LOG_FUNCTION(this);
+}
+
+HelixCongestionOps::~HelixCongestionOps()
+{
+    NS_LOG_FUNCTION(this);
+}
+
+void
+HelixCongestionOps::SetSegmentSize(uint32_t size)
+{
+    NS_LOG_FUNCTION(this << size);
+    m_segmentSize = size;
+    m_cWnd = m_initialCwnd * size;
+}
+
+uint32_t
+HelixCongestionOps::GetCwnd() const
+{
+    return m_cWnd;
+}
+
+DataRate
+HelixCongestionOps::GetPacingRate() const
+{
+    return m_pacingRate;
+}
+
+/* -------------------- HelixNewReno -------------------- */
+
+NS_OBJECT_ENSURE_REGISTERED(HelixNewReno);
+
+TypeId
+HelixNewReno::GetTypeId()
+{
+    static TypeId tid =
+        TypeId("ns3::HelixNewReno")
+            .SetParent<HelixCongestionOps>()
+            .SetGroupName("Internet")
+            .AddConstructor<HelixNewReno>()
+            .AddAttribute("PacingSsRatio",
+                          "Pacing rate in slow start, in windows per smoothed rtt",
+                          DoubleValue(2),
+                          MakeDoubleAccessor(&HelixNewReno::m_pacingSsRatio),
+                          MakeDoubleChecker<double>(0))
+            .AddAttribute("PacingCaRatio",
+                          "Pacing rate in congestion avoidance, in windows per smoothed rtt",
+                          DoubleValue(1.2),
+                          MakeDoubleAccessor(&HelixNewReno::m_pacingCaRatio),
+                          MakeDoubleChecker<double>(0));
+    return tid;
+}
+
+HelixNewReno::HelixNewReno()
+    : m_pacingSsRatio(2),
+      m_pacingCaRatio(1.2),
+      m_ssThresh(std::numeric_limits<uint32_t>::max()),
+      m_srtt(Time(0)),
+      m_recoveryEnd(Time(0))
+{
+    NS_LOG_FUNCTION(this);
+}
+
+HelixNewReno::~HelixNewReno()
+{
+    NS_LOG_FUNCTION(this);
+}
+
+std::string
+HelixNewReno::GetName() const
+{
+    return "HelixNewReno";
+}
+
+uint32_t
+HelixNewReno::GetSsThresh() const
+{
+    return m_ssThresh;
+}
+
+void
+HelixNewReno::OnSample(const FFICongestionSample& sample, Time now)
+{
+    NS_LOG_FUNCTION(this << sample.acked_bytes << sample.repair_rounds << now);
+
+    if (sample.rtt_ns > 0)
+    {
+        Time rtt = NanoSeconds(sample.rtt_ns);
+        m_srtt = m_srtt.IsZero() ? rtt : m_srtt + (rtt - m_srtt) / 8;
+    }
+
+    // every generation that timed out in the same window reports its own
+    // repair round, only the first one is a new congestion event
+    if (sample.repair_rounds > 0 && now >= m_recoveryEnd)
+    {
+        m_ssThresh = std::max<uint32_t>(m_cWnd / 2, 2 * m_segmentSize);
+        m_cWnd = m_ssThresh;
+        m_recoveryEnd = now + m_srtt;
+        NS_LOG_LOGIC("repair round, cwnd " << m_cWnd);
+    }
+    else if (sample.acked_bytes > 0)
+    {
+        uint64_t cwnd = m_cWnd;
+        if (cwnd < m_ssThresh)
+        {
+            cwnd = std::min<uint64_t>(cwnd + sample.acked_bytes, m_ssThresh);
+        }
+        else
+        {
+            cwnd += std::max<uint64_t>(1, uint64_t(m_segmentSize) * sample.acked_bytes / cwnd);
+        }
+        m_cWnd = static_cast<uint32_t>(
+            std::min<uint64_t>(cwnd, std::numeric_limits<uint32_t>::max()));
+    }
+
+    // spread the window over a round trip, faster in slow start so the
+    // pacer does not hold back the window's growth
+    if (!m_srtt.IsZero())
+    {
+        double ratio = m_cWnd < m_ssThresh ? m_pacingSsRatio : m_pacingCaRatio;
+        m_pacingRate = DataRate(static_cast<uint64_t>(ratio * m_cWnd * 8 / m_srtt.GetSeconds()));
+    }
+}
+
+} // namespace ns3
@@ -0,0 +1,133 @@
+/*
+ * Congestion control for HELIX sockets
+ *
+ * A HelixCongestionOps decides how many bytes of coded frames a socket
+ * may have in flight and, optionally, the rate at which they are paced.
+ * The algorithm is picked per protocol instance with the
+ * ns3::HelixL4Protocol::CongestionOps attribute and every socket gets its
+ * own instance.
+ *
+ * Algorithms only see the congestion signals helix-rs gathers per
+ * connection (FFICongestionSample): acked bytes, round trip times and the
+ * repair rounds a timeout triggered. Frame losses that the first round of
+ * repairs absorbed are recovered by the coding and are never reported as
+ * congestion.
+ */
+#ifndef HELIX_CONGESTION_OPS_H
+#define HELIX_CONGESTION_OPS_H
+
+#include "helix-rs-interface.h"
+
+#include "ns3/data-rate.h"
+#include "ns3/nstime.h"
+#include "ns3/object.h"
+#include "ns3/traced-value.h"
+
+#include <stdint.h>
+#include <string>
+
+namespace ns3
+{
+
+/**
+ * \ingroup helix
+ *
+ * \brief Interface of the congestion control algorithms of HELIX sockets
+ *
+ * Windows are kept in bytes of coded frames, acks do not count.
+ */
+class HelixCongestionOps : public Object
+{
+  public:
+    /**
+     * \brief Get the type ID.
+     * \return the object TypeId
+     */
+    static TypeId GetTypeId();
+
+    HelixCongestionOps();
+    ~HelixCongestionOps() override;
+
+    /**
+     * \brief Get the name of the congestion control algorithm
+     * \return A string identifying the name
+     */
+    virtual std::string GetName() const = 0;
+
+    /**
+     * \brief Set the size of a full coded frame and reset the window to
+     *        InitialCwnd frames
+     * \param size frame size in bytes
+     */
+    virtual void SetSegmentSize(uint32_t size);
+
+    /**
+     * \brief React to the congestion signals of the latest acks and
+     *        repair timeouts
+     * \param sample signals gathered since the previous call
+     * \param now current time
+     */
+    virtual void OnSample(const FFICongestionSample& sample, Time now) = 0;
+
+    /**
+     * \brief Get the congestion window
+     * \return bytes of coded frames allowed in flight
+     */
+    uint32_t GetCwnd() const;
+
+    /**
+     * \brief Get the rate at which frames should be paced
+     * \return pacing rate, 0 if frames are not paced
+     */
+    DataRate GetPacingRate() const;
+
+  protected:
+    uint32_t m_segmentSize;            //!< size of a full coded frame
+    uint32_t m_initialCwnd;            //!< initial window in frames
+    TracedValue<uint32_t> m_cWnd;      //!< congestion window in bytes
+    TracedValue<DataRate> m_pacingRate; //!< pacing rate, 0 if unpaced
+};
+
+/**
+ * \ingroup helix
+ *
+ * \brief NewReno-like window control
+ *
+ * Slow start and congestion avoidance on the acked bytes. The window is
+ * halved, at most once per round trip, when a generation needed a repair
+ * round, i.e. when more frames were lost than the first round repaired.
+ * Frames are paced at PacingSsRatio or PacingCaRatio windows per
+ * smoothed round trip time.
+ */
+class HelixNewReno : public HelixCongestionOps
+{
+  public:
+    /**
+     * \brief Get the type ID.
+     * \return the object TypeId
+     */
+    static TypeId GetTypeId();
+
+    HelixNewReno();
+    ~HelixNewReno() override;
+
+    std::string GetName() const override;
+    void OnSample(const FFICongestionSample& sample, Time now) override;
+
+    /**
+     * \brief Get the slow start threshold
+     * \return slow start threshold in bytes
+     */
+    uint32_t GetSsThresh() const;
+
+  private:
+    double m_pacingSsRatio; //!< windows per srtt paced in slow start
+    double m_pacingCaRatio; //!< windows per srtt paced in congestion avoidance
+    uint32_t m_ssThresh;    //!< slow start threshold in bytes
+    Time m_srtt;            //!< smoothed round trip time
+    Time m_recoveryEnd;     //!< repair rounds before this time belong to the last reduction
+};
+
+} // namespace ns3
+
+#endif /* HELIX_CONGESTION_OPS_H */
@@ -0,0 +1,362 @@
+
+#include "helix-end-point-demux.h"
+
+#include "ns3/ipv4-end-point.h"
+#include "ns3/ipv4-interface.h"
+#include "ns3/ipv6-end-point.h"
+#include "ns3/ipv6-interface.h"
+#include "ns3/log.h"
+
+#include <cstring>
+
+namespace ns3
+{
+
+NS_LOG_COMPONENT_DEFINE("HelixEndPointDemux");
+
+/// First port handed out by the ephemeral allocator
+static const uint16_t EPHEMERAL_PORT_FIRST = 49152;
+/// Last port handed out by the ephemeral allocator
+static const uint16_t EPHEMERAL_PORT_LAST = 65535;
+
+bool
+HelixEndPointKey::operator==(const HelixEndPointKey& other) const
+{
+    return std::memcmp(this, &other, sizeof(HelixEndPointKey)) == 0;
+}
+
+size_t
+HelixEndPointKeyHash::operator()(const HelixEndPointKey& key) const
+{
+    // fold the key as five 64-bit words, the last one half filled, with a
+    // multiplicative mix
+    uint64_t words[5] = {};
+    std::memcpy(words, &key, sizeof(key));
+
+    uint64_t h = 0x9e3779b97f4a7c15ULL;
+    for (uint64_t w : words)
+    {
+        h ^= w;
+        h *= 0xff51afd7ed558ccdULL;
+        h ^= h >> 32;
+    }
+    return static_cast<size_t>(h);
+}
+
+namespace
+{
+
+static_assert(sizeof(HelixEndPointKey) == 36, "HelixEndPointKey must not contain padding");
+
+HelixEndPointKey
+MakeKey(Ipv4Address local, uint16_t localPort, Ipv4Address remote, uint16_t remotePort)
+{
+    HelixEndPointKey key;
+    std::memset(&key, 0, sizeof(key));
+    uint32_t l = local.Get();
+    uint32_t r = remote.Get();
+    std::memcpy(key.local, &l, sizeof(l));
+    std::memcpy(key.remote, &r, sizeof(r));
+    key.localPort = localPort;
+    key.remotePort = remotePort;
+    return key;
+}
+
+HelixEndPointKey
+MakeKey(Ipv6Address local, uint16_t localPort, Ipv6Address remote, uint16_t remotePort)
+{
+    HelixEndPointKey key;
+    std::memset(&key, 0, sizeof(key));
+    local.GetBytes(key.local);
+    remote.GetBytes(key.remote);
+    key.localPort = localPort;
+    key.remotePort = remotePort;
+    return key;
+}
+
+/**
+ * \brief Check that an endpoint accepts frames from an interface
+ * \param endPoint the endpoint
+ * \param incomingInterface incoming interface, may be null
+ * \return true if the endpoint is not bound to another device
+ */
+template <typename EndPoint, typename Interface>
+bool
+DeviceMatches(EndPoint* endPoint, Ptr<Interface> incomingInterface)
+{
+    Ptr<NetDevice> bound = endPoint->GetBoundNetDevice();
+    return !bound || !incomingInterface || bound == incomingInterface->GetDevice();
+}
+
+/**
+ * \brief Probe a table from the most to the least specific key
+ * \param endPoints the table
+ * \param key the fully specified key of the frame
+ * \param incomingInterface incoming interface, may be null
+ * \return the best matching endpoint or nullptr
+ */
+template <typename Map, typename Interface>
+typename Map::mapped_type
+ProbeKeys(const Map& endPoints, HelixEndPointKey key, Ptr<Interface> incomingInterface)
+{
+    uint8_t local[16];
+    std::memcpy(local, key.local, sizeof(local));
+
+    auto probe = [&](const HelixEndPointKey& k) -> typename Map::mapped_type {
+        auto it = endPoints.find(k);
+        if (it != endPoints.end() && DeviceMatches(it->second, incomingInterface))
+        {
+            return it->second;
+        }
+        return nullptr;
+    };
+    auto probeBothLocal = [&](HelixEndPointKey& k) -> typename Map::mapped_type {
+        std::memcpy(k.local, local, sizeof(local));
+        if (auto endPoint = probe(k))
+        {
+            return endPoint;
+        }
+        std::memset(k.local, 0, sizeof(k.local));
+        return probe(k);
+    };
+
+    // connected
+    if (auto endPoint = probeBothLocal(key))
+    {
+        return endPoint;
+    }
+    // listening
+    std::memset(key.remote, 0, sizeof(key.remote));
+    key.remotePort = 0;
+    return probeBothLocal(key);
+}
+
+} // namespace
+
+HelixEndPointDemux::HelixEndPointDemux()
+    : m_ephemeral(EPHEMERAL_PORT_LAST)
+{
+    NS_LOG_FUNCTION(this);
+}
+
+HelixEndPointDemux::~HelixEndPointDemux()
+{
+    NS_LOG_FUNCTION(this);
+    for (auto& entry : m_table4.keys)
+    {
+        delete entry.first;
+    }
+    for (auto& entry : m_table6.keys)
+    {
+        delete entry.first;
+    }
+    m_table4.keys.clear();
+    m_table4.endPoints.clear();
+    m_table6.keys.clear();
+    m_table6.endPoints.clear();
+}
+
+uint16_t
+HelixEndPointDemux::AllocateEphemeralPort()
+{
+    NS_LOG_FUNCTION(this);
+    uint32_t range = EPHEMERAL_PORT_LAST - EPHEMERAL_PORT_FIRST + 1;
+    for (uint32_t i = 0; i < range; i++)
+    {
+        m_ephemeral = (m_ephemeral == EPHEMERAL_PORT_LAST) ? EPHEMERAL_PORT_FIRST : m_ephemeral + 1;
+        if (m_portUsers.find(m_ephemeral) == m_portUsers.end())
+        {
+            return m_ephemeral;
+        }
+    }
+    NS_LOG_WARN("Ephemeral port allocation failed.");
+    return 0;
+}
+
+void
+HelixEndPointDemux::AcquirePort(uint16_t port)
+{
+    m_portUsers[port]++;
+}
+
+void
+HelixEndPointDemux::ReleasePort(uint16_t port)
+{
+    auto it = m_portUsers.find(port);
+    if (it != m_portUsers.end() && --it->second == 0)
+    {
+        m_portUsers.erase(it);
+    }
+}
+
+Ipv4EndPoint*
+HelixEndPointDemux::Allocate(Ptr<NetDevice> boundNetDevice, Ipv4Address address, uint16_t port)
+{
+    NS_LOG_FUNCTION(this << boundNetDevice << address << port);
+
+    if (port == 0 && (port = AllocateEphemeralPort()) == 0)
+    {
+        return nullptr;
+    }
+    HelixEndPointKey key = MakeKey(address, port, Ipv4Address::GetZero(), 0);
+    if (m_table4.endPoints.find(key) != m_table4.endPoints.end())
+    {
+        NS_LOG_WARN("Duplicated endpoint.");
+        return nullptr;
+    }
+
+    auto endPoint = new Ipv4EndPoint(address, port);
+    endPoint->BindToNetDevice(boundNetDevice);
+    m_table4.endPoints[key] = endPoint;
+    m_table4.keys[endPoint] = key;
+    AcquirePort(port);
+    NS_LOG_DEBUG("Now have >>" << m_table4.keys.size() << "<< IPv4 endpoints.");
+    return endPoint;
+}
+
+Ipv6EndPoint*
+HelixEndPointDemux::Allocate6(Ptr<NetDevice> boundNetDevice, Ipv6Address address, uint16_t port)
+{
+    NS_LOG_FUNCTION(this << boundNetDevice << address << port);
+
+    if (port == 0 && (port = AllocateEphemeralPort()) == 0)
+    {
+        return nullptr;
+    }
+    HelixEndPointKey key = MakeKey(address, port, Ipv6Address::GetZero(), 0);
+    if (m_table6.endPoints.find(key) != m_table6.endPoints.end())
+    {
+        NS_LOG_WARN("Duplicated endpoint.");
+        return nullptr;
+    }
+
+    auto endPoint = new Ipv6EndPoint(address, port);
+    endPoint->BindToNetDevice(boundNetDevice);
+    m_table6.endPoints[key] = endPoint;
+    m_table6.keys[endPoint] = key;
+    AcquirePort(port);
+    NS_LOG_DEBUG("Now have >>" << m_table6.keys.size() << "<< IPv6 endpoints.");
+    return endPoint;
+}
+
+bool
+HelixEndPointDemux::SetPeer(Ipv4EndPoint* endPoint,
+                            Ipv4Address peerAddress,
+                            uint16_t peerPort)
+{
+    NS_LOG_FUNCTION(this << endPoint << peerAddress << peerPort);
+
+    auto it = m_table4.keys.find(endPoint);
+    NS_ASSERT_MSG(it != m_table4.keys.end(), "Endpoint not allocated by this demux");
+
+    HelixEndPointKey key = MakeKey(endPoint->GetLocalAddress(),
+                                   endPoint->GetLocalPort(),
+                                   peerAddress,
+                                   peerPort);
+    auto taken = m_table4.endPoints.find(key);
+    if (taken != m_table4.endPoints.end() && taken->second != endPoint)
+    {
+        NS_LOG_WARN("Another endpoint is already connected to " << peerAddress << ":" << peerPort);
+        return false;
+    }
+
+    m_table4.endPoints.erase(it->second);
+    it->second = key;
+    m_table4.endPoints[key] = endPoint;
+    endPoint->SetPeer(peerAddress, peerPort);
+    return true;
+}
+
+bool
+HelixEndPointDemux::SetPeer(Ipv6EndPoint* endPoint,
+                            Ipv6Address peerAddress,
+                            uint16_t peerPort)
+{
+    NS_LOG_FUNCTION(this << endPoint << peerAddress << peerPort);
+
+    auto it = m_table6.keys.find(endPoint);
+    NS_ASSERT_MSG(it != m_table6.keys.end(), "Endpoint not allocated by this demux");
+
+    HelixEndPointKey key = MakeKey(endPoint->GetLocalAddress(),
+                                   endPoint->GetLocalPort(),
+                                   peerAddress,
+                                   peerPort);
+    auto taken = m_table6.endPoints.find(key);
+    if (taken != m_table6.endPoints.end() && taken->second != endPoint)
+    {
+        NS_LOG_WARN("Another endpoint is already connected to " << peerAddress << ":" << peerPort);
+        return false;
+    }
+
+    m_table6.endPoints.erase(it->second);
+    it->second = key;
+    m_table6.endPoints[key] = endPoint;
+    endPoint->SetPeer(peerAddress, peerPort);
+    return true;
+}
+
+void
+HelixEndPointDemux::DeAllocate(Ipv4EndPoint* endPoint)
+{
+    NS_LOG_FUNCTION(this << endPoint);
+
+    auto it = m_table4.keys.find(endPoint);
+    if (it == m_table4.keys.end())
+    {
+        return;
+    }
+    m_table4.endPoints.erase(it->second);
+    m_table4.keys.erase(it);
+    ReleasePort(endPoint->GetLocalPort());
+    delete endPoint;
+}
+
+void
+HelixEndPointDemux::DeAllocate(Ipv6EndPoint* endPoint)
+{
+    NS_LOG_FUNCTION(this << endPoint);
+
+    auto it = m_table6.keys.find(endPoint);
+    if (it == m_table6.keys.end())
+    {
+        return;
+    }
+    m_table6.endPoints.erase(it->second);
+    m_table6.keys.erase(it);
+    ReleasePort(endPoint->GetLocalPort());
+    delete endPoint;
+}
+
+Ipv4EndPoint*
+HelixEndPointDemux::Lookup(Ipv4Address daddr,
+                           uint16_t dport,
+                           Ipv4Address saddr,
+                           uint16_t sport,
+                           Ptr<Ipv4Interface> incomingInterface) const
+{
+    NS_LOG_FUNCTION(this << daddr << dport << saddr << sport);
+    return ProbeKeys(m_table4.endPoints,
+                     MakeKey(daddr, dport, saddr, sport),
+                     incomingInterface);
+}
+
+Ipv6EndPoint*
+HelixEndPointDemux::Lookup(Ipv6Address daddr,
+                           uint16_t dport,
+                           Ipv6Address saddr,
+                           uint16_t sport,
+                           Ptr<Ipv6Interface> incomingInterface) const
+{
+    NS_LOG_FUNCTION(this << daddr << dport << saddr << sport);
+    return ProbeKeys(m_table6.endPoints,
+                     MakeKey(daddr, dport, saddr, sport),
+                     incomingInterface);
+}
+
+uint32_t
+HelixEndPointDemux::GetNEndPoints() const
+{
+    return m_table4.keys.size() + m_table6.keys.size();
+}
+
+} // namespace ns3
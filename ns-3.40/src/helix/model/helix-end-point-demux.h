@@ -0,0 +1,205 @@
+/*
+ * Endpoint demultiplexer for native HELIX frames
+ *
+ * Ipv4EndPointDemux walks a list of endpoints on every lookup, which
+ * dominates when a node carries thousands of flows. This demux keeps
+ * endpoints in hash tables keyed by
+ * (local addr, local port, remote addr, remote port),
+ * so a lookup is a handful of hash probes whatever the endpoint count.
+ *
+ * Lookup order, most specific first:
+ * - connected endpoint
+ * - listening endpoint bound to the destination address
+ * - listening endpoint bound to the any address
+ * Connected probes are tried with the destination address and with the
+ * any address, for sockets that connected without binding an address.
+ */
+#ifndef HELIX_END_POINT_DEMUX_H
+#define HELIX_END_POINT_DEMUX_H
+
+#include "ns3/ipv4-address.h"
+#include "ns3/ipv6-address.h"
+#include "ns3/net-device.h"
+#include "ns3/ptr.h"
+
+#include <stdint.h>
+#include <unordered_map>
+
+namespace ns3
+{
+
+class Ipv4EndPoint;
+class Ipv6EndPoint;
+class Ipv4Interface;
+class Ipv6Interface;
+
+/**
+ * \ingroup helix
+ * \brief Key of a HELIX endpoint
+ *
+ * IPv4 addresses occupy the first four bytes of the address fields,
+ * IPv4 and IPv6 endpoints live in separate tables.
+ */
+struct HelixEndPointKey
+{
+    uint8_t local[16];     //!< local address
+    uint8_t remote[16];    //!< remote address, all zero for listening endpoints
+    uint16_t localPort;    //!< local port
+    uint16_t remotePort;   //!< remote port, zero for listening endpoints
+
+    /**
+     * \param other key to compare with
+     * \return true if both keys are equal
+     */
+    bool operator==(const HelixEndPointKey& other) const;
+};
+
+/**
+ * \ingroup helix
+ * \brief Hash functor for HelixEndPointKey
+ */
+struct HelixEndPointKeyHash
+{
+    /**
+     * \param key key to hash
+     * \return the hash of the key
+     */
+    size_t operator()(const HelixEndPointKey& key) const;
+};
+
+/**
+ * \ingroup helix
+ * \brief Hash-based demultiplexer for native HELIX endpoints
+ *
+ * Owns the Ipv4EndPoint and Ipv6EndPoint objects it allocates, deleting
+ * the demux deletes them (which fires their destroy callbacks).
+ */
+class HelixEndPointDemux
+{
+  public:
+    HelixEndPointDemux();
+    ~HelixEndPointDemux();
+
+    // Delete copy constructor and assignment operator to avoid misuse
+    HelixEndPointDemux(const HelixEndPointDemux&) = delete;
+    HelixEndPointDemux& operator=(const HelixEndPointDemux&) = delete;
+
+    /**
+     * \brief Allocate a listening IPv4 endpoint
+     * \param boundNetDevice Bound NetDevice (if any)
+     * \param address local address (may be the any address)
+     * \param port local port, 0 picks an ephemeral port
+     * \return the endpoint, or nullptr if the address and port are in use
+     */
+    Ipv4EndPoint* Allocate(Ptr<NetDevice> boundNetDevice, Ipv4Address address, uint16_t port);
+    /**
+     * \brief Allocate a listening IPv6 endpoint
+     * \param boundNetDevice Bound NetDevice (if any)
+     * \param address local address (may be the any address)
+     * \param port local port, 0 picks an ephemeral port
+     * \return the endpoint, or nullptr if the address and port are in use
+     */
+    Ipv6EndPoint* Allocate6(Ptr<NetDevice> boundNetDevice, Ipv6Address address, uint16_t port);
+
+    /**
+     * \brief Connect an IPv4 endpoint to a peer and re-key it
+     * \param endPoint the endpoint
+     * \param peerAddress remote address
+     * \param peerPort remote port
+     * \return false if another endpoint already owns the new key
+     */
+    bool SetPeer(Ipv4EndPoint* endPoint,
+                 Ipv4Address peerAddress,
+                 uint16_t peerPort);
+    /**
+     * \brief Connect an IPv6 endpoint to a peer and re-key it
+     * \param endPoint the endpoint
+     * \param peerAddress remote address
+     * \param peerPort remote port
+     * \return false if another endpoint already owns the new key
+     */
+    bool SetPeer(Ipv6EndPoint* endPoint,
+                 Ipv6Address peerAddress,
+                 uint16_t peerPort);
+
+    /**
+     * \brief Remove and delete an IPv4 endpoint
+     * \param endPoint the endpoint
+     */
+    void DeAllocate(Ipv4EndPoint* endPoint);
+    /**
+     * \brief Remove and delete an IPv6 endpoint
+     * \param endPoint the endpoint
+     */
+    void DeAllocate(Ipv6EndPoint* endPoint);
+
+    /**
+     * \brief Find the endpoint an incoming IPv4 frame belongs to
+     * \param daddr destination address of the frame
+     * \param dport destination port of the frame
+     * \param saddr source address of the frame
+     * \param sport source port of the frame
+     * \param incomingInterface incoming interface, may be null
+     * \return the best matching endpoint or nullptr
+     */
+    Ipv4EndPoint* Lookup(Ipv4Address daddr,
+                         uint16_t dport,
+                         Ipv4Address saddr,
+                         uint16_t sport,
+                         Ptr<Ipv4Interface> incomingInterface) const;
+    /**
+     * \brief Find the endpoint an incoming IPv6 frame belongs to
+     * \param daddr destination address of the frame
+     * \param dport destination port of the frame
+     * \param saddr source address of the frame
+     * \param sport source port of the frame
+     * \param incomingInterface incoming interface, may be null
+     * \return the best matching endpoint or nullptr
+     */
+    Ipv6EndPoint* Lookup(Ipv6Address daddr,
+                         uint16_t dport,
+                         Ipv6Address saddr,
+                         uint16_t sport,
+                         Ptr<Ipv6Interface> incomingInterface) const;
+
+    /**
+     * \return the number of allocated IPv4 and IPv6 endpoints
+     */
+    uint32_t GetNEndPoints() const;
+
+  private:
+    /**
+     * \brief Hash tables of one address family
+     */
+    template <typename EndPoint>
+    struct Table
+    {
+        std::unordered_map<HelixEndPointKey, EndPoint*, HelixEndPointKeyHash> endPoints; //!< key to endpoint
+        std::unordered_map<EndPoint*, HelixEndPointKey> keys; //!< endpoint to its current key
+    };
+
+    /**
+     * \brief Pick a free ephemeral port
+     * \return the port, or 0 if none is left
+     */
+    uint16_t AllocateEphemeralPort();
+    /**
+     * \brief Take a reference on a local port
+     * \param port the port
+     */
+    void AcquirePort(uint16_t port);
+    /**
+     * \brief Drop a reference on a local port
+     * \param port the port
+     */
+    void ReleasePort(uint16_t port);
+
+    Table<Ipv4EndPoint> m_table4;                        //!< IPv4 endpoints
+    Table<Ipv6EndPoint> m_table6;                        //!< IPv6 endpoints
+    std::unordered_map<uint16_t, uint32_t> m_portUsers;  //!< endpoints per local port
+    uint16_t m_ephemeral;                                //!< last ephemeral port handed out
+};
+
+} // namespace ns3
+
+#endif /* HELIX_END_POINT_DEMUX_H */
@@ -0,0 +1,111 @@
+
+#include "helix-header.h"
+
+#include "ns3/log.h"
+
+namespace ns3
+{
+
+NS_LOG_COMPONENT_DEFINE("HelixHeader");
+
+NS_OBJECT_ENSURE_REGISTERED(HelixHeader);
+
+HelixHeader::HelixHeader()
+    : m_sourcePort(0),
+      m_destinationPort(0),
+      m_payloadLength(0)
+{
+}
+
+HelixHeader::~HelixHeader()
+{
+}
+
+TypeId
+HelixHeader::GetTypeId()
+{
+    static TypeId tid = TypeId("ns3::HelixHeader")
+                            .SetParent<Header>()
+                            .SetGroupName("Internet")
+                            .AddConstructor<HelixHeader>();
+    return tid;
+}
+
+TypeId
+HelixHeader::GetInstanceTypeId() const
+{
+    return GetTypeId();
+}
+
+void
+HelixHeader::Print(std::ostream& os) const
+{
+    os << "length: " << m_payloadLength + GetSerializedSize() << " " << m_sourcePort << " > "
+       << m_destinationPort;
+}
+
+uint32_t
+HelixHeader::GetSerializedSize() const
+{
+    return SERIALIZED_SIZE;
+}
+
+void
+HelixHeader::Serialize(Buffer::Iterator start) const
+{
+    Buffer::Iterator i = start;
+
+    i.WriteHtonU16(m_sourcePort);
+    i.WriteHtonU16(m_destinationPort);
+    i.WriteHtonU16(m_payloadLength);
+}
+
+uint32_t
+HelixHeader::Deserialize(Buffer::Iterator start)
+{
+    Buffer::Iterator i = start;
+
+    m_sourcePort = i.ReadNtohU16();
+    m_destinationPort = i.ReadNtohU16();
+    m_payloadLength = i.ReadNtohU16();
+
+    return GetSerializedSize();
+}
+
+void
+HelixHeader::SetSourcePort(uint16_t port)
+{
+    m_sourcePort = port;
+}
+
+uint16_t
+HelixHeader::GetSourcePort() const
+{
+    return m_sourcePort;
+}
+
+void
+HelixHeader::SetDestinationPort(uint16_t port)
+{
+    m_destinationPort = port;
+}
+
+uint16_t
+HelixHeader::GetDestinationPort() const
+{
+    return m_destinationPort;
+}
+
+void
+HelixHeader::SetPayloadLength(uint16_t length)
+{
+    m_payloadLength = length;
+}
+
+uint16_t
+HelixHeader::GetPayloadLength() const
+{
+    return m_payloadLength;
+}
+
+} // namespace ns3
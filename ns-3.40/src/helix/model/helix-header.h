@@ -0,0 +1,81 @@
+/*
+ * Header carried by HELIX frames sent natively over IP protocol 253
+ *
+ * Layout (6 bytes):
+ * - source port       (16 bits)
+ * - destination port  (16 bits)
+ * - payload length    (16 bits)
+ *
+ * The ports sit in the first four bytes like they do in UDP and TCP,
+ * so the ICMP error path can recover them from the 8 quoted bytes.
+ */
+#ifndef HELIX_HEADER_H
+#define HELIX_HEADER_H
+
+#include "ns3/header.h"
+
+#include <stdint.h>
+
+namespace ns3
+{
+
+/**
+ * \ingroup helix
+ * \brief Packet header for HELIX frames in native mode
+ *
+ * Used instead of a UDP header when HelixL4Protocol runs in native mode
+ * and hands frames straight to the IPv4/IPv6 layer.
+ */
+class HelixHeader : public Header
+{
+  public:
+    HelixHeader();
+    ~HelixHeader() override;
+
+    /**
+     * \brief Get the type ID.
+     * \return the object TypeId
+     */
+    static TypeId GetTypeId();
+    TypeId GetInstanceTypeId() const override;
+    void Print(std::ostream& os) const override;
+    uint32_t GetSerializedSize() const override;
+    void Serialize(Buffer::Iterator start) const override;
+    uint32_t Deserialize(Buffer::Iterator start) override;
+
+    /**
+     * \param port the source port for this HelixHeader
+     */
+    void SetSourcePort(uint16_t port);
+    /**
+     * \return the source port for this HelixHeader
+     */
+    uint16_t GetSourcePort() const;
+    /**
+     * \param port the destination port for this HelixHeader
+     */
+    void SetDestinationPort(uint16_t port);
+    /**
+     * \return the destination port for this HelixHeader
+     */
+    uint16_t GetDestinationPort() const;
+    /**
+     * \param length the payload length in bytes
+     */
+    void SetPayloadLength(uint16_t length);
+    /**
+     * \return the payload length in bytes
+     */
+    uint16_t GetPayloadLength() const;
+
+    static const uint32_t SERIALIZED_SIZE = 6; //!< size of the header on the wire
+
+  private:
+    uint16_t m_sourcePort;      //!< Source port
+    uint16_t m_destinationPort; //!< Destination port
+    uint16_t m_payloadLength;   //!< Payload length
+};
+
+} // namespace ns3
+
+#endif /* HELIX_HEADER_H */
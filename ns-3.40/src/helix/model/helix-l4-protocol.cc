@@ -1,17 +1,23 @@
 
 
 #include "helix-l4-protocol.h"
+#include "helix-congestion-ops.h"
+#include "helix-header.h"
 #include "helix-socket-factory-impl.h"
 #include "helix-socket-impl.h"
 
 #include "ns3/assert.h"
 #include "ns3/boolean.h"
+#include "ns3/ipv4-end-point.h"
+#include "ns3/ipv6-end-point.h"
 #include "ns3/log.h"
 #include "ns3/node.h"
+#include "ns3/object-factory.h"
 #include "ns3/object-map.h"
 #include "ns3/packet.h"
+#include "ns3/uinteger.h"
 
-#include <unordered_map>
+#include <algorithm>
 
 namespace ns3
 {
@@ -33,17 +39,43 @@ HelixL4Protocol::GetTypeId()
             .SetGroupName("Internet")
             .AddConstructor<HelixL4Protocol>()
             .AddAttribute("SocketList",
-                          "A container of sockets associated to this protocol. "
-                          "The underlying type is an unordered map, the attribute name "
-                          "is kept for backward compatibility.",
+                          "The live sockets associated to this protocol. "
+                          "Indices are positions in the socket table and change "
+                          "when a socket is closed.",
                           ObjectMapValue(),
-                          MakeObjectMapAccessor(&HelixL4Protocol::m_sockets),
-                          MakeObjectMapChecker<HelixSocketImpl>());
+                          MakeObjectMapAccessor(&HelixL4Protocol::GetNSockets,
+                                                &HelixL4Protocol::GetSocket),
+                          MakeObjectMapChecker<HelixSocketImpl>())
+            .AddAttribute("LiveSockets",
+                          "The number of sockets that have not been closed yet.",
+                          TypeId::ATTR_GET,
+                          UintegerValue(0),
+                          MakeUintegerAccessor(&HelixL4Protocol::GetNSockets),
+                          MakeUintegerChecker<uint32_t>())
+            .AddAttribute("PeakSockets",
+                          "The largest number of sockets live at the same time.",
+                          TypeId::ATTR_GET,
+                          UintegerValue(0),
+                          MakeUintegerAccessor(&HelixL4Protocol::GetPeakSockets),
+                          MakeUintegerChecker<uint32_t>())
+            .AddAttribute("NativeMode",
+                          "Send HELIX frames straight to IP with their own header "
+                          "instead of through an inner UDP socket.",
+                          BooleanValue(false),
+                          MakeBooleanAccessor(&HelixL4Protocol::m_nativeMode),
+                          MakeBooleanChecker())
+            .AddAttribute("CongestionOps",
+                          "Congestion control algorithm of the sockets created from now on.",
+                          TypeIdValue(HelixNewReno::GetTypeId()),
+                          MakeTypeIdAccessor(&HelixL4Protocol::m_congestionTypeId),
+                          MakeTypeIdChecker());
     return tid;
 }
 
 HelixL4Protocol::HelixL4Protocol()
-    : m_node(nullptr)
+    : m_node(nullptr),
+      m_nativeMode(false),
+      m_endPoints(new HelixEndPointDemux())
 {
     NS_LOG_FUNCTION(this);
 }
@@ -77,17 +109,204 @@ HelixL4Protocol::CreateSocket()
     socket->SetNode(m_node);
     socket->SetHelix(this);
 
-    // create a udp socket
-    Ptr<SocketFactory> udpSocketFactory = m_node->GetObject<UdpSocketFactory>(); // how to get access to the node?
-    Ptr<Socket> udp_socket = udpSocketFactory->CreateSocket();
-    socket->SetUdpSocket(udp_socket);
+    ObjectFactory congestionFactory;
+    congestionFactory.SetTypeId(m_congestionTypeId);
+    socket->SetCongestionControlAlgorithm(congestionFactory.Create<HelixCongestionOps>());
 
-    // internal socket tracking
-    m_sockets[m_socketIndex++] = socket;
+    // the udp socket of non native sockets is only created once they bind
+    // or connect, see HelixSocketImpl::Activate()
+
+    // internal socket tracking, reuse a released slot if there is one
+    uint32_t index;
+    if (!m_freeSlots.empty())
+    {
+        index = m_freeSlots.back();
+        m_freeSlots.pop_back();
+    }
+    else
+    {
+        index = m_slots.size();
+        m_slots.push_back({nullptr, 0, 0});
+    }
+    SocketSlot& slot = m_slots[index];
+    slot.socket = socket;
+    slot.position = m_liveSockets.size();
+    m_liveSockets.push_back(socket);
+    m_liveSlots.push_back(index);
+    m_peakSockets = std::max<uint32_t>(m_peakSockets, m_liveSockets.size());
+
+    socket->SetSocketHandle((static_cast<uint64_t>(slot.generation) << 32) | index);
 
     return socket;
 }
 
+void
+HelixL4Protocol::ReleaseSocket(uint64_t handle)
+{
+    NS_LOG_FUNCTION(this << handle);
+    uint32_t index = handle & 0xffffffff;
+    uint32_t generation = handle >> 32;
+    if (index >= m_slots.size() || m_slots[index].generation != generation ||
+        !m_slots[index].socket)
+    {
+        NS_LOG_LOGIC("Stale socket handle " << handle);
+        return;
+    }
+
+    // swap the last live socket into the hole to keep m_liveSockets dense
+    SocketSlot& slot = m_slots[index];
+    uint32_t last = m_liveSockets.size() - 1;
+    if (slot.position != last)
+    {
+        m_liveSockets[slot.position] = m_liveSockets[last];
+        m_liveSlots[slot.position] = m_liveSlots[last];
+        m_slots[m_liveSlots[slot.position]].position = slot.position;
+    }
+    m_liveSockets.pop_back();
+    m_liveSlots.pop_back();
+
+    slot.generation++;
+    m_freeSlots.push_back(index);
+    // last, dropping the reference may destroy the socket
+    slot.socket = nullptr;
+}
+
+Ptr<HelixSocketImpl>
+HelixL4Protocol::LookupSocket(uint64_t handle) const
+{
+    uint32_t index = handle & 0xffffffff;
+    if (index >= m_slots.size() || m_slots[index].generation != (handle >> 32))
+    {
+        return nullptr;
+    }
+    return m_slots[index].socket;
+}
+
+uint32_t
+HelixL4Protocol::GetNSockets() const
+{
+    return m_liveSockets.size();
+}
+
+Ptr<HelixSocketImpl>
+HelixL4Protocol::GetSocket(uint32_t i) const
+{
+    NS_ASSERT(i < m_liveSockets.size());
+    return m_liveSockets[i];
+}
+
+uint32_t
+HelixL4Protocol::GetPeakSockets() const
+{
+    return m_peakSockets;
+}
+
+std::vector<uint8_t>*
+HelixL4Protocol::GetStagingArea()
+{
+    return &m_staging;
+}
+
+bool
+HelixL4Protocol::IsNativeMode() const
+{
+    return m_nativeMode;
+}
+
+Ipv4EndPoint*
+HelixL4Protocol::Allocate()
+{
+    NS_LOG_FUNCTION(this);
+    return m_endPoints->Allocate(nullptr, Ipv4Address::GetAny(), 0);
+}
+
+Ipv4EndPoint*
+HelixL4Protocol::Allocate(Ptr<NetDevice> boundNetDevice, Ipv4Address address, uint16_t port)
+{
+    NS_LOG_FUNCTION(this << boundNetDevice << address << port);
+    return m_endPoints->Allocate(boundNetDevice, address, port);
+}
+
+Ipv6EndPoint*
+HelixL4Protocol::Allocate6()
+{
+    NS_LOG_FUNCTION(this);
+    return m_endPoints->Allocate6(nullptr, Ipv6Address::GetAny(), 0);
+}
+
+Ipv6EndPoint*
+HelixL4Protocol::Allocate6(Ptr<NetDevice> boundNetDevice, Ipv6Address address, uint16_t port)
+{
+    NS_LOG_FUNCTION(this << boundNetDevice << address << port);
+    return m_endPoints->Allocate6(boundNetDevice, address, port);
+}
+
+bool
+HelixL4Protocol::SetPeer(Ipv4EndPoint* endPoint, Ipv4Address peerAddress, uint16_t peerPort)
+{
+    NS_LOG_FUNCTION(this << endPoint << peerAddress << peerPort);
+    return m_endPoints->SetPeer(endPoint, peerAddress, peerPort);
+}
+
+bool
+HelixL4Protocol::SetPeer(Ipv6EndPoint* endPoint, Ipv6Address peerAddress, uint16_t peerPort)
+{
+    NS_LOG_FUNCTION(this << endPoint << peerAddress << peerPort);
+    return m_endPoints->SetPeer(endPoint, peerAddress, peerPort);
+}
+
+void
+HelixL4Protocol::DeAllocate(Ipv4EndPoint* endPoint)
+{
+    NS_LOG_FUNCTION(this << endPoint);
+    m_endPoints->DeAllocate(endPoint);
+}
+
+void
+HelixL4Protocol::DeAllocate(Ipv6EndPoint* endPoint)
+{
+    NS_LOG_FUNCTION(this << endPoint);
+    m_endPoints->DeAllocate(endPoint);
+}
+
+void
+HelixL4Protocol::Send(Ptr<Packet> packet,
+                      Ipv4Address saddr,
+                      Ipv4Address daddr,
+                      uint16_t sport,
+                      uint16_t dport,
+                      Ptr<Ipv4Route> route)
+{
+    NS_LOG_FUNCTION(this << packet << saddr << daddr << sport << dport << route);
+
+    HelixHeader helixHeader;
+    helixHeader.SetSourcePort(sport);
+    helixHeader.SetDestinationPort(dport);
+    helixHeader.SetPayloadLength(packet->GetSize());
+    packet->AddHeader(helixHeader);
+
+    m_downTarget(packet, saddr, daddr, PROT_NUMBER, route);
+}
+
+void
+HelixL4Protocol::Send(Ptr<Packet> packet,
+                      Ipv6Address saddr,
+                      Ipv6Address daddr,
+                      uint16_t sport,
+                      uint16_t dport,
+                      Ptr<Ipv6Route> route)
+{
+    NS_LOG_FUNCTION(this << packet << saddr << daddr << sport << dport << route);
+
+    HelixHeader helixHeader;
+    helixHeader.SetSourcePort(sport);
+    helixHeader.SetDestinationPort(dport);
+    helixHeader.SetPayloadLength(packet->GetSize());
+    packet->AddHeader(helixHeader);
+
+    m_downTarget6(packet, saddr, daddr, PROT_NUMBER, route);
+}
+
 
 
 
@@ -104,24 +323,25 @@ HelixL4Protocol::ReceiveIcmp(Ipv4Address icmpSource,
 {
     NS_LOG_FUNCTION(this << icmpSource << icmpTtl << icmpType << icmpCode << icmpInfo
                          << payloadSource << payloadDestination);
-    // uint16_t src;
-    // uint16_t dst;
-    // src = payload[0] << 8;
-    // src |= payload[1];
-    // dst = payload[2] << 8;
-    // dst |= payload[3];
-
-    // Ipv4EndPoint* endPoint = m_endPoints->SimpleLookup(payloadSource, src, payloadDestination, dst);
-    // if (endPoint != nullptr)
-    // {
-    //     endPoint->ForwardIcmp(icmpSource, icmpTtl, icmpType, icmpCode, icmpInfo);
-    // }
-    // else
-    // {
-    //     NS_LOG_DEBUG("no endpoint found source=" << payloadSource
-    //                                              << ", destination=" << payloadDestination
-    //                                              << ", src=" << src << ", dst=" << dst);
-    // }
+    uint16_t src;
+    uint16_t dst;
+    src = payload[0] << 8;
+    src |= payload[1];
+    dst = payload[2] << 8;
+    dst |= payload[3];
+
+    Ipv4EndPoint* endPoint =
+        m_endPoints->Lookup(payloadSource, src, payloadDestination, dst, nullptr);
+    if (endPoint != nullptr)
+    {
+        endPoint->ForwardIcmp(icmpSource, icmpTtl, icmpType, icmpCode, icmpInfo);
+    }
+    else
+    {
+        NS_LOG_DEBUG("no endpoint found source=" << payloadSource
+                                                 << ", destination=" << payloadDestination
+                                                 << ", src=" << src << ", dst=" << dst);
+    }
 }
 
 void
@@ -136,82 +356,62 @@ HelixL4Protocol::ReceiveIcmp(Ipv6Address icmpSource,
 {
     NS_LOG_FUNCTION(this << icmpSource << icmpTtl << icmpType << icmpCode << icmpInfo
                          << payloadSource << payloadDestination);
-    // uint16_t src;
-    // uint16_t dst;
-    // src = payload[0] << 8;
-    // src |= payload[1];
-    // dst = payload[2] << 8;
-    // dst |= payload[3];
-
-    // Ipv6EndPoint* endPoint =
-    //     m_endPoints6->SimpleLookup(payloadSource, src, payloadDestination, dst);
-    // if (endPoint != nullptr)
-    // {
-    //     endPoint->ForwardIcmp(icmpSource, icmpTtl, icmpType, icmpCode, icmpInfo);
-    // }
-    // else
-    // {
-    //     NS_LOG_DEBUG("no endpoint found source=" << payloadSource
-    //                                              << ", destination=" << payloadDestination
-    //                                              << ", src=" << src << ", dst=" << dst);
-    // }
+    uint16_t src;
+    uint16_t dst;
+    src = payload[0] << 8;
+    src |= payload[1];
+    dst = payload[2] << 8;
+    dst |= payload[3];
+
+    Ipv6EndPoint* endPoint =
+        m_endPoints->Lookup(payloadSource, src, payloadDestination, dst, nullptr);
+    if (endPoint != nullptr)
+    {
+        endPoint->ForwardIcmp(icmpSource, icmpTtl, icmpType, icmpCode, icmpInfo);
+    }
+    else
+    {
+        NS_LOG_DEBUG("no endpoint found source=" << payloadSource
+                                                 << ", destination=" << payloadDestination
+                                                 << ", src=" << src << ", dst=" << dst);
+    }
 }
 
 IpL4Protocol::RxStatus
 HelixL4Protocol::Receive(Ptr<Packet> packet, const Ipv4Header& header, Ptr<Ipv4Interface> interface)
 {
     NS_LOG_FUNCTION(this << packet << header);
-    // UdpHeader udpHeader;
-    // if (Node::ChecksumEnabled())
-    // {
-    //     udpHeader.EnableChecksums();
-    // }
-
-    // udpHeader.InitializeChecksum(header.GetSource(), header.GetDestination(), PROT_NUMBER);
-
-    // // We only peek at the header for now (instead of removing it) so that it will be intact
-    // // if we have to pass it to a IPv6 endpoint via:
-    // //
-    // //   HelixL4Protocol::Receive (Ptr<Packet> packet, Ipv6Address &src, Ipv6Address &dst, ...)
-
-    // packet->PeekHeader(udpHeader);
-
-    // if (!udpHeader.IsChecksumOk())
-    // {
-    //     NS_LOG_INFO("Bad checksum : dropping packet!");
-    //     return IpL4Protocol::RX_CSUM_FAILED;
-    // }
-
-    // NS_LOG_DEBUG("Looking up dst " << header.GetDestination() << " port "
-    //                                << udpHeader.GetDestinationPort());
-    // Ipv4EndPointDemux::EndPoints endPoints = m_endPoints->Lookup(header.GetDestination(),
-    //                                                              udpHeader.GetDestinationPort(),
-    //                                                              header.GetSource(),
-    //                                                              udpHeader.GetSourcePort(),
-    //                                                              interface);
-    // if (endPoints.empty())
-    // {
-    //     if (this->GetObject<Ipv6>())
-    //     {
-    //         NS_LOG_LOGIC("  No Ipv4 endpoints matched on HelixL4Protocol, trying Ipv6 " << this);
-    //         Ptr<Ipv6Interface> fakeInterface;
-    //         Ipv6Header ipv6Header;
-    //         Ipv6Address src = Ipv6Address::MakeIpv4MappedAddress(header.GetSource());
-    //         Ipv6Address dst = Ipv6Address::MakeIpv4MappedAddress(header.GetDestination());
-    //         ipv6Header.SetSource(src);
-    //         ipv6Header.SetDestination(dst);
-    //         return (this->Receive(packet, ipv6Header, fakeInterface));
-    //     }
-
-    //     NS_LOG_LOGIC("RX_ENDPOINT_UNREACH");
-    //     return IpL4Protocol::RX_ENDPOINT_UNREACH;
-    // }
-
-    // packet->RemoveHeader(udpHeader);
-    // for (auto endPoint = endPoints.begin(); endPoint != endPoints.end(); endPoint++)
-    // {
-    //     (*endPoint)->ForwardUp(packet->Copy(), header, udpHeader.GetSourcePort(), interface);
-    // }
+
+    // malformed frames are dropped silently, they must not trigger an
+    // ICMP port unreachable
+    HelixHeader helixHeader;
+    if (packet->GetSize() < helixHeader.GetSerializedSize())
+    {
+        NS_LOG_INFO("Truncated frame : dropping packet!");
+        return IpL4Protocol::RX_CSUM_FAILED;
+    }
+    packet->RemoveHeader(helixHeader);
+    if (helixHeader.GetPayloadLength() != packet->GetSize())
+    {
+        NS_LOG_INFO("Payload length " << helixHeader.GetPayloadLength() << " does not match "
+                                      << packet->GetSize() << " bytes : dropping packet!");
+        return IpL4Protocol::RX_CSUM_FAILED;
+    }
+
+    NS_LOG_DEBUG("Looking up dst " << header.GetDestination() << " port "
+                                   << helixHeader.GetDestinationPort());
+    Ipv4EndPoint* endPoint = m_endPoints->Lookup(header.GetDestination(),
+                                             helixHeader.GetDestinationPort(),
+                                             header.GetSource(),
+                                             helixHeader.GetSourcePort(),
+                                             interface);
+    if (endPoint == nullptr)
+    {
+        NS_LOG_LOGIC("RX_ENDPOINT_UNREACH");
+        return IpL4Protocol::RX_ENDPOINT_UNREACH;
+    }
+
+    endPoint->ForwardUp(packet, header, helixHeader.GetSourcePort(), interface);
     return IpL4Protocol::RX_OK;
 }
 
@@ -219,38 +419,37 @@ IpL4Protocol::RxStatus
 HelixL4Protocol::Receive(Ptr<Packet> packet, const Ipv6Header& header, Ptr<Ipv6Interface> interface)
 {
     NS_LOG_FUNCTION(this << packet << header.GetSource() << header.GetDestination());
-    // UdpHeader udpHeader;
-    // if (Node::ChecksumEnabled())
-    // {
-    //     udpHeader.EnableChecksums();
-    // }
-
-    // udpHeader.InitializeChecksum(header.GetSource(), header.GetDestination(), PROT_NUMBER);
-
-    // packet->RemoveHeader(udpHeader);
-
-    // if (!udpHeader.IsChecksumOk() && !header.GetSource().IsIpv4MappedAddress())
-    // {
-    //     NS_LOG_INFO("Bad checksum : dropping packet!");
-    //     return IpL4Protocol::RX_CSUM_FAILED;
-    // }
-
-    // NS_LOG_DEBUG("Looking up dst " << header.GetDestination() << " port "
-    //                                << udpHeader.GetDestinationPort());
-    // Ipv6EndPointDemux::EndPoints endPoints = m_endPoints6->Lookup(header.GetDestination(),
-    //                                                               udpHeader.GetDestinationPort(),
-    //                                                               header.GetSource(),
-    //                                                               udpHeader.GetSourcePort(),
-    //                                                               interface);
-    // if (endPoints.empty())
-    // {
-    //     NS_LOG_LOGIC("RX_ENDPOINT_UNREACH");
-    //     return IpL4Protocol::RX_ENDPOINT_UNREACH;
-    // }
-    // for (auto endPoint = endPoints.begin(); endPoint != endPoints.end(); endPoint++)
-    // {
-    //     (*endPoint)->ForwardUp(packet->Copy(), header, udpHeader.GetSourcePort(), interface);
-    // }
+
+    // malformed frames are dropped silently, they must not trigger an
+    // ICMP port unreachable
+    HelixHeader helixHeader;
+    if (packet->GetSize() < helixHeader.GetSerializedSize())
+    {
+        NS_LOG_INFO("Truncated frame : dropping packet!");
+        return IpL4Protocol::RX_CSUM_FAILED;
+    }
+    packet->RemoveHeader(helixHeader);
+    if (helixHeader.GetPayloadLength() != packet->GetSize())
+    {
+        NS_LOG_INFO("Payload length " << helixHeader.GetPayloadLength() << " does not match "
+                                      << packet->GetSize() << " bytes : dropping packet!");
+        return IpL4Protocol::RX_CSUM_FAILED;
+    }
+
+    NS_LOG_DEBUG("Looking up dst " << header.GetDestination() << " port "
+                                   << helixHeader.GetDestinationPort());
+    Ipv6EndPoint* endPoint = m_endPoints->Lookup(header.GetDestination(),
+                                             helixHeader.GetDestinationPort(),
+                                             header.GetSource(),
+                                             helixHeader.GetSourcePort(),
+                                             interface);
+    if (endPoint == nullptr)
+    {
+        NS_LOG_LOGIC("RX_ENDPOINT_UNREACH");
+        return IpL4Protocol::RX_ENDPOINT_UNREACH;
+    }
+
+    endPoint->ForwardUp(packet, header, helixHeader.GetSourcePort(), interface);
     return IpL4Protocol::RX_OK;
 }
 
@@ -286,11 +485,16 @@ void
 HelixL4Protocol::DoDispose()
 {
     NS_LOG_FUNCTION(this);
-    for (auto i = m_sockets.begin(); i != m_sockets.end(); i++)
+    m_liveSockets.clear();
+    m_liveSlots.clear();
+    m_slots.clear();
+    m_freeSlots.clear();
+
+    if (m_endPoints != nullptr)
     {
-        i->second = nullptr;
+        delete m_endPoints;
+        m_endPoints = nullptr;
     }
-    m_sockets.clear();
 
     m_node = nullptr;
     /*
@@ -18,6 +18,7 @@
 #define HELIX_L4_PROTOCOL_H
 
 
+#include "helix-end-point-demux.h"
 #include "helix-socket-impl.h"
 
 #include "ns3/internet-module.h"
@@ -29,16 +30,14 @@
 #include "ns3/ptr.h"
 
 #include <stdint.h>
-#include <unordered_map>
+#include <vector>
 
 namespace ns3
 {
 
 class Node;
 class Socket;
-class Ipv4EndPointDemux;
 class Ipv4EndPoint;
-class Ipv6EndPointDemux;
 class Ipv6EndPoint;
 class HelixSocketImpl;
 class NetDevice;
@@ -88,6 +87,143 @@ class HelixL4Protocol : public IpL4Protocol
      */
     Ptr<Socket> CreateSocket();
 
+    /**
+     * \brief Whether HELIX frames go straight to the IP layer
+     *
+     * In native mode sockets do not get an inner UDP socket, frames carry
+     * a HelixHeader, are sent through the down targets and are
+     * demultiplexed in Receive().
+     * \return true if native mode is enabled
+     */
+    bool IsNativeMode() const;
+
+    /**
+     * \brief Drop a socket from the socket table
+     *
+     * Called by HelixSocketImpl once Close() completes. The slot is
+     * reused by later sockets; stale handles are ignored.
+     * \param handle the handle given to the socket by CreateSocket()
+     */
+    void ReleaseSocket(uint64_t handle);
+    /**
+     * \brief Find a live socket by handle
+     * \param handle the handle given to the socket by CreateSocket()
+     * \return the socket, or nullptr if it has been released
+     */
+    Ptr<HelixSocketImpl> LookupSocket(uint64_t handle) const;
+    /**
+     * \return the number of live sockets
+     */
+    uint32_t GetNSockets() const;
+    /**
+     * \brief Get a live socket by position
+     *
+     * Positions are dense in [0, GetNSockets()) and change when a socket
+     * is released, use handles to refer to a socket over time.
+     * \param i position of the socket
+     * \return the socket
+     */
+    Ptr<HelixSocketImpl> GetSocket(uint32_t i) const;
+    /**
+     * \return the largest number of sockets live at the same time
+     */
+    uint32_t GetPeakSockets() const;
+
+    /**
+     * \brief Staging area the sockets of this node flatten packets into
+     *        before handing them to helix-rs
+     *
+     * See HelixRsInterface::SetStagingArea(). The codec tables and the
+     * buffer pool of helix-rs are shared by every socket of the process
+     * already.
+     * \return the staging area, valid as long as this protocol
+     */
+    std::vector<uint8_t>* GetStagingArea();
+
+    /**
+     * \brief Allocate an IPv4 Endpoint
+     * \return the Endpoint
+     */
+    Ipv4EndPoint* Allocate();
+    /**
+     * \brief Allocate an IPv4 Endpoint
+     * \param boundNetDevice Bound NetDevice (if any)
+     * \param address address to use
+     * \param port port to use (0 picks an ephemeral port)
+     * \return the Endpoint
+     */
+    Ipv4EndPoint* Allocate(Ptr<NetDevice> boundNetDevice, Ipv4Address address, uint16_t port);
+    /**
+     * \brief Allocate an IPv6 Endpoint
+     * \return the Endpoint
+     */
+    Ipv6EndPoint* Allocate6();
+    /**
+     * \brief Allocate an IPv6 Endpoint
+     * \param boundNetDevice Bound NetDevice (if any)
+     * \param address address to use
+     * \param port port to use (0 picks an ephemeral port)
+     * \return the Endpoint
+     */
+    Ipv6EndPoint* Allocate6(Ptr<NetDevice> boundNetDevice, Ipv6Address address, uint16_t port);
+    /**
+     * \brief Connect an IPv4 Endpoint to a peer
+     * \param endPoint the end point to connect
+     * \param peerAddress remote address
+     * \param peerPort remote port
+     * \return false if another end point is already connected to that peer
+     */
+    bool SetPeer(Ipv4EndPoint* endPoint, Ipv4Address peerAddress, uint16_t peerPort);
+    /**
+     * \brief Connect an IPv6 Endpoint to a peer
+     * \param endPoint the end point to connect
+     * \param peerAddress remote address
+     * \param peerPort remote port
+     * \return false if another end point is already connected to that peer
+     */
+    bool SetPeer(Ipv6EndPoint* endPoint, Ipv6Address peerAddress, uint16_t peerPort);
+    /**
+     * \brief Remove an IPv4 Endpoint.
+     * \param endPoint the end point to remove
+     */
+    void DeAllocate(Ipv4EndPoint* endPoint);
+    /**
+     * \brief Remove an IPv6 Endpoint.
+     * \param endPoint the end point to remove
+     */
+    void DeAllocate(Ipv6EndPoint* endPoint);
+
+    /**
+     * \brief Send a frame via HELIX over IPv4 (native mode)
+     * \param packet the packet to send
+     * \param saddr the source Ipv4Address
+     * \param daddr the destination Ipv4Address
+     * \param sport the source port number
+     * \param dport the destination port number
+     * \param route the route
+     */
+    void Send(Ptr<Packet> packet,
+              Ipv4Address saddr,
+              Ipv4Address daddr,
+              uint16_t sport,
+              uint16_t dport,
+              Ptr<Ipv4Route> route);
+    /**
+     * \brief Send a frame via HELIX over IPv6 (native mode)
+     * \param packet the packet to send
+     * \param saddr the source Ipv6Address
+     * \param daddr the destination Ipv6Address
+     * \param sport the source port number
+     * \param dport the destination port number
+     * \param route the route
+     */
+    void Send(Ptr<Packet> packet,
+              Ipv6Address saddr,
+              Ipv6Address daddr,
+              uint16_t sport,
+              uint16_t dport,
+              Ptr<Ipv6Route> route);
+
     // inherited from Ipv4L4Protocol
     IpL4Protocol::RxStatus Receive(Ptr<Packet> p,
                                    const Ipv4Header& header,
@@ -133,9 +269,28 @@ class HelixL4Protocol : public IpL4Protocol
   private:
     Ptr<Node> m_node;                //!< The node this stack is associated with
 
-    std::unordered_map<uint64_t, Ptr<HelixSocketImpl>>
-        m_sockets;             //!< Unordered map of socket IDs and corresponding sockets
-    uint64_t m_socketIndex{0}; //!< Index of the next socket to be created
+    /**
+     * \brief Slot of the socket table
+     *
+     * A handle is (generation << 32 | slot index), the generation is
+     * bumped on release so handles of released sockets never match.
+     */
+    struct SocketSlot
+    {
+        Ptr<HelixSocketImpl> socket; //!< the socket, nullptr if the slot is free
+        uint32_t generation;         //!< generation of the current occupant
+        uint32_t position;           //!< position of the socket in m_liveSockets
+    };
+
+    std::vector<SocketSlot> m_slots;                 //!< socket table, indexed by handle
+    std::vector<uint32_t> m_freeSlots;               //!< released slots, reused first
+    std::vector<Ptr<HelixSocketImpl>> m_liveSockets; //!< live sockets, contiguous
+    std::vector<uint32_t> m_liveSlots;               //!< slot of each entry of m_liveSockets
+    uint32_t m_peakSockets{0};                       //!< high-water mark of live sockets
+    std::vector<uint8_t> m_staging;  //!< staging area shared by the sockets
+    bool m_nativeMode;          //!< send frames straight to IP instead of through UDP
+    TypeId m_congestionTypeId;  //!< congestion control algorithm of new sockets
+    HelixEndPointDemux* m_endPoints; //!< IPv4 and IPv6 end points (native mode)
     IpL4Protocol::DownTargetCallback m_downTarget;   //!< Callback to send packets over IPv4
     IpL4Protocol::DownTargetCallback6 m_downTarget6; //!< Callback to send packets over IPv6
 };
@@ -0,0 +1,235 @@
+
+#include "helix-redundancy-controller.h"
+
+#include "ns3/boolean.h"
+#include "ns3/double.h"
+#include "ns3/log.h"
+#include "ns3/trace-source-accessor.h"
+#include "ns3/uinteger.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace ns3
+{
+
+NS_LOG_COMPONENT_DEFINE("HelixRedundancyController");
+
+NS_OBJECT_ENSURE_REGISTERED(HelixRedundancyController);
+
+TypeId
+HelixRedundancyController::GetTypeId()
+{
+    static TypeId tid =
+        TypeId("ns3::HelixRedundancyController")
+            .SetParent<Object>()
+            .SetGroupName("Internet")
+            .AddConstructor<HelixRedundancyController>()
+            .AddAttribute("Enabled",
+                          "Whether the socket adapts its RepairOverhead to the reported "
+                          "loss, otherwise RepairOverhead stays fixed",
+                          BooleanValue(true),
+                          MakeBooleanAccessor(&HelixRedundancyController::m_enabled),
+                          MakeBooleanChecker())
+            .AddAttribute("TargetDecodeProbability",
+                          "Probability with which a generation should decode from its "
+                          "first repair round",
+                          DoubleValue(0.99),
+                          MakeDoubleAccessor(&HelixRedundancyController::m_target),
+                          MakeDoubleChecker<double>(0, 0.999999))
+            .AddAttribute("MinRepairRatio",
+                          "Lowest repair ratio, kept so that losses are noticed early",
+                          DoubleValue(0.05),
+                          MakeDoubleAccessor(&HelixRedundancyController::m_minRatio),
+                          MakeDoubleChecker<double>(0))
+            .AddAttribute("MaxRepairRatio",
+                          "Highest repair ratio",
+                          DoubleValue(1.0),
+                          MakeDoubleAccessor(&HelixRedundancyController::m_maxRatio),
+                          MakeDoubleChecker<double>(0))
+            .AddAttribute("Gain",
+                          "EWMA gain applied to every loss report",
+                          DoubleValue(0.25),
+                          MakeDoubleAccessor(&HelixRedundancyController::m_gain),
+                          MakeDoubleChecker<double>(0, 1))
+            .AddAttribute("MaxInterleaveDepth",
+                          "Largest interleave depth picked for sockets whose "
+                          "InterleaveDepth is 0",
+                          UintegerValue(8),
+                          MakeUintegerAccessor(&HelixRedundancyController::m_maxInterleaveDepth),
+                          MakeUintegerChecker<uint32_t>(1, 64))
+            .AddTraceSource("RepairRatio",
+                            "Repair symbols sent per source symbol in the first round",
+                            MakeTraceSourceAccessor(&HelixRedundancyController::m_repairRatio),
+                            "ns3::TracedValueCallback::Double");
+    return tid;
+}
+
+HelixRedundancyController::HelixRedundancyController()
+    : m_enabled(true),
+      m_target(0.99),
+      m_minRatio(0.05),
+      m_maxRatio(1.0),
+      m_gain(0.25),
+      m_lossRate(0),
+      m_burstLength(1),
+      m_interleaveDepth(1),
+      m_maxInterleaveDepth(8),
+      m_haveReport(false),
+      m_last{0, 0, 0},
+      m_repairRatio(0.25)
+{
+    NS_LOG_FUNCTION(this);
+}
+
+HelixRedundancyController::~HelixRedundancyController()
+{
+    NS_LOG_FUNCTION(this);
+}
+
+bool
+HelixRedundancyController::IsEnabled() const
+{
+    return m_enabled;
+}
+
+void
+HelixRedundancyController::SetRepairRatio(double ratio)
+{
+    NS_LOG_FUNCTION(this << ratio);
+    m_repairRatio = ratio;
+}
+
+double
+HelixRedundancyController::GetRepairRatio() const
+{
+    return m_repairRatio;
+}
+
+double
+HelixRedundancyController::GetLossRate() const
+{
+    return m_lossRate;
+}
+
+double
+HelixRedundancyController::GetBurstLength() const
+{
+    return m_burstLength;
+}
+
+void
+HelixRedundancyController::SetInterleaveDepth(uint32_t depth)
+{
+    NS_LOG_FUNCTION(this << depth);
+    m_interleaveDepth = std::max<uint32_t>(depth, 1);
+}
+
+uint32_t
+HelixRedundancyController::PickInterleaveDepth() const
+{
+    auto depth = static_cast<uint32_t>(std::ceil(m_burstLength - 1e-9));
+    return std::min(std::max<uint32_t>(depth, 1), m_maxInterleaveDepth);
+}
+
+bool
+HelixRedundancyController::OnFeedback(const FFILossFeedback& feedback, uint32_t generationSize)
+{
+    NS_LOG_FUNCTION(this << feedback.received << feedback.lost << feedback.bursts);
+
+    // the counters wrap, only differences between two reports are meaningful;
+    // lost can step back when a frame arrives out of order
+    uint32_t received = feedback.received - m_last.received;
+    int32_t lost = std::max<int32_t>(0, static_cast<int32_t>(feedback.lost - m_last.lost));
+    uint32_t bursts = feedback.bursts - m_last.bursts;
+    if (received + lost == 0)
+    {
+        return false;
+    }
+    m_last = feedback;
+
+    double lossSample = static_cast<double>(lost) / (received + lost);
+    double gain = m_haveReport ? m_gain : 1.0;
+    m_haveReport = true;
+    m_lossRate += gain * (lossSample - m_lossRate);
+    if (bursts > 0)
+    {
+        double burstSample = std::max(1.0, static_cast<double>(lost) / bursts);
+        m_burstLength += gain * (burstSample - m_burstLength);
+    }
+    if (!m_enabled)
+    {
+        // only the estimates are kept, for PickInterleaveDepth()
+        return false;
+    }
+
+    uint32_t k = std::max<uint32_t>(generationSize, 1);
+    double ratio = static_cast<double>(RequiredRepairs(k)) / k;
+    ratio = std::min(std::max(ratio, m_minRatio), m_maxRatio);
+    NS_LOG_LOGIC("loss " << m_lossRate << " burst " << m_burstLength << " ratio " << ratio);
+
+    if (ratio == m_repairRatio)
+    {
+        return false;
+    }
+    m_repairRatio = ratio;
+    return true;
+}
+
+uint32_t
+HelixRedundancyController::RequiredRepairs(uint32_t k) const
+{
+    uint32_t hi = static_cast<uint32_t>(std::ceil(m_maxRatio * k));
+    if (m_lossRate <= 0 || DecodeProbability(k, hi) < m_target)
+    {
+        return m_lossRate <= 0 ? 0 : hi;
+    }
+
+    // the decode probability grows with r, find the smallest r reaching the target
+    uint32_t lo = 0;
+    while (lo < hi)
+    {
+        uint32_t mid = lo + (hi - lo) / 2;
+        if (DecodeProbability(k, mid) >= m_target)
+        {
+            hi = mid;
+        }
+        else
+        {
+            lo = mid + 1;
+        }
+    }
+    return lo;
+}
+
+double
+HelixRedundancyController::DecodeProbability(uint32_t k, uint32_t r) const
+{
+    double p = std::min(m_lossRate, 1.0);
+    if (p >= 1)
+    {
+        return 0;
+    }
+    double b = std::max(m_burstLength / m_interleaveDepth, 1.0);
+    auto events = static_cast<uint32_t>(std::ceil((k + r) / b));
+    auto tolerated = static_cast<uint32_t>(std::floor(r / b));
+    if (tolerated >= events)
+    {
+        return 1;
+    }
+
+    // P(Binomial(events, p) <= tolerated), summed in the log domain since
+    // (1 - p)^events underflows for large generations
+    double logP = std::log(p);
+    double logQ = std::log1p(-p);
+    double logEvents = std::lgamma(events + 1.0);
+    double cdf = 0;
+    for (uint32_t i = 0; i <= tolerated; i++)
+    {
+        cdf += std::exp(logEvents - std::lgamma(i + 1.0) - std::lgamma(events - i + 1.0) +
+                        i * logP + (events - i) * logQ);
+    }
+    return std::min(cdf, 1.0);
+}
+
+} // namespace ns3
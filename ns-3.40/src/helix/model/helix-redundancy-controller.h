@@ -0,0 +1,137 @@
+/*
+ * Loss-adaptive redundancy controller for HELIX sockets
+ *
+ * Every ack carries the receiver's cumulative loss counters (frames
+ * received, frames lost and the bursts they were lost in). The controller
+ * turns the differences between two reports into smoothed estimates of
+ * the loss rate and the mean burst length, and picks the smallest repair
+ * ratio for which a generation still decodes from its first repair round
+ * with the target probability.
+ *
+ * Losses in bursts of mean length b are modelled as ceil(n / b)
+ * independent loss events of b frames each, so a generation of k sources
+ * sent with r repairs decodes when Binomial(ceil((k + r) / b), p) events
+ * lose no more than r frames.
+ *
+ * When the socket interleaves d generations, a burst is spread over
+ * them and each generation sees bursts of b / d frames. The controller
+ * also suggests the depth for sockets that adapt it: the mean burst
+ * length, which leaves a burst about one frame per generation.
+ */
+#ifndef HELIX_REDUNDANCY_CONTROLLER_H
+#define HELIX_REDUNDANCY_CONTROLLER_H
+
+#include "helix-rs-interface.h"
+
+#include "ns3/object.h"
+#include "ns3/traced-value.h"
+
+#include <stdint.h>
+
+namespace ns3
+{
+
+/**
+ * \ingroup helix
+ *
+ * \brief Adapts the proactive repair ratio of a HELIX socket to the loss
+ *        rate and burstiness reported by the receiver
+ */
+class HelixRedundancyController : public Object
+{
+  public:
+    /**
+     * \brief Get the type ID.
+     * \return the object TypeId
+     */
+    static TypeId GetTypeId();
+
+    HelixRedundancyController();
+    ~HelixRedundancyController() override;
+
+    /**
+     * \brief Whether the socket should follow the controller
+     * \return true if enabled
+     */
+    bool IsEnabled() const;
+
+    /**
+     * \brief Set the ratio used until the first loss report
+     * \param ratio repair symbols per source symbol
+     */
+    void SetRepairRatio(double ratio);
+
+    /**
+     * \brief Get the current repair ratio
+     * \return repair symbols per source symbol
+     */
+    double GetRepairRatio() const;
+
+    /**
+     * \brief Update the estimates from the receiver's loss counters
+     * \param feedback cumulative counters from the latest ack
+     * \param generationSize source symbols per generation
+     * \return true if the repair ratio changed
+     */
+    bool OnFeedback(const FFILossFeedback& feedback, uint32_t generationSize);
+
+    /**
+     * \brief Smallest number of repairs for which a generation of k
+     *        sources decodes with the target probability
+     * \param k source symbols in the generation
+     * \return repair symbols for the first round
+     */
+    uint32_t RequiredRepairs(uint32_t k) const;
+
+    /**
+     * \brief Get the smoothed loss rate
+     * \return fraction of frames lost
+     */
+    double GetLossRate() const;
+
+    /**
+     * \brief Get the smoothed mean loss burst length
+     * \return frames per loss burst, at least 1
+     */
+    double GetBurstLength() const;
+
+    /**
+     * \brief Set the interleave depth the socket sends with
+     * \param depth generations a stripe of symbols is spread over
+     */
+    void SetInterleaveDepth(uint32_t depth);
+
+    /**
+     * \brief Interleave depth that spreads a mean loss burst over as many
+     *        generations as it has frames
+     * \return depth, between 1 and MaxInterleaveDepth
+     */
+    uint32_t PickInterleaveDepth() const;
+
+  private:
+    /**
+     * \brief Probability that a generation of k sources sent with r
+     *        repairs decodes under the current estimates
+     * \param k source symbols
+     * \param r repair symbols
+     * \return decode probability
+     */
+    double DecodeProbability(uint32_t k, uint32_t r) const;
+
+    bool m_enabled;                      //!< whether the socket follows the controller
+    double m_target;                     //!< target decode probability of a generation
+    double m_minRatio;                   //!< lowest repair ratio
+    double m_maxRatio;                   //!< highest repair ratio
+    double m_gain;                       //!< EWMA gain of the estimates
+    double m_lossRate;                   //!< smoothed loss rate
+    double m_burstLength;                //!< smoothed mean loss burst length
+    uint32_t m_interleaveDepth;          //!< generations a burst is spread over
+    uint32_t m_maxInterleaveDepth;       //!< largest depth PickInterleaveDepth() returns
+    bool m_haveReport;                   //!< whether m_last holds a report
+    FFILossFeedback m_last;              //!< counters of the previous report
+    TracedValue<double> m_repairRatio;   //!< current repair ratio
+};
+
+} // namespace ns3
+
+#endif /* HELIX_REDUNDANCY_CONTROLLER_H */
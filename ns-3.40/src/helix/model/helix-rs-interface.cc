@@ -11,6 +11,13 @@
 #include "ns3/object.h"
 #include "ns3/packet.h"
 #include "ns3/ptr.h"
+#include "ns3/simulator.h"
+#include "ns3/trace-source-accessor.h"
+#include "ns3/uinteger.h"
+
+#include <chrono>
+#include <limits>
+#include <string>
 
 
 
@@ -28,18 +35,106 @@ HelixRsInterface::GetTypeId()
     static TypeId tid = TypeId("ns3::HelixRsInterface")
                             .SetParent<Object>()
                             .SetGroupName("Internet")
-                            .AddConstructor<HelixRsInterface>();
+                            .AddConstructor<HelixRsInterface>()
+                            .AddAttribute("SymbolSize",
+                                          "Symbol size in bytes, the shared buffer pool "
+                                          "hands out buffers in multiples of it",
+                                          UintegerValue(1024),
+                                          MakeUintegerAccessor(&HelixRsInterface::SetSymbolSize,
+                                                               &HelixRsInterface::GetSymbolSize),
+                                          MakeUintegerChecker<uint32_t>(1, 65535))
+                            .AddTraceSource("CallTime",
+                                            "Wall clock time spent in a call into helix-rs "
+                                            "that encodes, decodes or polls frames",
+                                            MakeTraceSourceAccessor(
+                                                &HelixRsInterface::m_callTimeTrace),
+                                            "ns3::Time::TracedCallback");
     return tid;
 }
 
 HelixRsInterface::HelixRsInterface()
+    : m_conn(nullptr),
+      m_staging(&m_ownStaging),
+      m_copiedConversions(0),
+      m_symbolSize(0),
+      m_codingConfig(helix_rs_default_coding_config())
 {
     NS_LOG_FUNCTION(this);
+    SyncRsLogLevels();
+    m_conn = helix_rs_create_socket();
 }
 
 HelixRsInterface::~HelixRsInterface()
 {
     NS_LOG_FUNCTION(this);
+    if (m_conn)
+    {
+        helix_rs_destroy_socket(m_conn);
+        m_conn = nullptr;
+    }
+}
+
+void
+HelixRsInterface::DoDispose()
+{
+    NS_LOG_FUNCTION(this);
+    if (m_conn)
+    {
+        helix_rs_destroy_socket(m_conn);
+        m_conn = nullptr;
+    }
+    Object::DoDispose();
+}
+
+HelixConnection*
+HelixRsInterface::GetConnection() const
+{
+    return m_conn;
+}
+
+/* -------------------- Logging -------------------- */
+
+void
+HelixRsInterface::SyncRsLogLevels()
+{
+    uint32_t mask = 0;
+#ifdef NS3_LOG_ENABLE
+    for (LogLevel level : {LOG_ERROR, LOG_WARN, LOG_DEBUG, LOG_INFO, LOG_FUNCTION, LOG_LOGIC})
+    {
+        if (g_log.IsEnabled(level))
+        {
+            mask |= level;
+        }
+    }
+#endif
+    helix_rs_set_log_callback(&HelixRsInterface::ForwardRsLog, mask);
+}
+
+void
+HelixRsInterface::ForwardRsLog(uint32_t level, const uint8_t* message, size_t len)
+{
+    std::string line(reinterpret_cast<const char*>(message), len);
+    switch (level)
+    {
+    case LOG_ERROR:
+        NS_LOG_ERROR("helix-rs: " << line);
+        break;
+    case LOG_WARN:
+        NS_LOG_WARN("helix-rs: " << line);
+        break;
+    case LOG_DEBUG:
+        NS_LOG_DEBUG("helix-rs: " << line);
+        break;
+    case LOG_INFO:
+        NS_LOG_INFO("helix-rs: " << line);
+        break;
+    case LOG_FUNCTION:
+        NS_LOG(LOG_FUNCTION, "helix-rs: " << line);
+        break;
+    default:
+        NS_LOG_LOGIC("helix-rs: " << line);
+        break;
+    }
 }
 
 /* -------------------- Basic Socket Interface -------------------- */
@@ -49,8 +144,9 @@ HelixRsInterface::Bind(const Address & address)
 {
     NS_LOG_FUNCTION(this << address);
 
-    helix_rs_bind();
-    return 0;
+    uint8_t buf[Address::MAX_SIZE];
+    uint32_t len = address.CopyAllTo(buf, Address::MAX_SIZE);
+    return helix_rs_bind(m_conn, buf, len);
 }
 
 int
@@ -58,8 +154,9 @@ HelixRsInterface::Connect(const Address & address)
 {
     NS_LOG_FUNCTION(this << address);
 
-    helix_rs_connect();
-    return 0;
+    uint8_t buf[Address::MAX_SIZE];
+    uint32_t len = address.CopyAllTo(buf, Address::MAX_SIZE);
+    return helix_rs_connect(m_conn, buf, len);
 }
 
 int
@@ -67,67 +164,305 @@ HelixRsInterface::Listen()
 {
     NS_LOG_FUNCTION(this);
 
-    helix_rs_listen();
-    return 0;
+    return helix_rs_listen(m_conn);
 }
 
-Ptr<Packet>
-HelixRsInterface::Recv(Ptr<Packet> p)
+int
+HelixRsInterface::Close()
 {
     NS_LOG_FUNCTION(this);
 
-    FFISharedBuffer buff = ConvertPacketToFFIBuff(p);
-    FFISharedBuffer decoded_buff = helix_rs_recv(buff);
-    Ptr<Packet> decoded_packet = ConvertFFIBuffToPacket(decoded_buff);
-    // return decoded_packet;
+    return helix_rs_close(m_conn);
+}
 
-    // TODO: remove this part and uncomment line above
-    return p;
+/* -------------------- Streaming Codec -------------------- */
+
+/**
+ * \brief Current simulation time in the nanoseconds helix-rs keeps its timers in
+ */
+static uint64_t
+NowNs()
+{
+    return static_cast<uint64_t>(Simulator::Now().GetNanoSeconds());
 }
 
+/**
+ * Reports the wall clock time of its scope to a trace, the clock is only
+ * read when something is connected
+ */
+class CallTimer
+{
+  public:
+    explicit CallTimer(const TracedCallback<Time>& trace)
+        : m_trace(trace),
+          m_timed(!trace.IsEmpty())
+    {
+        if (m_timed)
+        {
+            m_start = std::chrono::steady_clock::now();
+        }
+    }
+
+    ~CallTimer()
+    {
+        if (m_timed)
+        {
+            auto elapsed = std::chrono::steady_clock::now() - m_start;
+            m_trace(NanoSeconds(
+                std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()));
+        }
+    }
+
+  private:
+    const TracedCallback<Time>& m_trace;          //!< trace to report to
+    bool m_timed;                                 //!< whether the trace is connected
+    std::chrono::steady_clock::time_point m_start; //!< when the scope was entered
+};
+
 int
-HelixRsInterface::Send(Ptr<Packet>)
+HelixRsInterface::Send(Ptr<Packet> p)
 {
-    NS_LOG_FUNCTION(this);
+    NS_LOG_FUNCTION(this << p);
 
-    helix_rs_send(FFISharedBuffer());
+    CallTimer timer(m_callTimeTrace);
+    helix_rs_send(m_conn, ConvertPacketToFFIBuff(p), NowNs());
     return 0;
 }
 
 int
-HelixRsInterface::Close()
+HelixRsInterface::SendBatch(const std::vector<Ptr<Packet>>& packets)
 {
-    NS_LOG_FUNCTION(this);
+    NS_LOG_FUNCTION(this << packets.size());
+
+    if (packets.empty())
+    {
+        return 0;
+    }
 
-    helix_rs_close();
+    CallTimer timer(m_callTimeTrace);
+    ConvertPacketsToFFIBuffs(packets, m_batchIn);
+    helix_rs_send_batch(m_conn, m_batchIn.data(), m_batchIn.size(), NowNs());
     return 0;
 }
 
+void
+HelixRsInterface::Flush()
+{
+    NS_LOG_FUNCTION(this);
 
-/* -------------------- Packet Manipulation -------------------- */
+    CallTimer timer(m_callTimeTrace);
+    helix_rs_flush(m_conn, NowNs());
+}
 
 Ptr<Packet>
-HelixRsInterface::EncodePacket(Ptr<Packet> p)
+HelixRsInterface::PollTransmit()
 {
-    NS_LOG_FUNCTION(this << p);
+    return PollTransmit(std::numeric_limits<uint64_t>::max());
+}
 
+Ptr<Packet>
+HelixRsInterface::PollTransmit(uint64_t window)
+{
+    NS_LOG_FUNCTION(this << window);
+
+    CallTimer timer(m_callTimeTrace);
+    FFISharedBuffer frame = helix_rs_poll_transmit_window(m_conn, window);
+    if (frame.ptr == nullptr || frame.len == 0)
+    {
+        return nullptr;
+    }
+    Ptr<Packet> p = ConvertFFIBuffToPacket(frame);
+
+    // hand the buffer back so the next frame reuses it
+    helix_rs_buffer_release(frame);
     return p;
 }
 
+uint32_t
+HelixRsInterface::Recv(Ptr<Packet> frame)
+{
+    NS_LOG_FUNCTION(this << frame);
+
+    if (!frame)
+    {
+        return 0;
+    }
+    CallTimer timer(m_callTimeTrace);
+    return helix_rs_recv(m_conn, ConvertPacketToFFIBuff(frame), NowNs());
+}
+
+uint32_t
+HelixRsInterface::RecvBatch(const std::vector<Ptr<Packet>>& frames)
+{
+    NS_LOG_FUNCTION(this << frames.size());
+
+    if (frames.empty())
+    {
+        return 0;
+    }
+
+    CallTimer timer(m_callTimeTrace);
+    ConvertPacketsToFFIBuffs(frames, m_batchIn);
+    return helix_rs_recv_batch(m_conn, m_batchIn.data(), m_batchIn.size(), NowNs());
+}
+
 Ptr<Packet>
-HelixRsInterface::DecodePacket(Ptr<Packet> p)
+HelixRsInterface::PollRecv()
 {
-    NS_LOG_FUNCTION(this << p);
+    NS_LOG_FUNCTION(this);
 
+    FFISharedBuffer decoded = helix_rs_poll_recv(m_conn);
+    if (decoded.ptr == nullptr)
+    {
+        return nullptr;
+    }
+    Ptr<Packet> p = ConvertFFIBuffToPacket(decoded);
+    helix_rs_buffer_release(decoded);
     return p;
 }
 
+uint32_t
+HelixRsInterface::PollRecv(Ptr<HelixRxBuffer> buffer)
+{
+    NS_LOG_FUNCTION(this << buffer);
+
+    CallTimer timer(m_callTimeTrace);
+    uint32_t chunks = 0;
+    uint64_t offset = 0;
+    FFISharedBuffer decoded;
+    while ((decoded = helix_rs_poll_recv_at(m_conn, &offset)).ptr != nullptr)
+    {
+        // recovered chunks may still lie beyond the limit, those are dropped
+        if (buffer && buffer->Write(offset, decoded.ptr, decoded.len) > 0)
+        {
+            NS_LOG_LOGIC("chunk at " << offset << " does not fit the receive buffer");
+        }
+        helix_rs_buffer_release(decoded);
+        chunks++;
+    }
+    return chunks;
+}
+
+bool
+HelixRsInterface::SetRecvLimit(uint64_t limit)
+{
+    NS_LOG_FUNCTION(this << limit);
+    return helix_rs_set_recv_limit(m_conn, limit, NowNs()) != 0;
+}
+
+uint64_t
+HelixRsInterface::GetSendRoom() const
+{
+    return helix_rs_send_room(m_conn);
+}
+
+void
+HelixRsInterface::SetRtt(Time rtt)
+{
+    NS_LOG_FUNCTION(this << rtt);
+    helix_rs_set_rtt(m_conn, static_cast<uint64_t>(rtt.GetNanoSeconds()));
+}
+
+Time
+HelixRsInterface::GetNextTimeout() const
+{
+    uint64_t deadline = helix_rs_next_timeout(m_conn);
+    if (deadline == UINT64_MAX || deadline > static_cast<uint64_t>(Time::Max().GetNanoSeconds()))
+    {
+        return Time::Max();
+    }
+    return NanoSeconds(deadline);
+}
+
+void
+HelixRsInterface::OnTimeout()
+{
+    NS_LOG_FUNCTION(this);
+
+    CallTimer timer(m_callTimeTrace);
+    helix_rs_on_timeout(m_conn, NowNs());
+}
+
+uint32_t
+HelixRsInterface::GetPendingGenerations() const
+{
+    return helix_rs_pending_generations(m_conn);
+}
+
+uint32_t
+HelixRsInterface::GetQueuedFrames() const
+{
+    return helix_rs_queued_frames(m_conn);
+}
+
+void
+HelixRsInterface::SetCodingConfig(const HelixCodingConfig& config)
+{
+    NS_LOG_FUNCTION(this << config.generation_size << config.repair_overhead
+                         << config.repair_timeout_ns << config.max_repair_rounds);
+
+    HelixCodingConfig next = config;
+    next.symbol_size = m_symbolSize;
+    if (helix_rs_configure(m_conn, next) != 0)
+    {
+        NS_LOG_WARN("helix-rs rejected the coding config, keeping the previous one");
+        return;
+    }
+    m_codingConfig = next;
+}
+
+HelixCodingConfig
+HelixRsInterface::GetCodingConfig() const
+{
+    return m_codingConfig;
+}
+
+FFIDecodeStats
+HelixRsInterface::GetDecodeStats() const
+{
+    return helix_rs_decode_stats(m_conn);
+}
+
+FFICongestionSample
+HelixRsInterface::GetCongestionSample()
+{
+    return helix_rs_congestion_sample(m_conn);
+}
+
+Time
+HelixRsInterface::PollDecodeLatency()
+{
+    uint64_t latency = helix_rs_poll_decode_latency(m_conn);
+    if (latency == UINT64_MAX)
+    {
+        return Time::Max();
+    }
+    return NanoSeconds(latency);
+}
+
+FFILossFeedback
+HelixRsInterface::GetLossFeedback() const
+{
+    return helix_rs_loss_feedback(m_conn);
+}
+
+
+/* -------------------- Packet Manipulation -------------------- */
+
 Ptr<Packet>
 HelixRsInterface::ConvertFFIBuffToPacket(FFISharedBuffer b)
 {
     NS_LOG_FUNCTION(this);
 
-    return Ptr<Packet>();
+    if (b.ptr == nullptr || b.len == 0)
+    {
+        return Create<Packet>();
+    }
+
+    // a Packet cannot adopt foreign memory, it takes its own copy of the
+    // bytes straight from the rust buffer
+    m_copiedConversions++;
+    return Create<Packet>(b.ptr, static_cast<uint32_t>(b.len));
 }
 
 FFISharedBuffer
@@ -135,7 +470,102 @@ HelixRsInterface::ConvertPacketToFFIBuff(Ptr<Packet> p)
 {
     NS_LOG_FUNCTION(this << p);
 
-    return FFISharedBuffer();
+    uint32_t size = p->GetSize();
+    if (size == 0)
+    {
+        return FFISharedBuffer{nullptr, 0, nullptr};
+    }
+
+    // Packet does not expose its internal buffer, so the payload is
+    // flattened once into the staging area and rust borrows a view of it.
+    // The staging area only grows, so steady state does not allocate.
+    if (m_staging->size() < size)
+    {
+        m_staging->resize(size);
+    }
+    p->CopyData(m_staging->data(), size);
+    m_copiedConversions++;
+
+    return FFISharedBuffer{m_staging->data(), size, nullptr};
+}
+
+void
+HelixRsInterface::ConvertPacketsToFFIBuffs(const std::vector<Ptr<Packet>>& packets,
+                                           std::vector<FFISharedBuffer>& buffs)
+{
+    NS_LOG_FUNCTION(this << packets.size());
+
+    // size the staging area once up front, growing it while views into it
+    // are outstanding would invalidate them
+    size_t total = 0;
+    for (const auto& p : packets)
+    {
+        total += p->GetSize();
+    }
+    if (m_staging->size() < total)
+    {
+        m_staging->resize(total);
+    }
+
+    buffs.resize(packets.size());
+    size_t offset = 0;
+    for (size_t i = 0; i < packets.size(); i++)
+    {
+        uint32_t size = packets[i]->GetSize();
+        if (size == 0)
+        {
+            buffs[i] = FFISharedBuffer{nullptr, 0, nullptr};
+            continue;
+        }
+        packets[i]->CopyData(m_staging->data() + offset, size);
+        m_copiedConversions++;
+        buffs[i] = FFISharedBuffer{m_staging->data() + offset, size, nullptr};
+        offset += size;
+    }
+}
+
+void
+HelixRsInterface::SetStagingArea(std::vector<uint8_t>* staging)
+{
+    NS_LOG_FUNCTION(this << staging);
+    m_staging = staging ? staging : &m_ownStaging;
+    m_ownStaging.clear();
+    m_ownStaging.shrink_to_fit();
+}
+
+/* -------------------- Conversion Statistics -------------------- */
+
+uint64_t
+HelixRsInterface::GetCopiedConversions() const
+{
+    return m_copiedConversions;
+}
+
+/* -------------------- Buffer Pool -------------------- */
+
+void
+HelixRsInterface::SetSymbolSize(uint32_t symbolSize)
+{
+    NS_LOG_FUNCTION(this << symbolSize);
+    m_symbolSize = symbolSize;
+    helix_rs_pool_configure(symbolSize);
+    if (m_conn)
+    {
+        m_codingConfig.symbol_size = symbolSize;
+        helix_rs_configure(m_conn, m_codingConfig);
+    }
+}
+
+uint32_t
+HelixRsInterface::GetSymbolSize() const
+{
+    return m_symbolSize;
+}
+
+FFIPoolStats
+HelixRsInterface::GetPoolStats() const
+{
+    return helix_rs_pool_stats();
 }
 
 
@@ -19,6 +19,7 @@
 
 
 #include "ns3/helix-socket-impl.h"
+#include "helix-rx-buffer.h"
 
 #include "/Users/ernestmccarter/Documents/Princeton/School/concentration/senior thesis/ns3/workspace/ns-allinone-3.40/helix-rs/result/include/helix_rs.h"
 
@@ -26,11 +27,19 @@
 #include "ns3/core-module.h"
 #include "ns3/ptr.h"
 #include "ns3/packet.h"
+#include "ns3/traced-callback.h"
+
+#include <vector>
 
 
 namespace ns3
 {
 
+/// Header helix-rs puts in front of every coded symbol
+static const uint32_t FRAME_HEADER_SIZE = 13;
+
+/// Length and offset helix-rs puts in front of the data of a source symbol
+static const uint32_t SOURCE_PREFIX_SIZE = 10;
 
 class HelixSocketImpl;
 
@@ -66,45 +75,282 @@ class HelixRsInterface : public Object
         HelixRsInterface();
         ~HelixRsInterface();
 
+        /**
+         * \brief Get the opaque handle of the Rust connection state
+         * \returns the connection handle owned by this interface
+         */
+        HelixConnection* GetConnection() const;
+
         /* -------------------- HELIX Interface -------------------- */
         int Bind(const Address& address);
         int Connect(const Address& address);
-        int Send(Ptr<Packet> p);
         int Listen();
-        Ptr<Packet> Recv(Ptr<Packet> p);
         int Close();
 
-    private:
+        /* -------------------- Streaming Codec -------------------- */
+        /**
+         * \brief Hand application data to the encoder
+         *
+         * Its source symbols are queued for transmission right away, the
+         * frames are fetched with PollTransmit().
+         * \param p packet to send
+         * \returns 0 on success
+         */
+        int Send(Ptr<Packet> p);
+        /**
+         * \brief Hand several packets to the encoder with a single call
+         * \param packets packets to send
+         * \returns 0 on success
+         */
+        int SendBatch(const std::vector<Ptr<Packet>>& packets);
+        /**
+         * \brief Close the open generation so its repair symbols are queued
+         */
+        void Flush();
+        /**
+         * \brief Get the next frame to put on the wire
+         * \returns the frame, or nullptr if there is none
+         */
+        Ptr<Packet> PollTransmit();
+        /**
+         * \brief Get the next frame to put on the wire as long as fewer
+         *        than window bytes of coded frames are in flight
+         *
+         * Acks are not coded frames, they are returned regardless.
+         * \param window congestion window in bytes
+         * \returns the frame, or nullptr if there is none or the window is full
+         */
+        Ptr<Packet> PollTransmit(uint64_t window);
+        /**
+         * \brief Congestion signals gathered since the previous call
+         *
+         * Frame losses the first repair round recovered are not part of
+         * it, only repair rounds a timeout triggered and generations
+         * given up.
+         * \returns congestion sample
+         */
+        FFICongestionSample GetCongestionSample();
+        /**
+         * \brief Hand a received frame to the decoder
+         * \param frame received frame
+         * \returns the number of packets that became ready for PollRecv()
+         */
+        uint32_t Recv(Ptr<Packet> frame);
+        /**
+         * \brief Hand several received frames to the decoder in a single call
+         * \param frames received frames
+         * \returns the number of packets that became ready for PollRecv()
+         */
+        uint32_t RecvBatch(const std::vector<Ptr<Packet>>& frames);
+        /**
+         * \brief Get the next decoded packet
+         * \returns the packet, or nullptr if there is none
+         */
+        Ptr<Packet> PollRecv();
+        /**
+         * \brief Copy every decoded chunk to its stream offset in a
+         *        receive buffer
+         * \param buffer receive buffer, nullptr to discard the chunks
+         * \returns the number of chunks taken from the decoder
+         */
+        uint32_t PollRecv(Ptr<HelixRxBuffer> buffer);
+        /**
+         * \brief Set the stream offset the receive buffer has room up to
+         *
+         * The limit goes to the peer in the feedback, which stops
+         * encoding beyond it. Chunks decoded beyond it are held back
+         * until it grows, source symbols that would make the decoder
+         * hold more than an initial window are refused.
+         * \param limit stream offset, UINT64_MAX for no limit
+         * \returns true if the limit grew enough that a window update
+         *          waits to go out
+         */
+        bool SetRecvLimit(uint64_t limit);
+        /**
+         * \brief Bytes Send() may still take before the data runs past
+         *        the receive limit the peer reported
+         * \returns send room in bytes
+         */
+        uint64_t GetSendRoom() const;
+        /**
+         * \brief Set the smoothed RTT of the socket, feedback then goes
+         *        out at least every quarter RTT when that is shorter than
+         *        FeedbackInterval
+         * \param rtt the smoothed RTT, zero while unknown
+         */
+        void SetRtt(Time rtt);
+        /**
+         * \brief Get the time OnTimeout() should be called at
+         * \returns the deadline, Time::Max() if no timer is needed
+         */
+        Time GetNextTimeout() const;
+        /**
+         * \brief Queue the repair symbols of generations past their
+         *        deadline, and feedback held back by FeedbackInterval
+         */
+        void OnTimeout();
+        /**
+         * \brief Number of generations the peer has not acked yet,
+         *        including the open one
+         * \returns pending generations
+         */
+        uint32_t GetPendingGenerations() const;
+        /**
+         * \brief Number of coded frames queued for PollTransmit(), acks
+         *        not included
+         * \returns queued frames
+         */
+        uint32_t GetQueuedFrames() const;
+        /**
+         * \brief Set the erasure coding parameters
+         *
+         * The symbol size is taken from the SymbolSize attribute.
+         * \param config coding parameters
+         */
+        void SetCodingConfig(const HelixCodingConfig& config);
+        /**
+         * \brief Get the erasure coding parameters
+         * \returns coding parameters
+         */
+        HelixCodingConfig GetCodingConfig() const;
+        /**
+         * \brief Decode latency percentiles over the most recent generations
+         *
+         * latency_* is the simulation time from the first symbol of a
+         * generation to its decoding, completion_* the wall clock time
+         * spent on the symbol that completed it, both in nanoseconds.
+         * \returns decode statistics
+         */
+        FFIDecodeStats GetDecodeStats() const;
+        /**
+         * \brief Decode latency of the next generation decoded since the
+         *        previous call, only the 64 most recent are kept
+         * \returns simulation time from its first symbol to its decoding,
+         *          Time::Max() if there is none
+         */
+        Time PollDecodeLatency();
+        /**
+         * \brief Loss counters the peer reported in its latest feedback
+         *
+         * The counters are cumulative and wrap, only the difference
+         * between two reports is meaningful.
+         * \returns loss feedback
+         */
+        FFILossFeedback GetLossFeedback() const;
 
-        /* -------------------- Packet Manipulation -------------------- */
+        /* -------------------- Conversion Statistics -------------------- */
         /**
-         * \brief Add HELIX wrapper to a packet
-         * \param  p - packet to encode
-         * \returns Encoded packet
+         * \brief Number of conversions that copied the bytes once
+         *
+         * ns-3 keeps packet bytes private to the Packet, so a non-empty
+         * packet is flattened into the reusable staging area before Rust
+         * is given a read-only view of it, and a Packet built from a Rust
+         * buffer takes its own copy of the bytes.
+         * \returns the number of copied conversions
          */
-        Ptr<Packet> EncodePacket(Ptr<Packet> p);
+        uint64_t GetCopiedConversions() const;
+
+        /* -------------------- Buffer Pool -------------------- */
+        /**
+         * \brief Set the symbol size of this connection
+         *
+         * The shared buffer pool adds size classes for it, next to
+         * those of the symbol sizes other sockets use.
+         * \param symbolSize symbol size in bytes
+         */
+        void SetSymbolSize(uint32_t symbolSize);
         /**
-         * \brief Remove HELIX wrapper from a packet
-         * \param  p - packet to decode
-         * \returns Decoded packet
+         * \brief Get the symbol size the shared buffer pool is sized to
+         * \returns symbol size in bytes
          */
-        Ptr<Packet> DecodePacket(Ptr<Packet> p);
+        uint32_t GetSymbolSize() const;
+        /**
+         * \brief Hit, miss, in use and high-water counts of the buffer
+         *        pool shared with helix-rs
+         * \returns pool statistics
+         */
+        FFIPoolStats GetPoolStats() const;
+
+        /* -------------------- Logging -------------------- */
+        /**
+         * \brief Forward helix-rs log lines to the HelixRsInterface log
+         *        component
+         *
+         * Registers the log callback with helix-rs along with the ns-3
+         * log levels currently enabled on this component, Rust skips
+         * formatting for every other level. Called by the constructor,
+         * call it again after changing the log levels mid-run.
+         */
+        static void SyncRsLogLevels();
+
+        /* -------------------- Packet Manipulation -------------------- */
         /**
          * \brief Convert a packet to an FFISharedBuffer
+         *
+         * The returned buffer is a borrowed, read-only view (its state is
+         * null) that stays valid until the next conversion on this
+         * interface. Rust must not free or keep it past the call.
          * \param  p - packet
          * \returns Buffer version of packet
          */
         FFISharedBuffer ConvertPacketToFFIBuff(Ptr<Packet> p);
         /**
          * \brief Convert an FFISharedBuffer to a packet
+         *
+         * The packet copies the bytes of the buffer, which can be
+         * released as soon as this returns.
          * \param  b - buffer
          * \returns Packet version of buffer
          */
         Ptr<Packet> ConvertFFIBuffToPacket(FFISharedBuffer b);
+        /**
+         * \brief Convert several packets to FFISharedBuffers at once
+         *
+         * All packets are flattened back to back into the staging area,
+         * so the views stay valid together until the next conversion.
+         * \param  packets - packets
+         * \param  buffs - filled with one buffer per packet
+         */
+        void ConvertPacketsToFFIBuffs(const std::vector<Ptr<Packet>>& packets,
+                                      std::vector<FFISharedBuffer>& buffs);
+        /**
+         * \brief Flatten packets into a staging area shared with other
+         *        interfaces instead of one of its own
+         *
+         * The views only live for the call they are passed to, so the
+         * interfaces of a node can take turns with the same area.
+         * \param  staging - staging area, must outlive this interface
+         */
+        void SetStagingArea(std::vector<uint8_t>* staging);
+
+    protected:
+        void DoDispose() override;
+
+    private:
+
+        /**
+         * \brief Log callback registered with helix-rs
+         * \param level ns-3 LogLevel of the line
+         * \param message line, not null terminated
+         * \param len length of the line
+         */
+        static void ForwardRsLog(uint32_t level, const uint8_t* message, size_t len);
+
          
 
         
         /* -------------------- Member Variables -------------------- */
+        HelixConnection* m_conn;            //!< per-socket Rust state, every FFI call is scoped to it
+        std::vector<uint8_t> m_ownStaging;  //!< staging area used until a shared one is set
+        std::vector<uint8_t>* m_staging;    //!< reusable area packets are flattened into
+        uint64_t m_copiedConversions;       //!< conversions that copied the bytes once
+        uint32_t m_symbolSize;              //!< symbol size the buffer pool is sized to
+        HelixCodingConfig m_codingConfig;   //!< erasure coding parameters
+        std::vector<FFISharedBuffer> m_batchIn;  //!< reusable batch of buffers passed to Rust
+        std::vector<FFISharedBuffer> m_batchOut; //!< reusable batch of buffers returned by Rust
+
+        /// Wall clock time of the calls that encode, decode or poll frames
+        TracedCallback<Time> m_callTimeTrace;
 
 };
 
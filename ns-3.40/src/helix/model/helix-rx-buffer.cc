@@ -0,0 +1,187 @@
+
+#include "helix-rx-buffer.h"
+
+#include "ns3/log.h"
+
+#include <algorithm>
+#include <iterator>
+
+namespace ns3
+{
+
+NS_LOG_COMPONENT_DEFINE("HelixRxBuffer");
+
+NS_OBJECT_ENSURE_REGISTERED(HelixRxBuffer);
+
+TypeId
+HelixRxBuffer::GetTypeId()
+{
+    static TypeId tid = TypeId("ns3::HelixRxBuffer")
+                            .SetParent<Object>()
+                            .SetGroupName("Internet")
+                            .AddConstructor<HelixRxBuffer>();
+    return tid;
+}
+
+HelixRxBuffer::HelixRxBuffer()
+    : m_maxSize(131072),
+      m_head(0),
+      m_nextOffset(0)
+{
+    NS_LOG_FUNCTION(this);
+}
+
+HelixRxBuffer::~HelixRxBuffer()
+{
+    NS_LOG_FUNCTION(this);
+}
+
+void
+HelixRxBuffer::SetMaxBufferSize(uint32_t size)
+{
+    NS_LOG_FUNCTION(this << size);
+    m_maxSize = std::max<uint32_t>(size, 1);
+    if (m_filled.empty())
+    {
+        m_ring.clear();
+        m_ring.shrink_to_fit();
+        m_head = 0;
+    }
+}
+
+uint32_t
+HelixRxBuffer::GetMaxBufferSize() const
+{
+    return m_maxSize;
+}
+
+uint64_t
+HelixRxBuffer::NextOffset() const
+{
+    return m_nextOffset;
+}
+
+uint32_t
+HelixRxBuffer::Available() const
+{
+    if (m_filled.empty() || m_filled.begin()->first != m_nextOffset)
+    {
+        return 0;
+    }
+    return static_cast<uint32_t>(m_filled.begin()->second - m_nextOffset);
+}
+
+uint64_t
+HelixRxBuffer::GetLimit() const
+{
+    return m_nextOffset + (m_ring.empty() ? m_maxSize : m_ring.size());
+}
+
+uint32_t
+HelixRxBuffer::Write(uint64_t offset, const uint8_t* data, uint32_t len)
+{
+    NS_LOG_FUNCTION(this << offset << len);
+
+    uint64_t end = offset + len;
+    if (end <= m_nextOffset)
+    {
+        return 0;
+    }
+    if (offset < m_nextOffset)
+    {
+        data += m_nextOffset - offset;
+        offset = m_nextOffset;
+        len = static_cast<uint32_t>(end - offset);
+    }
+
+    if (m_ring.empty())
+    {
+        m_ring.resize(m_maxSize);
+        m_head = 0;
+    }
+    uint64_t limit = m_nextOffset + m_ring.size();
+    if (offset < limit)
+    {
+        uint32_t inRing = static_cast<uint32_t>(std::min(end, limit) - offset);
+        Place(offset, data, inRing);
+        offset += inRing;
+        data += inRing;
+        len -= inRing;
+    }
+    if (len > 0)
+    {
+        NS_LOG_LOGIC("dropping " << len << " bytes at " << offset << " beyond the ring");
+    }
+    return len;
+}
+
+void
+HelixRxBuffer::Place(uint64_t offset, const uint8_t* data, uint32_t len)
+{
+    uint32_t capacity = m_ring.size();
+    uint32_t pos = (m_head + static_cast<uint32_t>(offset - m_nextOffset)) % capacity;
+    uint32_t first = std::min(len, capacity - pos);
+    std::copy_n(data, first, m_ring.begin() + pos);
+    std::copy_n(data + first, len - first, m_ring.begin());
+
+    // merge [offset, offset + len) with the ranges it touches
+    uint64_t start = offset;
+    uint64_t end = offset + len;
+    auto it = m_filled.upper_bound(start);
+    if (it != m_filled.begin())
+    {
+        auto prev = std::prev(it);
+        if (prev->second >= start)
+        {
+            start = prev->first;
+            end = std::max(end, prev->second);
+            it = m_filled.erase(prev);
+        }
+    }
+    while (it != m_filled.end() && it->first <= end)
+    {
+        end = std::max(end, it->second);
+        it = m_filled.erase(it);
+    }
+    m_filled.emplace(start, end);
+}
+
+Ptr<Packet>
+HelixRxBuffer::Read(uint32_t maxBytes)
+{
+    NS_LOG_FUNCTION(this << maxBytes);
+
+    uint32_t len = std::min(maxBytes, Available());
+    if (len == 0)
+    {
+        return nullptr;
+    }
+
+    uint32_t capacity = m_ring.size();
+    uint32_t first = std::min(len, capacity - m_head);
+    Ptr<Packet> p = Create<Packet>(&m_ring[m_head], first);
+    if (first < len)
+    {
+        p->AddAtEnd(Create<Packet>(&m_ring[0], len - first));
+    }
+    m_head = (m_head + len) % capacity;
+    m_nextOffset += len;
+
+    uint64_t end = m_filled.begin()->second;
+    m_filled.erase(m_filled.begin());
+    if (end > m_nextOffset)
+    {
+        m_filled.emplace(m_nextOffset, end);
+    }
+
+    // a new RcvBufSize takes effect once nothing is held
+    if (m_filled.empty() && m_ring.size() != m_maxSize)
+    {
+        m_ring.clear();
+        m_ring.shrink_to_fit();
+        m_head = 0;
+    }
+    return p;
+}
+
+} // namespace ns3
@@ -0,0 +1,116 @@
+/*
+ * Receive buffer of HELIX sockets
+ *
+ * helix-rs hands decoded data out in chunks tagged with their offset in
+ * the sender's byte stream, and a chunk recovered from repair symbols
+ * comes after chunks sent after it. The buffer is a ring of RcvBufSize
+ * bytes covering the stream from the next byte the application reads:
+ * every chunk is copied straight to its place, and reads return the
+ * contiguous bytes at the front, as few or as many as asked for.
+ *
+ * HELIX has no receive window, so a chunk beyond the end of the ring is
+ * kept aside and moved in once reads made room for it.
+ */
+#ifndef HELIX_RX_BUFFER_H
+#define HELIX_RX_BUFFER_H
+
+#include "ns3/object.h"
+#include "ns3/packet.h"
+#include "ns3/ptr.h"
+
+#include <map>
+#include <stdint.h>
+#include <vector>
+
+namespace ns3
+{
+
+/**
+ * \ingroup helix
+ *
+ * \brief Ring buffer reassembling the decoded byte stream in order
+ *
+ * The buffer never holds more than its ring, bytes beyond the ring are
+ * dropped. GetLimit() tells helix-rs where to stop decoding so that
+ * nothing has to be dropped.
+ */
+class HelixRxBuffer : public Object
+{
+  public:
+    /**
+     * \brief Get the type ID.
+     * \return the object TypeId
+     */
+    static TypeId GetTypeId();
+
+    HelixRxBuffer();
+    ~HelixRxBuffer() override;
+
+    /**
+     * \brief Set the ring size, applied the next time the buffer is empty
+     * \param size ring size in bytes
+     */
+    void SetMaxBufferSize(uint32_t size);
+
+    /**
+     * \brief Get the ring size
+     * \return ring size in bytes
+     */
+    uint32_t GetMaxBufferSize() const;
+
+    /**
+     * \brief Get the stream offset of the next byte Read() returns
+     * \return offset
+     */
+    uint64_t NextOffset() const;
+
+    /**
+     * \brief Get the number of bytes Read() can return
+     * \return contiguous bytes at the front
+     */
+    uint32_t Available() const;
+
+    /**
+     * \brief Get the stream offset up to which Write() keeps bytes
+     * \return NextOffset() plus the ring size
+     */
+    uint64_t GetLimit() const;
+
+    /**
+     * \brief Place decoded bytes at their stream offset, bytes that were
+     *        already read or written are ignored, bytes at or beyond
+     *        GetLimit() are dropped
+     * \param offset stream offset of data[0]
+     * \param data decoded bytes
+     * \param len number of bytes
+     * \return the number of bytes dropped for lack of room
+     */
+    uint32_t Write(uint64_t offset, const uint8_t* data, uint32_t len);
+
+    /**
+     * \brief Take contiguous bytes from the front
+     * \param maxBytes largest number of bytes to take
+     * \return a packet of min(maxBytes, Available()) bytes, nullptr if
+     *         nothing is available
+     */
+    Ptr<Packet> Read(uint32_t maxBytes);
+
+  private:
+    /**
+     * \brief Copy bytes that fall within the ring into it and record them
+     * \param offset stream offset of data[0], at least m_nextOffset
+     * \param data bytes
+     * \param len number of bytes, ending within the ring
+     */
+    void Place(uint64_t offset, const uint8_t* data, uint32_t len);
+
+    uint32_t m_maxSize;                      //!< size of the ring once (re)allocated
+    std::vector<uint8_t> m_ring;             //!< storage, allocated on the first write
+    uint32_t m_head;                         //!< ring position of m_nextOffset
+    uint64_t m_nextOffset;                   //!< stream offset of the next byte to read
+    std::map<uint64_t, uint64_t> m_filled;   //!< start -> end of the ranges held in m_ring
+};
+
+} // namespace ns3
+
+#endif /* HELIX_RX_BUFFER_H */
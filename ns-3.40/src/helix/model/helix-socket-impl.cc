@@ -3,13 +3,26 @@
  */
 
 #include "helix-socket-impl.h"
+#include "helix-header.h"
 #include "helix-rs-interface.h"
 
 #include "ns3/udp-socket.h"
 #include "ns3/udp-socket-factory.h"
+#include "ns3/inet-socket-address.h"
+#include "ns3/inet6-socket-address.h"
+#include "ns3/ipv4-end-point.h"
+#include "ns3/ipv4-route.h"
+#include "ns3/ipv4-routing-protocol.h"
+#include "ns3/ipv6-end-point.h"
+#include "ns3/ipv6-route.h"
+#include "ns3/ipv6-routing-protocol.h"
 #include "ns3/node.h"
+#include "ns3/pointer.h"
+#include "ns3/simulator.h"
+#include "ns3/trace-source-accessor.h"
 #include "ns3/ptr.h"
 #include "ns3/callback.h"
+#include <algorithm>
 #include <limits>
 
 
@@ -22,6 +35,9 @@ NS_LOG_COMPONENT_DEFINE("HelixSocketImpl");
 
 NS_OBJECT_ENSURE_REGISTERED(HelixSocketImpl);
 
+/// Largest payload a native frame can carry: 65535 minus the IPv4 and HELIX headers
+static const uint32_t MAX_NATIVE_DATAGRAM_SIZE = 65535 - 20 - HelixHeader::SERIALIZED_SIZE;
+
 // Add attributes generic to all UdpSockets to base class UdpSocket
 TypeId
 HelixSocketImpl::GetTypeId()
@@ -29,7 +45,61 @@ HelixSocketImpl::GetTypeId()
     static TypeId tid = TypeId("ns3::HelixSocketImpl")
                                                 .SetParent<HelixSocket>()
                                                 .SetGroupName("Internet")
-                                                .AddConstructor<HelixSocketImpl>();
+                                                .AddConstructor<HelixSocketImpl>()
+                                                .AddAttribute("RedundancyController",
+                                                              "Adapts RepairOverhead to the loss the peer reports",
+                                                              TypeId::ATTR_GET,
+                                                              PointerValue(),
+                                                              MakePointerAccessor(&HelixSocketImpl::GetRedundancyController),
+                                                              MakePointerChecker<HelixRedundancyController>())
+                                                .AddAttribute("CongestionOps",
+                                                              "Congestion control algorithm of this socket, chosen by HelixL4Protocol::CongestionOps",
+                                                              TypeId::ATTR_GET,
+                                                              PointerValue(),
+                                                              MakePointerAccessor(&HelixSocketImpl::GetCongestionControlAlgorithm),
+                                                              MakePointerChecker<HelixCongestionOps>())
+                                                .AddAttribute("RsInterface",
+                                                              "The helix-rs connection of this socket, null until it binds or connects and after it closes",
+                                                              TypeId::ATTR_GET,
+                                                              PointerValue(),
+                                                              MakePointerAccessor(&HelixSocketImpl::GetRsInterface),
+                                                              MakePointerChecker<HelixRsInterface>())
+                                                .AddTraceSource("CongestionWindow",
+                                                                "Bytes of coded frames allowed in flight",
+                                                                MakeTraceSourceAccessor(&HelixSocketImpl::m_cWnd),
+                                                                "ns3::TracedValueCallback::Uint32")
+                                                .AddTraceSource("PacingRate",
+                                                                "Rate at which coded frames are paced, 0 if unpaced",
+                                                                MakeTraceSourceAccessor(&HelixSocketImpl::m_pacingRate),
+                                                                "ns3::TracedValueCallback::DataRate")
+                                                .AddTraceSource("RTT",
+                                                                "Smoothed round trip time of the peer's acks",
+                                                                MakeTraceSourceAccessor(&HelixSocketImpl::m_srtt),
+                                                                "ns3::TracedValueCallback::Time")
+                                                .AddTraceSource("RepairRatio",
+                                                                "Repair symbols sent per source symbol",
+                                                                MakeTraceSourceAccessor(&HelixSocketImpl::m_repairRatio),
+                                                                "ns3::TracedValueCallback::Double")
+                                                .AddTraceSource("TxBufferSize",
+                                                                "Bytes the application wrote that wait to be encoded",
+                                                                MakeTraceSourceAccessor(&HelixSocketImpl::m_txBufferSize),
+                                                                "ns3::TracedValueCallback::Uint32")
+                                                .AddTraceSource("RxBufferSize",
+                                                                "Decoded bytes the application can read",
+                                                                MakeTraceSourceAccessor(&HelixSocketImpl::m_rxBufferSize),
+                                                                "ns3::TracedValueCallback::Uint32")
+                                                .AddTraceSource("Tx",
+                                                                "Coded frame sent, source or repair symbols and feedback",
+                                                                MakeTraceSourceAccessor(&HelixSocketImpl::m_txTrace),
+                                                                "ns3::HelixSocketImpl::HelixTxRxTracedCallback")
+                                                .AddTraceSource("Rx",
+                                                                "Coded frame received, before it is decoded",
+                                                                MakeTraceSourceAccessor(&HelixSocketImpl::m_rxTrace),
+                                                                "ns3::HelixSocketImpl::HelixTxRxTracedCallback")
+                                                .AddTraceSource("DecodeLatency",
+                                                                "Time from the first symbol of a generation to its decoding",
+                                                                MakeTraceSourceAccessor(&HelixSocketImpl::m_decodeLatencyTrace),
+                                                                "ns3::Time::TracedCallback");
     return tid;
 }
 
@@ -37,21 +107,60 @@ HelixSocketImpl::HelixSocketImpl()
     : m_node(nullptr),
       m_udp_socket(nullptr),
       m_helix(nullptr),
-      m_helix_rs_interface(nullptr)
+      m_native(true),
+      m_helix_rs_interface(nullptr),
+      m_codingConfig(helix_rs_default_coding_config()),
+      m_decodeStats{},
+      m_rcvLowat(1),
+      m_notifyDelay(Time(0)),
+      m_endPoint(nullptr),
+      m_endPoint6(nullptr),
+      m_socketHandle(0),
+      m_pacing(true),
+      m_pacingBurst(4),
+      m_txWaiting(false),
+      m_closing(false),
+      m_generationTimeout(MilliSeconds(10)),
+      m_interleaveDepth(1),
+      m_errno(ERROR_NOTERROR),
+      m_connected(false),
+      m_shutdownSend(false),
+      m_shutdownRecv(false),
+      m_allowBroadcast(false),
+      m_srtt(Time(0)),
+      m_txBufferSize(0),
+      m_rxBufferSize(0)
 {
     NS_LOG_FUNCTION(this);
-    m_helix_rs_interface = CreateObject<HelixRsInterface>(); // TODO: Use attribute system instead
+    m_redundancy = CreateObject<HelixRedundancyController>();
+    m_txBuffer = CreateObject<HelixTxBuffer>();
+    m_rxBuffer = CreateObject<HelixRxBuffer>();
+    m_repairRatio = m_codingConfig.repair_overhead;
+    SetCongestionControlAlgorithm(CreateObject<HelixNewReno>());
 }
 
 HelixSocketImpl::~HelixSocketImpl()
 {
     NS_LOG_FUNCTION(this);
 
+    m_flushEvent.Cancel();
+    m_repairEvent.Cancel();
+    m_closeEvent.Cancel();
+    m_paceEvent.Cancel();
+    m_notifyEvent.Cancel();
+    m_tailEvent.Cancel();
+
     // if (m_helix_rs_interface) {
     //     m_helix_rs_interface->~HelixRsInterface();
     // }
     m_helix_rs_interface = nullptr;
 
+    // native mode endpoints point back at us, make sure they are gone
+    if (m_helix)
+    {
+        DeallocateEndPoint();
+    }
+
     // if (m_udp_socket != nullptr) {
     //     delete m_udp_socket;
     //     m_udp_socket = nullptr;
@@ -73,6 +182,11 @@ HelixSocketImpl::SetHelix(Ptr<HelixL4Protocol> helix)
 {
     NS_LOG_FUNCTION(this << helix);
     m_helix = helix;
+    m_native = !helix || helix->IsNativeMode();
+    if (m_helix_rs_interface)
+    {
+        m_helix_rs_interface->SetStagingArea(helix ? helix->GetStagingArea() : nullptr);
+    }
 }
 
 void
@@ -80,26 +194,140 @@ HelixSocketImpl::SetUdpSocket(Ptr<Socket> udp_socket)
 {
     NS_LOG_FUNCTION(this << udp_socket);
     m_udp_socket = udp_socket;
+
+    // acks arrive on the udp socket too, so it is always read, whether or
+    // not the application registered a recv callback
+    if (m_udp_socket)
+    {
+        m_udp_socket->SetRecvCallback(MakeCallback(&HelixSocketImpl::HandleRecv, this));
+    }
+}
+
+void
+HelixSocketImpl::SetSocketHandle(uint64_t handle)
+{
+    NS_LOG_FUNCTION(this << handle);
+    m_socketHandle = handle;
+}
+
+void
+HelixSocketImpl::SetCongestionControlAlgorithm(Ptr<HelixCongestionOps> algo)
+{
+    NS_LOG_FUNCTION(this << algo);
+    m_congestion = algo;
+    m_congestion->SetSegmentSize(m_codingConfig.symbol_size + FRAME_HEADER_SIZE);
+    m_cWnd = m_congestion->GetCwnd();
+    m_pacingRate = m_congestion->GetPacingRate();
+}
+
+Ptr<HelixCongestionOps>
+HelixSocketImpl::GetCongestionControlAlgorithm() const
+{
+    return m_congestion;
+}
+
+Ptr<HelixRedundancyController>
+HelixSocketImpl::GetRedundancyController() const
+{
+    return m_redundancy;
+}
+
+Ptr<HelixRsInterface>
+HelixSocketImpl::GetRsInterface() const
+{
+    return m_helix_rs_interface;
+}
+
+FFIDecodeStats
+HelixSocketImpl::GetDecodeStats() const
+{
+    if (!m_helix_rs_interface)
+    {
+        // not bound yet, or closed and the stats kept by FinishClose()
+        return m_decodeStats;
+    }
+    return m_helix_rs_interface->GetDecodeStats();
+}
+
+bool
+HelixSocketImpl::Activate()
+{
+    NS_LOG_FUNCTION(this);
+
+    if (m_helix_rs_interface)
+    {
+        return true;
+    }
+    if (m_closing)
+    {
+        m_errno = ERROR_BADF;
+        return false;
+    }
+
+    m_helix_rs_interface = CreateObject<HelixRsInterface>();
+    m_helix_rs_interface->SetCodingConfig(m_codingConfig);
+    m_codingConfig = m_helix_rs_interface->GetCodingConfig();
+    if (m_helix)
+    {
+        m_helix_rs_interface->SetStagingArea(m_helix->GetStagingArea());
+    }
+
+    // native sockets talk to the protocol directly instead
+    if (!m_native && !m_udp_socket)
+    {
+        SetUdpSocket(m_node->GetObject<UdpSocketFactory>()->CreateSocket());
+        m_udp_socket->SetAllowBroadcast(m_allowBroadcast);
+    }
+    return true;
+}
+
+void
+HelixSocketImpl::ApplyCodingConfig(const HelixCodingConfig& config)
+{
+    NS_LOG_FUNCTION(this);
+
+    if (!m_helix_rs_interface)
+    {
+        // checked by helix-rs once Activate() creates the connection
+        m_codingConfig = config;
+        return;
+    }
+    // helix-rs keeps the previous config if it rejects this one
+    m_helix_rs_interface->SetCodingConfig(config);
+    m_codingConfig = m_helix_rs_interface->GetCodingConfig();
+}
+
+int
+HelixSocketImpl::UdpResult(int result) const
+{
+    if (result < 0)
+    {
+        m_errno = m_udp_socket->GetErrno();
+    }
+    return result;
 }
 
 Socket::SocketErrno
 HelixSocketImpl::GetErrno() const
 {
     NS_LOG_FUNCTION(this);
-    return m_udp_socket->GetErrno();
+    // errors of the inner udp socket were copied by UdpResult(), the
+    // socket may be gone since
+    return m_errno;
 }
 
 Socket::SocketType
 HelixSocketImpl::GetSocketType() const
 {
-    return m_udp_socket->GetSocketType();
+    // the application reads a byte stream whatever carries the frames
+    return NS3_SOCK_STREAM;
 }
 
 Ptr<Node>
 HelixSocketImpl::GetNode() const
 {
     NS_LOG_FUNCTION(this);
-    return m_udp_socket->GetNode();
+    return m_node;
 }
 
 void 
@@ -107,19 +335,225 @@ HelixSocketImpl::SetRecvCallback(Callback<void, Ptr<Socket>> receivedData)
 {
     NS_LOG_FUNCTION(this);
     m_handle_recv = receivedData;
+}
+
+/* -------------------- Coding Attributes -------------------- */
+
+void
+HelixSocketImpl::SetGenerationSize(uint32_t size)
+{
+    NS_LOG_FUNCTION(this << size);
+    HelixCodingConfig config = m_codingConfig;
+    config.generation_size = size;
+    ApplyCodingConfig(config);
+}
+
+uint32_t
+HelixSocketImpl::GetGenerationSize() const
+{
+    return m_codingConfig.generation_size;
+}
+
+void
+HelixSocketImpl::SetRepairOverhead(double overhead)
+{
+    NS_LOG_FUNCTION(this << overhead);
+    HelixCodingConfig config = m_codingConfig;
+    config.repair_overhead = overhead;
+    ApplyCodingConfig(config);
+    m_redundancy->SetRepairRatio(overhead);
+    m_repairRatio = overhead;
+}
+
+double
+HelixSocketImpl::GetRepairOverhead() const
+{
+    return m_codingConfig.repair_overhead;
+}
+
+void
+HelixSocketImpl::SetRepairTimeout(Time timeout)
+{
+    NS_LOG_FUNCTION(this << timeout);
+    HelixCodingConfig config = m_codingConfig;
+    config.repair_timeout_ns = static_cast<uint64_t>(timeout.GetNanoSeconds());
+    ApplyCodingConfig(config);
+}
+
+Time
+HelixSocketImpl::GetRepairTimeout() const
+{
+    return NanoSeconds(m_codingConfig.repair_timeout_ns);
+}
+
+void
+HelixSocketImpl::SetMaxRepairRounds(uint32_t rounds)
+{
+    NS_LOG_FUNCTION(this << rounds);
+    HelixCodingConfig config = m_codingConfig;
+    config.max_repair_rounds = rounds;
+    ApplyCodingConfig(config);
+}
+
+uint32_t
+HelixSocketImpl::GetMaxRepairRounds() const
+{
+    return m_codingConfig.max_repair_rounds;
+}
+
+void
+HelixSocketImpl::SetDecoder(DecoderType_t decoder)
+{
+    NS_LOG_FUNCTION(this << decoder);
+    HelixCodingConfig config = m_codingConfig;
+    config.decoder = decoder;
+    ApplyCodingConfig(config);
+}
+
+HelixSocket::DecoderType_t
+HelixSocketImpl::GetDecoder() const
+{
+    return static_cast<DecoderType_t>(m_codingConfig.decoder);
+}
+
+void
+HelixSocketImpl::SetGenerationTimeout(Time timeout)
+{
+    NS_LOG_FUNCTION(this << timeout);
+    m_generationTimeout = timeout;
+}
 
-    // tie udp recv callback to trigger a helix function instead
-    m_udp_socket->SetRecvCallback(MakeCallback(&HelixSocketImpl::HandleRecv, this));
+Time
+HelixSocketImpl::GetGenerationTimeout() const
+{
+    return m_generationTimeout;
+}
+
+void
+HelixSocketImpl::SetInterleaveDepth(uint32_t depth)
+{
+    NS_LOG_FUNCTION(this << depth);
+    m_interleaveDepth = depth;
+    if (depth == 0)
+    {
+        // adaptive, UpdateRedundancy() sets the depth once loss is reported
+        return;
+    }
+    HelixCodingConfig config = m_codingConfig;
+    config.interleave_depth = depth;
+    ApplyCodingConfig(config);
+    m_redundancy->SetInterleaveDepth(depth);
+}
+
+uint32_t
+HelixSocketImpl::GetInterleaveDepth() const
+{
+    return m_interleaveDepth;
 }
 
+void
+HelixSocketImpl::SetFeedbackInterval(Time interval)
+{
+    NS_LOG_FUNCTION(this << interval);
+    HelixCodingConfig config = m_codingConfig;
+    config.feedback_interval_ns = static_cast<uint64_t>(interval.GetNanoSeconds());
+    ApplyCodingConfig(config);
+}
+
+Time
+HelixSocketImpl::GetFeedbackInterval() const
+{
+    return NanoSeconds(m_codingConfig.feedback_interval_ns);
+}
+
+void
+HelixSocketImpl::SetSndBufSize(uint32_t size)
+{
+    NS_LOG_FUNCTION(this << size);
+    m_txBuffer->SetMaxBufferSize(size);
+}
+
+uint32_t
+HelixSocketImpl::GetSndBufSize() const
+{
+    return m_txBuffer->GetMaxBufferSize();
+}
+
+void
+HelixSocketImpl::SetRcvBufSize(uint32_t size)
+{
+    NS_LOG_FUNCTION(this << size);
+    m_rxBuffer->SetMaxBufferSize(size);
+}
+
+uint32_t
+HelixSocketImpl::GetRcvBufSize() const
+{
+    return m_rxBuffer->GetMaxBufferSize();
+}
+
+void
+HelixSocketImpl::SetPacing(bool pacing)
+{
+    NS_LOG_FUNCTION(this << pacing);
+    m_pacing = pacing;
+}
+
+bool
+HelixSocketImpl::GetPacing() const
+{
+    return m_pacing;
+}
+
+void
+HelixSocketImpl::SetPacingBurst(uint32_t frames)
+{
+    NS_LOG_FUNCTION(this << frames);
+    m_pacingBurst = frames;
+}
+
+uint32_t
+HelixSocketImpl::GetPacingBurst() const
+{
+    return m_pacingBurst;
+}
+
+void
+HelixSocketImpl::SetRcvLowat(uint32_t bytes)
+{
+    NS_LOG_FUNCTION(this << bytes);
+    m_rcvLowat = bytes;
+}
+
+uint32_t
+HelixSocketImpl::GetRcvLowat() const
+{
+    return m_rcvLowat;
+}
+
+void
+HelixSocketImpl::SetNotifyDelay(Time delay)
+{
+    NS_LOG_FUNCTION(this << delay);
+    m_notifyDelay = delay;
+}
+
+Time
+HelixSocketImpl::GetNotifyDelay() const
+{
+    return m_notifyDelay;
+}
+
+/* -------------------- Callbacks -------------------- */
+
 void
 HelixSocketImpl::SetSendCallback(Callback<void, Ptr<Socket>, uint32_t> sendCb)
 {
     NS_LOG_FUNCTION(this);
-    m_handle_send = sendCb;
 
-    // tie udp send callback to trigger a helix function instead
-    m_udp_socket->SetSendCallback(MakeCallback(&HelixSocketImpl::HandleSend, this));
+    // fired from TransmitPending() as m_txBuffer drains, the udp socket's
+    // buffer never fills since frames only go out as the window allows
+    m_handle_send = sendCb;
 }
 
 void
@@ -127,21 +561,549 @@ HelixSocketImpl::HandleRecv(Ptr<Socket> socket)
 {
     NS_LOG_FUNCTION(this);
 
-    // pass a reference to this socket instead of udp socket
-    // this is because these functions will invoke udp functions
-    // in a 1-to-1 mapping
+    // drain everything udp has queued so the trip into rust is paid once
+    Ptr<Packet> p;
+    Address from;
+    while ((p = m_udp_socket->RecvFrom(from)))
+    {
+        m_rxBatch.push_back(p);
+        m_rxBatchFrom.push_back(from);
+    }
+    ProcessRxBatch();
+}
+
+void
+HelixSocketImpl::ProcessRxBatch()
+{
+    NS_LOG_FUNCTION(this << m_rxBatch.size());
+
+    if (m_rxBatch.empty())
+    {
+        return;
+    }
+
+    // the socket is one helix-rs connection with one peer: a listening
+    // socket takes the first one to send, frames from any other are dropped
+    if (m_peer.IsInvalid())
+    {
+        m_peer = m_rxBatchFrom.front();
+    }
+    std::size_t kept = 0;
+    for (std::size_t i = 0; i < m_rxBatch.size(); i++)
+    {
+        if (m_rxBatchFrom[i] != m_peer)
+        {
+            NS_LOG_LOGIC("Dropped a frame from " << m_rxBatchFrom[i] << ", the peer is "
+                                                 << m_peer);
+            continue;
+        }
+        m_rxTrace(m_rxBatch[i], this);
+        m_rxBatch[kept++] = m_rxBatch[i];
+    }
+    m_rxBatch.resize(kept);
+    m_rxBatchFrom.clear();
+    if (m_rxBatch.empty())
+    {
+        return;
+    }
+
+    // the limit goes to the peer with the next feedback, data beyond it
+    // waits in the decoder
+    m_helix_rs_interface->SetRecvLimit(m_shutdownRecv ? UINT64_MAX : m_rxBuffer->GetLimit());
+    m_helix_rs_interface->RecvBatch(m_rxBatch);
+    m_rxBatch.clear();
+
+    // chunks recovered late fill the gap in front of those decoded before
+    uint32_t readable = m_rxBuffer->Available();
+    m_helix_rs_interface->PollRecv(m_shutdownRecv ? nullptr : m_rxBuffer);
+    m_rxBufferSize = m_rxBuffer->Available();
+    TraceDecodeLatency();
+
+    // acks for decoded generations, and acks we received may have
+    // cancelled repair deadlines or reported a new loss rate
+    UpdateRedundancy();
+    UpdateCongestion();
+    TransmitPending();
+    ScheduleRepairTimer();
+
+    // finish a lingering Close() outside of the endpoint's receive path
+    if (m_closing && IsDrained() &&
+        !m_closeEvent.IsRunning())
+    {
+        m_closeEvent = Simulator::ScheduleNow(&HelixSocketImpl::FinishClose, this);
+    }
+
+    // frames that only fed the decoder or carried acks wake nobody up
+    if (m_rxBuffer->Available() > readable)
+    {
+        NotifyRecv();
+    }
+}
+
+void
+HelixSocketImpl::NotifyRecv()
+{
+    NS_LOG_FUNCTION(this);
+
+    if (m_handle_recv.IsNull() || m_rxBuffer->Available() == 0)
+    {
+        return;
+    }
+    // a mark above the buffer size could never be reached
+    uint32_t lowat = std::min(m_rcvLowat, m_rxBuffer->GetMaxBufferSize());
+    m_tailEvent.Cancel();
+    if (m_rxBuffer->Available() < lowat)
+    {
+        m_tailEvent = Simulator::Schedule(GetRepairTimeout(),
+                                          &HelixSocketImpl::HandleNotify,
+                                          this,
+                                          true);
+        return;
+    }
+    if (m_notifyDelay.IsZero())
+    {
+        // pass a reference to this socket instead of udp socket
+        // this is because these functions will invoke udp functions
+        // in a 1-to-1 mapping
+        m_handle_recv(this);
+    }
+    else if (!m_notifyEvent.IsRunning())
+    {
+        m_notifyEvent =
+            Simulator::Schedule(m_notifyDelay, &HelixSocketImpl::HandleNotify, this, false);
+    }
+}
+
+void
+HelixSocketImpl::HandleNotify(bool tail)
+{
+    NS_LOG_FUNCTION(this << tail);
+
+    // the application may have read everything in the meantime
+    if (m_rxBuffer->Available() == 0 || m_handle_recv.IsNull())
+    {
+        return;
+    }
+    if (!tail && m_rxBuffer->Available() < std::min(m_rcvLowat, m_rxBuffer->GetMaxBufferSize()))
+    {
+        // or part of it, what is left waits for the mark or the tail timer
+        NotifyRecv();
+        return;
+    }
+    m_tailEvent.Cancel();
     m_handle_recv(this);
 }
 
 void
-HelixSocketImpl::HandleSend(Ptr<Socket> socket, uint32_t num_bytes)
+HelixSocketImpl::SendFrame(Ptr<Packet> frame)
+{
+    NS_LOG_FUNCTION(this << frame);
+
+    m_txTrace(frame, this);
+    int result;
+    if (m_native)
+    {
+        result = DoSendTo(frame, m_peer);
+    }
+    else if (m_peer.IsInvalid())
+    {
+        result = UdpResult(m_udp_socket->Send(frame, 0));
+    }
+    else
+    {
+        result = UdpResult(m_udp_socket->SendTo(frame, 0, m_peer));
+    }
+
+    // a lost frame is made up for by the next repair round
+    if (result < 0)
+    {
+        NS_LOG_LOGIC("Dropped a frame of " << frame->GetSize() << " bytes, errno " << GetErrno());
+    }
+}
+
+void
+HelixSocketImpl::TransmitPending()
+{
+    NS_LOG_FUNCTION(this);
+
+    // the pacer sends the rest when its timer fires
+    if (m_paceEvent.IsRunning())
+    {
+        return;
+    }
+
+    DataRate rate = m_pacing ? m_congestion->GetPacingRate() : DataRate(0);
+    bool paced = rate.GetBitRate() > 0;
+    uint32_t frames = 0;
+    uint32_t bytes = 0;
+    Ptr<Packet> frame;
+    while (!paced || frames < m_pacingBurst)
+    {
+        frame = m_helix_rs_interface->PollTransmit(m_congestion->GetCwnd());
+        if (!frame)
+        {
+            // refill only once the queue ran dry, not when the window is full
+            if (m_helix_rs_interface->GetQueuedFrames() == 0 && FeedEncoder())
+            {
+                continue;
+            }
+            break;
+        }
+        frames++;
+        bytes += frame->GetSize();
+        SendFrame(frame);
+    }
+
+    m_txBufferSize = m_txBuffer->Size();
+    if (m_txWaiting && m_txBuffer->Available() >= m_txBuffer->GetMaxBufferSize() / 4)
+    {
+        m_txWaiting = false;
+        if (!m_handle_send.IsNull())
+        {
+            m_handle_send(this, GetTxAvailable());
+        }
+    }
+
+    // even a short burst holds the next one back, otherwise every Send()
+    // would go out right away at whatever rate the application writes
+    if (paced && bytes > 0)
+    {
+        m_paceEvent = Simulator::Schedule(rate.CalculateBytesTxTime(bytes),
+                                          &HelixSocketImpl::HandlePace,
+                                          this);
+    }
+}
+
+void
+HelixSocketImpl::HandlePace()
+{
+    NS_LOG_FUNCTION(this);
+    TransmitPending();
+}
+
+void
+HelixSocketImpl::ScheduleFlush()
 {
     NS_LOG_FUNCTION(this);
 
-    // pass a reference to this socket instead of udp socket
-    // this is because these functions will invoke udp functions
-    // in a 1-to-1 mapping
-    m_handle_send(this, num_bytes);
+    if (!m_flushEvent.IsRunning())
+    {
+        m_flushEvent =
+            Simulator::Schedule(m_generationTimeout, &HelixSocketImpl::HandleFlush, this);
+    }
+}
+
+void
+HelixSocketImpl::UpdateCongestion()
+{
+    NS_LOG_FUNCTION(this);
+
+    FFICongestionSample sample = m_helix_rs_interface->GetCongestionSample();
+    if (sample.acked_bytes == 0 && sample.lost_bytes == 0 && sample.repair_rounds == 0)
+    {
+        return;
+    }
+    if (sample.rtt_ns > 0)
+    {
+        Time rtt = NanoSeconds(sample.rtt_ns);
+        Time srtt = m_srtt;
+        m_srtt = srtt.IsZero() ? rtt : srtt + (rtt - srtt) / 8;
+        m_helix_rs_interface->SetRtt(m_srtt);
+    }
+    m_congestion->OnSample(sample, Simulator::Now());
+    m_cWnd = m_congestion->GetCwnd();
+    m_pacingRate = m_congestion->GetPacingRate();
+}
+
+void
+HelixSocketImpl::TraceDecodeLatency()
+{
+    NS_LOG_FUNCTION(this);
+
+    // helix-rs keeps the latencies until they are polled, skip the calls
+    // when nobody listens
+    if (m_decodeLatencyTrace.IsEmpty())
+    {
+        return;
+    }
+    for (Time latency = m_helix_rs_interface->PollDecodeLatency(); latency != Time::Max();
+         latency = m_helix_rs_interface->PollDecodeLatency())
+    {
+        m_decodeLatencyTrace(latency);
+    }
+}
+
+void
+HelixSocketImpl::UpdateRedundancy()
+{
+    NS_LOG_FUNCTION(this);
+
+    bool adaptiveDepth = m_interleaveDepth == 0;
+    if (!m_redundancy->IsEnabled() && !adaptiveDepth)
+    {
+        return;
+    }
+    bool ratioChanged =
+        m_redundancy->OnFeedback(m_helix_rs_interface->GetLossFeedback(), GetGenerationSize());
+
+    HelixCodingConfig config = m_codingConfig;
+    uint32_t depth = adaptiveDepth ? m_redundancy->PickInterleaveDepth() : config.interleave_depth;
+    if (!ratioChanged && depth == config.interleave_depth)
+    {
+        return;
+    }
+    if (ratioChanged)
+    {
+        config.repair_overhead = m_redundancy->GetRepairRatio();
+    }
+    // the ratio of the next report accounts for the bursts being spread
+    config.interleave_depth = depth;
+    m_redundancy->SetInterleaveDepth(depth);
+    ApplyCodingConfig(config);
+    m_repairRatio = config.repair_overhead;
+}
+
+void
+HelixSocketImpl::HandleFlush()
+{
+    NS_LOG_FUNCTION(this);
+
+    m_helix_rs_interface->Flush();
+    TransmitPending();
+    ScheduleRepairTimer();
+}
+
+void
+HelixSocketImpl::ScheduleRepairTimer()
+{
+    NS_LOG_FUNCTION(this);
+
+    m_repairEvent.Cancel();
+    Time deadline = m_helix_rs_interface->GetNextTimeout();
+    if (deadline == Time::Max())
+    {
+        return;
+    }
+    Time delay = Max(deadline - Simulator::Now(), Time(0));
+    m_repairEvent = Simulator::Schedule(delay, &HelixSocketImpl::HandleRepairTimeout, this);
+}
+
+void
+HelixSocketImpl::HandleRepairTimeout()
+{
+    NS_LOG_FUNCTION(this);
+
+    m_helix_rs_interface->OnTimeout();
+    UpdateCongestion();
+    TransmitPending();
+    ScheduleRepairTimer();
+
+    // generations given up on count as done for a lingering Close()
+    if (m_closing && IsDrained())
+    {
+        FinishClose();
+    }
+}
+
+void
+HelixSocketImpl::ForwardUp(Ptr<Packet> packet,
+                           Ipv4Header header,
+                           uint16_t port,
+                           Ptr<Ipv4Interface> incomingInterface)
+{
+    NS_LOG_FUNCTION(this << packet << header << port);
+
+    m_rxBatch.push_back(packet);
+    m_rxBatchFrom.push_back(InetSocketAddress(header.GetSource(), port));
+    ProcessRxBatch();
+}
+
+void
+HelixSocketImpl::ForwardUp6(Ptr<Packet> packet,
+                            Ipv6Header header,
+                            uint16_t port,
+                            Ptr<Ipv6Interface> incomingInterface)
+{
+    NS_LOG_FUNCTION(this << packet << header.GetSource() << port);
+
+    m_rxBatch.push_back(packet);
+    m_rxBatchFrom.push_back(Inet6SocketAddress(header.GetSource(), port));
+    ProcessRxBatch();
+}
+
+void
+HelixSocketImpl::Destroy()
+{
+    NS_LOG_FUNCTION(this);
+    m_endPoint = nullptr;
+}
+
+void
+HelixSocketImpl::Destroy6()
+{
+    NS_LOG_FUNCTION(this);
+    m_endPoint6 = nullptr;
+}
+
+int
+HelixSocketImpl::FinishBind()
+{
+    NS_LOG_FUNCTION(this);
+
+    if (m_endPoint != nullptr)
+    {
+        m_endPoint->SetRxCallback(MakeCallback(&HelixSocketImpl::ForwardUp, this));
+        m_endPoint->SetDestroyCallback(MakeCallback(&HelixSocketImpl::Destroy, this));
+        if (m_boundnetdevice)
+        {
+            m_endPoint->BindToNetDevice(m_boundnetdevice);
+        }
+    }
+    if (m_endPoint6 != nullptr)
+    {
+        m_endPoint6->SetRxCallback(MakeCallback(&HelixSocketImpl::ForwardUp6, this));
+        m_endPoint6->SetDestroyCallback(MakeCallback(&HelixSocketImpl::Destroy6, this));
+        if (m_boundnetdevice)
+        {
+            m_endPoint6->BindToNetDevice(m_boundnetdevice);
+        }
+    }
+    return 0;
+}
+
+void
+HelixSocketImpl::DeallocateEndPoint()
+{
+    NS_LOG_FUNCTION(this);
+
+    if (m_endPoint != nullptr)
+    {
+        m_endPoint->SetDestroyCallback(MakeNullCallback<void>());
+        m_helix->DeAllocate(m_endPoint);
+        m_endPoint = nullptr;
+    }
+    if (m_endPoint6 != nullptr)
+    {
+        m_endPoint6->SetDestroyCallback(MakeNullCallback<void>());
+        m_helix->DeAllocate(m_endPoint6);
+        m_endPoint6 = nullptr;
+    }
+}
+
+int
+HelixSocketImpl::DoSendTo(Ptr<Packet> p, const Address& address)
+{
+    NS_LOG_FUNCTION(this << p << address);
+
+    if (InetSocketAddress::IsMatchingType(address))
+    {
+        if (m_endPoint == nullptr && Bind() == -1)
+        {
+            return -1;
+        }
+        InetSocketAddress transport = InetSocketAddress::ConvertFrom(address);
+        return DoSendTo(p, transport.GetIpv4(), transport.GetPort());
+    }
+    else if (Inet6SocketAddress::IsMatchingType(address))
+    {
+        if (m_endPoint6 == nullptr && Bind6() == -1)
+        {
+            return -1;
+        }
+        Inet6SocketAddress transport = Inet6SocketAddress::ConvertFrom(address);
+        return DoSendTo(p, transport.GetIpv6(), transport.GetPort());
+    }
+
+    m_errno = ERROR_AFNOSUPPORT;
+    return -1;
+}
+
+int
+HelixSocketImpl::DoSendTo(Ptr<Packet> p, Ipv4Address dest, uint16_t port)
+{
+    NS_LOG_FUNCTION(this << p << dest << port);
+
+    if (p->GetSize() > MAX_NATIVE_DATAGRAM_SIZE)
+    {
+        m_errno = ERROR_MSGSIZE;
+        return -1;
+    }
+
+    Ptr<Ipv4> ipv4 = m_node->GetObject<Ipv4>();
+    Ipv4Header header;
+    header.SetDestination(dest);
+    header.SetProtocol(HelixL4Protocol::PROT_NUMBER);
+
+    Socket::SocketErrno errno_ = ERROR_NOROUTETOHOST;
+    Ptr<Ipv4Route> route;
+    if (ipv4->GetRoutingProtocol())
+    {
+        route = ipv4->GetRoutingProtocol()->RouteOutput(p, header, m_boundnetdevice, errno_);
+    }
+    else
+    {
+        NS_LOG_ERROR("No IPV4 Routing Protocol");
+    }
+    if (!route)
+    {
+        NS_LOG_LOGIC("No route to destination");
+        m_errno = errno_;
+        return -1;
+    }
+
+    Ipv4Address saddr = m_endPoint->GetLocalAddress();
+    if (saddr == Ipv4Address::GetAny())
+    {
+        saddr = route->GetSource();
+    }
+
+    uint32_t size = p->GetSize();
+    m_helix->Send(p, saddr, dest, m_endPoint->GetLocalPort(), port, route);
+    return size;
+}
+
+int
+HelixSocketImpl::DoSendTo(Ptr<Packet> p, Ipv6Address dest, uint16_t port)
+{
+    NS_LOG_FUNCTION(this << p << dest << port);
+
+    if (p->GetSize() > MAX_NATIVE_DATAGRAM_SIZE)
+    {
+        m_errno = ERROR_MSGSIZE;
+        return -1;
+    }
+
+    Ptr<Ipv6> ipv6 = m_node->GetObject<Ipv6>();
+    Ipv6Header header;
+    header.SetDestination(dest);
+    header.SetNextHeader(HelixL4Protocol::PROT_NUMBER);
+
+    Socket::SocketErrno errno_ = ERROR_NOROUTETOHOST;
+    Ptr<Ipv6Route> route;
+    if (ipv6->GetRoutingProtocol())
+    {
+        route = ipv6->GetRoutingProtocol()->RouteOutput(p, header, m_boundnetdevice, errno_);
+    }
+    else
+    {
+        NS_LOG_ERROR("No IPV6 Routing Protocol");
+    }
+    if (!route)
+    {
+        NS_LOG_LOGIC("No route to destination");
+        m_errno = errno_;
+        return -1;
+    }
+
+    Ipv6Address saddr = m_endPoint6->GetLocalAddress();
+    if (saddr == Ipv6Address::GetAny())
+    {
+        saddr = route->GetSource();
+    }
+
+    uint32_t size = p->GetSize();
+    m_helix->Send(p, saddr, dest, m_endPoint6->GetLocalPort(), port, route);
+    return size;
 }
 
 void
@@ -149,10 +1111,29 @@ HelixSocketImpl::BindToNetDevice(Ptr<NetDevice> netdevice)
 {
     NS_LOG_FUNCTION(netdevice);
 
+    if (!Activate())
+    {
+        return;
+    }
+
     // const Address& address = netdevice->GetAddress();
     Address address = Address();
     m_helix_rs_interface->Bind(address);
 
+    if (m_native)
+    {
+        Socket::BindToNetDevice(netdevice);
+        if (m_endPoint != nullptr)
+        {
+            m_endPoint->BindToNetDevice(netdevice);
+        }
+        if (m_endPoint6 != nullptr)
+        {
+            m_endPoint6->BindToNetDevice(netdevice);
+        }
+        return;
+    }
+
     m_udp_socket->BindToNetDevice(netdevice);
 }
 
@@ -161,12 +1142,28 @@ HelixSocketImpl::Bind()
 {
     NS_LOG_FUNCTION(this);
 
+    if (!Activate())
+    {
+        return -1;
+    }
+
     // TODO: rust will make a callback to bind
     // TODO: provide address
     Address address = Address();
     m_helix_rs_interface->Bind(address);
 
-    return m_udp_socket->Bind();
+    if (m_native)
+    {
+        m_endPoint = m_helix->Allocate();
+        if (m_endPoint == nullptr)
+        {
+            m_errno = ERROR_ADDRNOTAVAIL;
+            return -1;
+        }
+        return FinishBind();
+    }
+
+    return UdpResult(m_udp_socket->Bind());
 }
 
 int
@@ -174,12 +1171,28 @@ HelixSocketImpl::Bind6()
 {
     NS_LOG_FUNCTION(this);
 
+    if (!Activate())
+    {
+        return -1;
+    }
+
     // TODO: rust will make a callback to bind
     // TODO: provide address
     Address address = Address();
     m_helix_rs_interface->Bind(address);
 
-    return m_udp_socket->Bind6();
+    if (m_native)
+    {
+        m_endPoint6 = m_helix->Allocate6();
+        if (m_endPoint6 == nullptr)
+        {
+            m_errno = ERROR_ADDRNOTAVAIL;
+            return -1;
+        }
+        return FinishBind();
+    }
+
+    return UdpResult(m_udp_socket->Bind6());
 }
 
 int
@@ -187,11 +1200,48 @@ HelixSocketImpl::Bind(const Address& address)
 {
     NS_LOG_FUNCTION(this << address);
 
+    if (!Activate())
+    {
+        return -1;
+    }
+
     // TODO: rust will make a callback to bind
-    Address addr = Address();
-    m_helix_rs_interface->Bind(addr);
+    m_helix_rs_interface->Bind(address);
 
-    return m_udp_socket->Bind(address);
+    if (m_native)
+    {
+        if (InetSocketAddress::IsMatchingType(address))
+        {
+            NS_ASSERT_MSG(m_endPoint == nullptr, "Endpoint already allocated.");
+            InetSocketAddress transport = InetSocketAddress::ConvertFrom(address);
+            m_endPoint = m_helix->Allocate(m_boundnetdevice, transport.GetIpv4(), transport.GetPort());
+            if (m_endPoint == nullptr)
+            {
+                m_errno = transport.GetPort() ? ERROR_ADDRINUSE : ERROR_ADDRNOTAVAIL;
+                return -1;
+            }
+        }
+        else if (Inet6SocketAddress::IsMatchingType(address))
+        {
+            NS_ASSERT_MSG(m_endPoint6 == nullptr, "Endpoint already allocated.");
+            Inet6SocketAddress transport = Inet6SocketAddress::ConvertFrom(address);
+            m_endPoint6 =
+                m_helix->Allocate6(m_boundnetdevice, transport.GetIpv6(), transport.GetPort());
+            if (m_endPoint6 == nullptr)
+            {
+                m_errno = transport.GetPort() ? ERROR_ADDRINUSE : ERROR_ADDRNOTAVAIL;
+                return -1;
+            }
+        }
+        else
+        {
+            m_errno = ERROR_INVAL;
+            return -1;
+        }
+        return FinishBind();
+    }
+
+    return UdpResult(m_udp_socket->Bind(address));
 }
 
 int
@@ -199,21 +1249,77 @@ HelixSocketImpl::Connect(const Address& address)
 {
     NS_LOG_FUNCTION(this << address);
 
+    if (!Activate())
+    {
+        return -1;
+    }
 
     // TODO: rust will make a callback to connect
-    Address addr = Address();
-    m_helix_rs_interface->Connect(addr);
-
-    return m_udp_socket->Connect(address);
+    m_helix_rs_interface->Connect(address);
+
+    if (m_native)
+    {
+        if (InetSocketAddress::IsMatchingType(address))
+        {
+            if (m_endPoint == nullptr && Bind() == -1)
+            {
+                return -1;
+            }
+            InetSocketAddress transport = InetSocketAddress::ConvertFrom(address);
+            if (!m_helix->SetPeer(m_endPoint, transport.GetIpv4(), transport.GetPort()))
+            {
+                m_errno = ERROR_ADDRINUSE;
+                return -1;
+            }
+        }
+        else if (Inet6SocketAddress::IsMatchingType(address))
+        {
+            if (m_endPoint6 == nullptr && Bind6() == -1)
+            {
+                return -1;
+            }
+            Inet6SocketAddress transport = Inet6SocketAddress::ConvertFrom(address);
+            if (!m_helix->SetPeer(m_endPoint6, transport.GetIpv6(), transport.GetPort()))
+            {
+                m_errno = ERROR_ADDRINUSE;
+                return -1;
+            }
+        }
+        else
+        {
+            m_errno = ERROR_INVAL;
+            return -1;
+        }
+        m_defaultAddress = address;
+        m_peer = address;
+        m_connected = true;
+        NotifyConnectionSucceeded();
+        return 0;
+    }
+
+    m_peer = address;
+    return UdpResult(m_udp_socket->Connect(address));
 }
 
 int
 HelixSocketImpl::Listen()
 {
+    NS_LOG_FUNCTION(this);
+
+    if (!Activate())
+    {
+        return -1;
+    }
+
     // TODO: rust will make a callback to listen
     m_helix_rs_interface->Listen();
 
-    return m_udp_socket->Listen();
+    if (m_native)
+    {
+        return 0;
+    }
+
+    return UdpResult(m_udp_socket->Listen());
 }
 
 int
@@ -221,11 +1327,29 @@ HelixSocketImpl::Send(Ptr<Packet> p, uint32_t flags)
 {
     NS_LOG_FUNCTION(this << p << flags);
 
-    // TODO: Add logic for adding flags
-    // TODO: remove m_udp_socket->Send(p, flags), because this will be called by rust
-    m_helix_rs_interface->Send(p);
-
-    return m_udp_socket->Send(p, flags);
+    if (m_native)
+    {
+        if (!m_connected)
+        {
+            m_errno = ERROR_NOTCONN;
+            return -1;
+        }
+        return SendTo(p, flags, m_defaultAddress);
+    }
+
+    if (m_closing || m_shutdownSend)
+    {
+        m_errno = ERROR_SHUTDOWN;
+        return -1;
+    }
+    // the inner udp socket only exists once the socket was bound or
+    // connected
+    if (!m_udp_socket)
+    {
+        m_errno = ERROR_NOTCONN;
+        return -1;
+    }
+    return Encode(p);
 }
 
 
@@ -234,14 +1358,100 @@ HelixSocketImpl::SendTo(Ptr<Packet> p, uint32_t flags, const Address& address)
 {
     NS_LOG_FUNCTION(this << p << flags << address);
 
+    if (m_closing || m_shutdownSend)
+    {
+        m_errno = ERROR_SHUTDOWN;
+        return -1;
+    }
+    if (!Activate())
+    {
+        return -1;
+    }
+
+    // native frames are only sent once the data is encoded, so bind now
+    // to report address errors to the caller
+    if (m_native)
+    {
+        if (InetSocketAddress::IsMatchingType(address))
+        {
+            if (m_endPoint == nullptr && Bind() == -1)
+            {
+                return -1;
+            }
+        }
+        else if (Inet6SocketAddress::IsMatchingType(address))
+        {
+            if (m_endPoint6 == nullptr && Bind6() == -1)
+            {
+                return -1;
+            }
+        }
+        else
+        {
+            m_errno = ERROR_AFNOSUPPORT;
+            return -1;
+        }
+    }
+
+    m_peer = address;
+    return Encode(p);
+}
+
+int
+HelixSocketImpl::Encode(Ptr<Packet> p)
+{
+    NS_LOG_FUNCTION(this << p);
+
+    // the application is writing, it checks GetTxAvailable() itself
+    // and must not be called back from within Send()
+    m_txWaiting = false;
+    uint32_t size = p->GetSize();
+    if (!m_txBuffer->Add(p))
+    {
+        m_errno = ERROR_MSGSIZE;
+        m_txWaiting = true;
+        return -1;
+    }
+    TransmitPending();
+    m_txWaiting = m_txBuffer->Available() < m_txBuffer->GetMaxBufferSize() / 4;
+    return size;
+}
 
-    // TODO: Add logic for adding address
-    // TODO: Add logic for adding flags
-    // TODO: remove m_udp_socket->Send(p, flags), because this will be called by rust
+bool
+HelixSocketImpl::FeedEncoder()
+{
+    NS_LOG_FUNCTION(this);
+
+    // whole source symbols, the generation is closed and its repair
+    // symbols sent once it is full or GenerationTimeout passed
+    uint32_t payload = m_codingConfig.symbol_size - SOURCE_PREFIX_SIZE;
+    if (m_txBuffer->Size() == 0)
+    {
+        return false;
+    }
+
+    // nothing beyond the receive limit of the peer, the generation that
+    // reached it is closed so its repair symbols need not wait
+    uint64_t room = m_helix_rs_interface->GetSendRoom();
+    if (room < payload && room < m_txBuffer->Size())
+    {
+        m_flushEvent.Cancel();
+        m_helix_rs_interface->Flush();
+        return m_helix_rs_interface->GetQueuedFrames() > 0;
+    }
+    Ptr<Packet> p = m_txBuffer->Remove(static_cast<uint32_t>(std::min<uint64_t>(payload, room)));
+    uint32_t size = p->GetSize();
     m_helix_rs_interface->Send(p);
+    ScheduleFlush();
+    NotifyDataSent(size);
+    return true;
+}
 
-    // TODO: Call Helix rs packet encoder implementation
-    return m_udp_socket->SendTo(p, flags, address);
+bool
+HelixSocketImpl::IsDrained() const
+{
+    return m_txBuffer->Size() == 0 &&
+           (!m_helix_rs_interface || m_helix_rs_interface->GetPendingGenerations() == 0);
 }
 
 Ptr<Packet>
@@ -249,19 +1459,43 @@ HelixSocketImpl::Recv(uint32_t maxSize, uint32_t flags)
 {
     NS_LOG_FUNCTION(this << maxSize << flags);
 
-    Ptr<Packet> p = m_udp_socket->Recv(maxSize, flags);
-    return m_helix_rs_interface->Recv(p);
+    Address fromAddress;
+    return RecvFrom(maxSize, flags, fromAddress);
 }
 
 Ptr<Packet>
 HelixSocketImpl::RecvFrom(uint32_t maxSize, uint32_t flags, Address& fromAddress)
 {
-    NS_LOG_FUNCTION(this << maxSize << flags << fromAddress);
-    
-    // TODO: Add address
-    // TODO: pass received info to m_helix_rs_interface
-    Ptr<Packet> p = m_udp_socket->RecvFrom(maxSize, flags, fromAddress);
-    return m_helix_rs_interface->Recv(p);
+    NS_LOG_FUNCTION(this << maxSize << flags);
+
+    // data was already decoded in batches by HandleRecv, reads take the
+    // in-order bytes at the front of the stream, as many as fit
+    Ptr<Packet> p = m_rxBuffer->Read(maxSize);
+    if (!p)
+    {
+        return nullptr;
+    }
+    fromAddress = m_peer;
+    m_rxBufferSize = m_rxBuffer->Available();
+
+    // the read made room, a window update lets the peer go on and the
+    // chunks held beyond the old limit move into the buffer
+    if (m_helix_rs_interface && !m_shutdownRecv)
+    {
+        uint32_t readable = m_rxBuffer->Available();
+        if (m_helix_rs_interface->SetRecvLimit(m_rxBuffer->GetLimit()))
+        {
+            TransmitPending();
+            ScheduleRepairTimer();
+        }
+        m_helix_rs_interface->PollRecv(m_rxBuffer);
+        m_rxBufferSize = m_rxBuffer->Available();
+        if (m_rxBuffer->Available() > readable && !m_notifyEvent.IsRunning())
+        {
+            m_notifyEvent = Simulator::ScheduleNow(&HelixSocketImpl::HandleNotify, this, false);
+        }
+    }
+    return p;
 }
 
 int
@@ -269,64 +1503,182 @@ HelixSocketImpl::Close()
 {
     NS_LOG_FUNCTION(this);
 
-    // TODO: rust will make a callback to udp close
-    m_helix_rs_interface->Close();
+    if (m_closing)
+    {
+        return 0;
+    }
+    m_closing = true;
+
+    // no more data is waited for, what is readable is announced whatever
+    // the mark
+    if (m_rxBuffer->Available() > 0 && !m_handle_recv.IsNull())
+    {
+        m_tailEvent.Cancel();
+        m_tailEvent = Simulator::ScheduleNow(&HelixSocketImpl::HandleNotify, this, true);
+    }
+    if (!m_helix_rs_interface)
+    {
+        // never bound or connected, nothing to send
+        return FinishClose();
+    }
+
+    // whatever is still open gets its repair symbols now
+    m_flushEvent.Cancel();
+    m_helix_rs_interface->Flush();
+    TransmitPending();
+    ScheduleRepairTimer();
+
+    if (IsDrained())
+    {
+        return FinishClose();
+    }
+    NS_LOG_LOGIC("Lingering until " << m_txBuffer->Size() << " buffered bytes are sent and "
+                                    << m_helix_rs_interface->GetPendingGenerations()
+                                    << " generations are acked");
+    return 0;
+}
+
+int
+HelixSocketImpl::FinishClose()
+{
+    NS_LOG_FUNCTION(this);
 
-    return m_udp_socket->Close();
+    m_flushEvent.Cancel();
+    m_repairEvent.Cancel();
+    m_closeEvent.Cancel();
+    m_paceEvent.Cancel();
+    m_notifyEvent.Cancel();
+
+    // the connection and udp socket are released right away, only the
+    // decode stats are kept for GetDecodeStats()
+    if (m_helix_rs_interface)
+    {
+        // TODO: rust will make a callback to udp close
+        m_decodeStats = m_helix_rs_interface->GetDecodeStats();
+        m_helix_rs_interface->Close();
+        m_helix_rs_interface->Dispose();
+        m_helix_rs_interface = nullptr;
+    }
+
+    int result = 0;
+    m_shutdownRecv = true;
+    m_shutdownSend = true;
+    if (m_native)
+    {
+        DeallocateEndPoint();
+    }
+    else if (m_udp_socket)
+    {
+        result = UdpResult(m_udp_socket->Close());
+        m_udp_socket->SetRecvCallback(MakeNullCallback<void, Ptr<Socket>>());
+        m_udp_socket = nullptr;
+    }
+
+    // the protocol no longer needs to track us
+    if (m_helix)
+    {
+        m_helix->ReleaseSocket(m_socketHandle);
+    }
+    return result;
 }
 
 int
 HelixSocketImpl::ShutdownSend()
 {
     NS_LOG_FUNCTION(this);
-    return m_udp_socket->ShutdownSend();
+    // only application data stops, the udp socket keeps carrying acks
+    // and the repairs of generations already sent
+    m_shutdownSend = true;
+    return 0;
 }
 
 int
 HelixSocketImpl::ShutdownRecv()
 {
     NS_LOG_FUNCTION(this);
-    return m_udp_socket->ShutdownRecv();
+    // frames are still read so acks reach the encoder, decoded data is dropped
+    m_shutdownRecv = true;
+    return 0;
 }
 
 uint32_t
 HelixSocketImpl::GetTxAvailable() const
 {
     NS_LOG_FUNCTION(this);
-    return m_udp_socket->GetTxAvailable();
+    return m_txBuffer->Available();
 }
 
 uint32_t
 HelixSocketImpl::GetRxAvailable() const
 {
     NS_LOG_FUNCTION(this);
-    return m_udp_socket->GetRxAvailable();
+    return m_rxBuffer->Available();
 }
 
 int
 HelixSocketImpl::GetSockName(Address& address) const
 {
     NS_LOG_FUNCTION(this << address);
-    return m_udp_socket->GetSockName(address);
+    if (!m_native && m_udp_socket)
+    {
+        return UdpResult(m_udp_socket->GetSockName(address));
+    }
+
+    // native, or the udp socket does not exist yet or any more
+    if (m_endPoint != nullptr)
+    {
+        address = InetSocketAddress(m_endPoint->GetLocalAddress(), m_endPoint->GetLocalPort());
+    }
+    else if (m_endPoint6 != nullptr)
+    {
+        address = Inet6SocketAddress(m_endPoint6->GetLocalAddress(), m_endPoint6->GetLocalPort());
+    }
+    else
+    {
+        address = InetSocketAddress(Ipv4Address::GetZero(), 0);
+    }
+    return 0;
 }
 
 int
 HelixSocketImpl::GetPeerName(Address& address) const
 {
     NS_LOG_FUNCTION(this << address);
-    return m_udp_socket->GetPeerName(address);
+    if (!m_native && m_udp_socket)
+    {
+        return UdpResult(m_udp_socket->GetPeerName(address));
+    }
+
+    // a udp socket not created yet or closed has no peer either
+    if (!m_native || !m_connected)
+    {
+        m_errno = ERROR_NOTCONN;
+        return -1;
+    }
+    address = m_defaultAddress;
+    return 0;
 }
 
 bool
 HelixSocketImpl::SetAllowBroadcast(bool allowBroadcast)
 {
-    return m_udp_socket->SetAllowBroadcast(allowBroadcast);
+    // kept for the udp socket Activate() creates
+    m_allowBroadcast = allowBroadcast;
+    if (!m_native && m_udp_socket)
+    {
+        return m_udp_socket->SetAllowBroadcast(allowBroadcast);
+    }
+    return true;
 }
 
 bool
 HelixSocketImpl::GetAllowBroadcast() const
 {
-    return m_udp_socket->GetAllowBroadcast();
+    if (!m_native && m_udp_socket)
+    {
+        return m_udp_socket->GetAllowBroadcast();
+    }
+    return m_allowBroadcast;
 }
 
 void
@@ -335,6 +1687,15 @@ HelixSocketImpl::Ipv6JoinGroup(Ipv6Address address,
                              std::vector<Ipv6Address> sourceAddresses)
 {
     NS_LOG_FUNCTION(this << address << &filterMode << &sourceAddresses);
+    if (!Activate())
+    {
+        return;
+    }
+    if (m_native)
+    {
+        NS_LOG_WARN("Multicast groups are not supported by native HELIX sockets");
+        return;
+    }
     m_udp_socket->Ipv6JoinGroup(address, filterMode, sourceAddresses);
 }
 
@@ -23,8 +23,12 @@
 
 
 #include "helix-socket.h"
+#include "helix-congestion-ops.h"
 #include "helix-l4-protocol.h"
+#include "helix-redundancy-controller.h"
 #include "helix-rs-interface.h"
+#include "helix-rx-buffer.h"
+#include "helix-tx-buffer.h"
 
 
 #include "ns3/internet-module.h"
@@ -33,12 +37,14 @@
 #include "ns3/ipv4-interface.h"
 
 #include "ns3/callback.h"
+#include "ns3/event-id.h"
 #include "ns3/ipv4-address.h"
 #include "ns3/ptr.h"
 #include "ns3/socket.h"
 #include "ns3/traced-callback.h"
+#include "ns3/traced-value.h"
 
-#include <queue>
+#include <vector>
 #include <stdint.h>
 
 namespace ns3
@@ -89,6 +95,16 @@ class HelixSocketImpl : public HelixSocket
      * \return the object TypeId
      */
     static TypeId GetTypeId();
+
+    /**
+     * TracedCallback signature for coded frames sent or received.
+     *
+     * \param [in] packet The frame.
+     * \param [in] socket This socket.
+     */
+    typedef void (*HelixTxRxTracedCallback)(const Ptr<const Packet> packet,
+                                            const Ptr<const HelixSocket> socket);
+
     /**
      * Create an unbound Helix socket.
      */
@@ -102,7 +118,10 @@ class HelixSocketImpl : public HelixSocket
     void SetNode(Ptr<Node> node);
     
     /**
-     * \brief Set the associated HELIX L4 protocol.
+     * \brief Set the associated HELIX L4 protocol, whose staging area
+     *        the socket shares with the other sockets of the node.
+     *
+     * The socket keeps the mode the protocol runs in at this point.
      * \param helix the HELIX L4 protocol
      */
     void SetHelix(Ptr<HelixL4Protocol> helix);
@@ -113,6 +132,48 @@ class HelixSocketImpl : public HelixSocket
      */
     void SetUdpSocket(Ptr<Socket> udp_socket);
 
+    /**
+     * \brief Set the handle of this socket in the HelixL4Protocol socket table.
+     * \param handle the handle, released when Close() completes
+     */
+    void SetSocketHandle(uint64_t handle);
+
+    /**
+     * \brief Set the congestion control algorithm of this socket
+     * \param algo the algorithm, sized to frames of the current symbol size
+     */
+    void SetCongestionControlAlgorithm(Ptr<HelixCongestionOps> algo);
+
+    /**
+     * \brief Get the congestion control algorithm of this socket
+     * \return the algorithm
+     */
+    Ptr<HelixCongestionOps> GetCongestionControlAlgorithm() const;
+
+    /**
+     * \brief Get the controller adapting RepairOverhead to reported loss
+     * \return the redundancy controller
+     */
+    Ptr<HelixRedundancyController> GetRedundancyController() const;
+
+    /**
+     * \brief Get the helix-rs connection of this socket
+     * \return the connection, null until the socket binds or connects
+     *         and after it closes
+     */
+    Ptr<HelixRsInterface> GetRsInterface() const;
+
+    /**
+     * \brief Decode latency percentiles of the generations received
+     *        by this socket, see HelixRsInterface::GetDecodeStats()
+     *
+     * Still available once the socket closed and released its helix-rs
+     * connection.
+     *
+     * \return decode statistics
+     */
+    FFIDecodeStats GetDecodeStats() const;
+
     SocketErrno GetErrno() const override;
     SocketType GetSocketType() const override;
     Ptr<Node> GetNode() const override;
@@ -156,30 +217,27 @@ class HelixSocketImpl : public HelixSocket
      * \param sendCb Callback for the event that the socket transmit buffer
      *        fill level has decreased.  This callback is passed a pointer to
      *        the socket, and the number of bytes available for writing
-     *        into the buffer (an absolute value).  If there is no transmit
-     *        buffer limit, a maximum-sized integer is always returned.
-     * 
-     * This functions similarly to SetRecvCallback.
+     *        into the buffer (an absolute value).
+     *
+     * The transmit buffer is m_txBuffer, not the UDP socket's. The
+     * callback only fires after a Send() left less than a quarter of
+     * SndBufSize free, once at least a quarter is free again.
      */
     void SetSendCallback(Callback<void, Ptr<Socket>, uint32_t> sendCb) override;
 
      /**
      * \brief Callback invoked by UDP when it receives data
+     *
+     * Drains everything the UDP socket has queued and hands it to
+     * HELIX in a single batched call, the decoded packets are queued
+     * for Recv()/RecvFrom(). Hooked up by SetUdpSocket(), since acks
+     * must be read even when the application never receives.
      * \param socket the udp socket
      * 
      */
     void HandleRecv(Ptr<Socket> socket);
 
 
-     /**
-     * \brief Callback invoked by UDP when it sends data
-     * \param socket the udp socket
-     * \param num_bytes the number of bytes available for writing
-     *        into the buffer (an absolute value).  If there is no transmit
-     *        buffer limit, a maximum-sized integer is always returned.
-     */
-    void HandleSend(Ptr<Socket> socket, uint32_t num_bytes);
-
     /* -------------------- HELIX Interface -------------------- */
     void BindToNetDevice(Ptr<NetDevice> netdevice) override;
     int Connect(const Address& address) override;
@@ -209,6 +267,263 @@ class HelixSocketImpl : public HelixSocket
 
 
   private:
+    // Coding attributes, kept in m_codingConfig and applied to m_helix_rs_interface
+    void SetGenerationSize(uint32_t size) override;
+    uint32_t GetGenerationSize() const override;
+    void SetRepairOverhead(double overhead) override;
+    double GetRepairOverhead() const override;
+    void SetRepairTimeout(Time timeout) override;
+    Time GetRepairTimeout() const override;
+    void SetMaxRepairRounds(uint32_t rounds) override;
+    uint32_t GetMaxRepairRounds() const override;
+    void SetDecoder(DecoderType_t decoder) override;
+    DecoderType_t GetDecoder() const override;
+    void SetGenerationTimeout(Time timeout) override;
+    Time GetGenerationTimeout() const override;
+    void SetInterleaveDepth(uint32_t depth) override;
+    uint32_t GetInterleaveDepth() const override;
+    void SetFeedbackInterval(Time interval) override;
+    Time GetFeedbackInterval() const override;
+    void SetPacing(bool pacing) override;
+    bool GetPacing() const override;
+    void SetPacingBurst(uint32_t frames) override;
+    uint32_t GetPacingBurst() const override;
+    void SetRcvLowat(uint32_t bytes) override;
+    uint32_t GetRcvLowat() const override;
+    void SetNotifyDelay(Time delay) override;
+    Time GetNotifyDelay() const override;
+    void SetSndBufSize(uint32_t size) override;
+    uint32_t GetSndBufSize() const override;
+    void SetRcvBufSize(uint32_t size) override;
+    uint32_t GetRcvBufSize() const override;
+
+    /**
+     * \brief Create the helix-rs connection and, unless the protocol runs
+     *        in native mode, the inner UDP socket, on the first bind or
+     *        connect. FinishClose() releases both.
+     * \returns false, with m_errno set, if the socket is already closing
+     */
+    bool Activate();
+
+    /**
+     * \brief Keep a coding config and hand it to helix-rs if the
+     *        connection exists
+     * \param config the new coding parameters
+     */
+    void ApplyCodingConfig(const HelixCodingConfig& config);
+
+    /**
+     * \brief Keep the errno of the inner UDP socket if a call on it failed
+     * \param result what the UDP socket returned
+     * \returns result
+     */
+    int UdpResult(int result) const;
+
+    /**
+     * \brief Decode the frames gathered in m_rxBatch in one call, place
+     *        the decoded data in m_rxBuffer and send the acks they
+     *        produced. Frames that do not come from m_peer are dropped.
+     */
+    void ProcessRxBatch();
+
+    /**
+     * \brief Queue application data in m_txBuffer and send what the
+     *        congestion window allows towards m_peer
+     * \param p packet
+     * \returns the number of bytes accepted, -1 if they do not fit
+     */
+    int Encode(Ptr<Packet> p);
+
+    /**
+     * \brief Hand one source symbol worth of m_txBuffer to the encoder
+     *
+     * Data beyond the receive limit of the peer stays in m_txBuffer,
+     * the open generation is closed instead.
+     * \returns false if nothing was handed over and no frame got queued
+     */
+    bool FeedEncoder();
+
+    /**
+     * \brief Whether everything the application sent was acked or
+     *        given up
+     * \returns true if nothing is left to send or repair
+     */
+    bool IsDrained() const;
+
+    /**
+     * \brief Put a coded frame on the wire towards m_peer
+     * \param frame the frame
+     */
+    void SendFrame(Ptr<Packet> frame);
+
+    /**
+     * \brief Send the frames helix-rs has queued for transmission, as many
+     *        as the congestion window allows
+     *
+     * Data is only taken from m_txBuffer once the frames queued before
+     * it are gone, so it waits in the bounded buffer rather than in
+     * helix-rs. When paced, at most m_pacingBurst frames go out and
+     * m_paceEvent holds the next release back for as long as they take
+     * at the pacing rate.
+     */
+    void TransmitPending();
+
+    /**
+     * \brief Pacing timer, releases the next burst
+     */
+    void HandlePace();
+
+    /**
+     * \brief Tell the application data can be read
+     *
+     * Below m_rcvLowat readable bytes only m_tailEvent is armed, the
+     * tail of the stream is announced once nothing new was decoded for
+     * RepairTimeout, since the rest may never come. With a
+     * m_notifyDelay the callback runs from m_notifyEvent, once for
+     * everything decoded until then.
+     */
+    void NotifyRecv();
+
+    /**
+     * \brief Coalescing and tail timer, runs the receive callback
+     * \param tail whether to announce the data even below m_rcvLowat
+     */
+    void HandleNotify(bool tail);
+
+    /**
+     * \brief Close the open generation at most m_generationTimeout after
+     *        its first symbol, if it did not fill up before
+     */
+    void ScheduleFlush();
+
+    /**
+     * \brief Hand the peer's latest loss report to m_redundancy and apply
+     *        the repair ratio it picks, and the interleave depth if
+     *        InterleaveDepth is 0
+     */
+    void UpdateRedundancy();
+
+    /**
+     * \brief Hand the congestion signals of the latest acks and repair
+     *        timeouts to m_congestion and update the traced window, rate
+     *        and round trip time
+     */
+    void UpdateCongestion();
+
+    /**
+     * \brief Report the generations decoded since the last call to the
+     *        DecodeLatency trace
+     */
+    void TraceDecodeLatency();
+
+    /**
+     * \brief Close the open generation and send its first repair round
+     */
+    void HandleFlush();
+
+    /**
+     * \brief (Re)arm m_repairEvent for the earliest repair deadline, or
+     *        the time held back feedback may leave
+     */
+    void ScheduleRepairTimer();
+
+    /**
+     * \brief Send another repair round for generations that were not
+     *        acked in time
+     */
+    void HandleRepairTimeout();
+
+    /**
+     * \brief Tear the socket down once every generation was acked or
+     *        given up, releasing the helix-rs connection and UDP socket
+     * \returns 0 on success, -1 on failure
+     */
+    int FinishClose();
+
+    /**
+     * \brief Called by the L3 protocol when it received a native frame
+     *        for this socket.
+     *
+     * \param packet the incoming packet
+     * \param header the packet's IPv4 header
+     * \param port the remote port
+     * \param incomingInterface the incoming interface
+     */
+    void ForwardUp(Ptr<Packet> packet,
+                   Ipv4Header header,
+                   uint16_t port,
+                   Ptr<Ipv4Interface> incomingInterface);
+
+    /**
+     * \brief Called by the L3 protocol when it received a native frame
+     *        for this socket.
+     *
+     * \param packet the incoming packet
+     * \param header the packet's IPv6 header
+     * \param port the remote port
+     * \param incomingInterface the incoming interface
+     */
+    void ForwardUp6(Ptr<Packet> packet,
+                    Ipv6Header header,
+                    uint16_t port,
+                    Ptr<Ipv6Interface> incomingInterface);
+
+    /**
+     * \brief Kill this socket by zeroing its attributes (IPv4)
+     *
+     * This is a callback function configured to the endpoint in
+     * FinishBind(), invoked when the endpoint is destroyed.
+     */
+    void Destroy();
+
+    /**
+     * \brief Kill this socket by zeroing its attributes (IPv6)
+     *
+     * This is a callback function configured to the endpoint in
+     * FinishBind(), invoked when the endpoint is destroyed.
+     */
+    void Destroy6();
+
+    /**
+     * \brief Finish the binding process of a native socket
+     * \returns 0 on success, -1 on failure
+     */
+    int FinishBind();
+
+    /**
+     * \brief Deallocate m_endPoint and m_endPoint6
+     */
+    void DeallocateEndPoint();
+
+    /**
+     * \brief Send a native frame to a socket address
+     * \param p packet
+     * \param address destination address
+     * \returns -1 in case of error or the number of bytes copied in the
+     *          internal buffer and accepted for transmission.
+     */
+    int DoSendTo(Ptr<Packet> p, const Address& address);
+
+    /**
+     * \brief Send a native frame over IPv4
+     * \param p packet
+     * \param daddr destination address
+     * \param dport destination port
+     * \returns -1 in case of error or the number of bytes copied in the
+     *          internal buffer and accepted for transmission.
+     */
+    int DoSendTo(Ptr<Packet> p, Ipv4Address daddr, uint16_t dport);
+
+    /**
+     * \brief Send a native frame over IPv6
+     * \param p packet
+     * \param daddr destination address
+     * \param dport destination port
+     * \returns -1 in case of error or the number of bytes copied in the
+     *          internal buffer and accepted for transmission.
+     */
+    int DoSendTo(Ptr<Packet> p, Ipv6Address daddr, uint16_t dport);
+
     /**
      * \brief UdpSocketFactory friend class.
      * \relates UdpSocketFactory
@@ -221,11 +536,60 @@ class HelixSocketImpl : public HelixSocket
     Ptr<Node> m_node;                 //!< the associated node
     Ptr<Socket> m_udp_socket;  //!< the associated socket
     Ptr<HelixL4Protocol> m_helix;
-    Ptr<HelixRsInterface> m_helix_rs_interface;
+    bool m_native;                        //!< frames go through m_helix, not m_udp_socket
+    Ptr<HelixRsInterface> m_helix_rs_interface; //!< null until Activate(), and after FinishClose()
+    HelixCodingConfig m_codingConfig;     //!< coding parameters, also while m_helix_rs_interface is null
+    FFIDecodeStats m_decodeStats;         //!< decode stats kept by FinishClose()
 
     Callback<void, Ptr<Socket>> m_handle_recv;
     Callback<void, Ptr<Socket>, uint32_t> m_handle_send;
 
+    std::vector<Ptr<Packet>> m_rxBatch;   //!< reusable batch drained from the UDP socket
+    std::vector<Address> m_rxBatchFrom;   //!< source addresses of m_rxBatch
+    Ptr<HelixRxBuffer> m_rxBuffer;        //!< decoded data waiting to be read
+    uint32_t m_rcvLowat;                  //!< readable bytes m_handle_recv waits for
+    Time m_notifyDelay;                   //!< how long notifications are held back
+    EventId m_notifyEvent;                //!< runs a held back notification
+    EventId m_tailEvent;                  //!< announces the data below m_rcvLowat
+
+    // Native mode state, unused when the socket runs over m_udp_socket
+    Ipv4EndPoint* m_endPoint;             //!< the IPv4 endpoint
+    Ipv6EndPoint* m_endPoint6;            //!< the IPv6 endpoint
+    uint64_t m_socketHandle;              //!< handle in the HelixL4Protocol socket table
+    Address m_defaultAddress;             //!< peer given to Connect()
+
+    // Streaming codec state
+    Address m_peer;                       //!< the only address frames are taken from and sent to
+    EventId m_flushEvent;                 //!< closes the open generation
+    EventId m_repairEvent;                //!< next repair round
+    EventId m_closeEvent;                 //!< finishes a lingering Close()
+    EventId m_paceEvent;                  //!< releases the next paced burst
+    bool m_pacing;                        //!< pace frames at the congestion control's rate
+    uint32_t m_pacingBurst;               //!< frames released per pacing timer
+    Ptr<HelixTxBuffer> m_txBuffer;        //!< application data waiting to be encoded
+    bool m_txWaiting;                     //!< the application wants to hear about free space
+    bool m_closing;                       //!< Close() called, lingering for acks
+    Time m_generationTimeout;             //!< longest a generation stays open
+    uint32_t m_interleaveDepth;           //!< InterleaveDepth, 0 if adaptive
+    Ptr<HelixRedundancyController> m_redundancy; //!< picks the repair ratio
+    Ptr<HelixCongestionOps> m_congestion; //!< bounds the coded frames in flight
+    mutable SocketErrno m_errno;          //!< last error
+    bool m_connected;                     //!< Connection established
+    bool m_shutdownSend;                  //!< Send no longer allowed, in both modes
+    bool m_shutdownRecv;                  //!< Receive no longer allowed, in both modes
+    bool m_allowBroadcast;                //!< Allow send broadcast packets
+
+    // Traces
+    TracedValue<uint32_t> m_cWnd;         //!< congestion window of m_congestion
+    TracedValue<DataRate> m_pacingRate;   //!< pacing rate of m_congestion
+    TracedValue<Time> m_srtt;             //!< smoothed round trip time of the acks
+    TracedValue<double> m_repairRatio;    //!< repair symbols sent per source symbol
+    TracedValue<uint32_t> m_txBufferSize; //!< bytes waiting in m_txBuffer
+    TracedValue<uint32_t> m_rxBufferSize; //!< readable bytes in m_rxBuffer
+    TracedCallback<Ptr<const Packet>, Ptr<const HelixSocket>> m_txTrace; //!< coded frame sent
+    TracedCallback<Ptr<const Packet>, Ptr<const HelixSocket>> m_rxTrace; //!< coded frame received
+    TracedCallback<Time> m_decodeLatencyTrace; //!< first symbol to decoding of a generation
+
     
 };
 
@@ -5,8 +5,11 @@
 #include "helix-socket.h"
 
 #include "ns3/boolean.h"
+#include "ns3/double.h"
+#include "ns3/enum.h"
 #include "ns3/integer.h"
 #include "ns3/log.h"
+#include "ns3/nstime.h"
 #include "ns3/object.h"
 #include "ns3/trace-source-accessor.h"
 #include "ns3/uinteger.h"
@@ -24,7 +27,110 @@ HelixSocket::GetTypeId()
     static TypeId tid =
         TypeId("ns3::HelixSocket")
             .SetParent<Socket>()
-            .SetGroupName("Internet");
+            .SetGroupName("Internet")
+            .AddAttribute("SndBufSize",
+                          "HelixSocket maximum transmit buffer size (bytes)",
+                          UintegerValue(131072), // 128k
+                          MakeUintegerAccessor(&HelixSocket::GetSndBufSize,
+                                               &HelixSocket::SetSndBufSize),
+                          MakeUintegerChecker<uint32_t>())
+            .AddAttribute("RcvBufSize",
+                          "HelixSocket receive buffer size (bytes)",
+                          UintegerValue(131072), // 128k
+                          MakeUintegerAccessor(&HelixSocket::GetRcvBufSize,
+                                               &HelixSocket::SetRcvBufSize),
+                          MakeUintegerChecker<uint32_t>(1))
+            .AddAttribute("GenerationSize",
+                          "Number of source symbols coded together in a generation",
+                          UintegerValue(32),
+                          MakeUintegerAccessor(&HelixSocket::GetGenerationSize,
+                                               &HelixSocket::SetGenerationSize),
+                          MakeUintegerChecker<uint32_t>(1, 65535))
+            .AddAttribute("RepairOverhead",
+                          "Repair symbols sent per round, as a fraction of the "
+                          "generation size (at least one per round)",
+                          DoubleValue(0.25),
+                          MakeDoubleAccessor(&HelixSocket::GetRepairOverhead,
+                                             &HelixSocket::SetRepairOverhead),
+                          MakeDoubleChecker<double>(0))
+            .AddAttribute("RepairTimeout",
+                          "Time to wait for the receiver to ack a generation before "
+                          "sending another round of repair symbols",
+                          TimeValue(MilliSeconds(100)),
+                          MakeTimeAccessor(&HelixSocket::GetRepairTimeout,
+                                           &HelixSocket::SetRepairTimeout),
+                          MakeTimeChecker(NanoSeconds(1)))
+            .AddAttribute("MaxRepairRounds",
+                          "Repair rounds after which an unacked generation is given up",
+                          UintegerValue(16),
+                          MakeUintegerAccessor(&HelixSocket::GetMaxRepairRounds,
+                                               &HelixSocket::SetMaxRepairRounds),
+                          MakeUintegerChecker<uint32_t>())
+            .AddAttribute("Decoder",
+                          "How received generations are decoded: Incremental row "
+                          "reduces every symbol as it arrives, Batch runs one "
+                          "elimination once enough symbols arrived",
+                          EnumValue(HelixSocket::INCREMENTAL),
+                          MakeEnumAccessor(&HelixSocket::SetDecoder, &HelixSocket::GetDecoder),
+                          MakeEnumChecker(HelixSocket::INCREMENTAL,
+                                          "Incremental",
+                                          HelixSocket::BATCH,
+                                          "Batch"))
+            .AddAttribute("GenerationTimeout",
+                          "Longest time a generation that did not fill up stays open "
+                          "before it is closed and its repair symbols are sent",
+                          TimeValue(MilliSeconds(10)),
+                          MakeTimeAccessor(&HelixSocket::GetGenerationTimeout,
+                                           &HelixSocket::SetGenerationTimeout),
+                          MakeTimeChecker(Time(0)))
+            .AddAttribute("InterleaveDepth",
+                          "Generations open at a time, consecutive source and repair "
+                          "symbols go to them in turn so a loss burst is spread over "
+                          "them. 0 picks the depth from the loss bursts the receiver "
+                          "reports",
+                          UintegerValue(1),
+                          MakeUintegerAccessor(&HelixSocket::GetInterleaveDepth,
+                                               &HelixSocket::SetInterleaveDepth),
+                          MakeUintegerChecker<uint32_t>(0, 64))
+            .AddAttribute("FeedbackInterval",
+                          "Shortest time between two feedbacks (decoded generations and "
+                          "missing degrees of freedom) to the sender. Once the socket "
+                          "has RTT samples, a quarter of the smoothed RTT replaces it "
+                          "when shorter; a receiver that sends no data has none",
+                          TimeValue(MilliSeconds(1)),
+                          MakeTimeAccessor(&HelixSocket::GetFeedbackInterval,
+                                           &HelixSocket::SetFeedbackInterval),
+                          MakeTimeChecker(Time(0)))
+            .AddAttribute("Pacing",
+                          "Pace coded frames at the rate picked by the congestion "
+                          "control instead of sending everything the window allows",
+                          BooleanValue(true),
+                          MakeBooleanAccessor(&HelixSocket::GetPacing, &HelixSocket::SetPacing),
+                          MakeBooleanChecker())
+            .AddAttribute("PacingBurst",
+                          "Frames released per pacing timer, larger bursts "
+                          "schedule fewer events",
+                          UintegerValue(4),
+                          MakeUintegerAccessor(&HelixSocket::GetPacingBurst,
+                                               &HelixSocket::SetPacingBurst),
+                          MakeUintegerChecker<uint32_t>(1))
+            .AddAttribute("RcvLowat",
+                          "Bytes that must be readable in order before the "
+                          "application's receive callback runs, fewer are announced "
+                          "once nothing new was decoded for RepairTimeout or the "
+                          "socket closes",
+                          UintegerValue(1),
+                          MakeUintegerAccessor(&HelixSocket::GetRcvLowat,
+                                               &HelixSocket::SetRcvLowat),
+                          MakeUintegerChecker<uint32_t>(1))
+            .AddAttribute("NotifyDelay",
+                          "Time receive notifications are held back so data decoded "
+                          "meanwhile is announced by the same callback, 0 to notify "
+                          "at once",
+                          TimeValue(Time(0)),
+                          MakeTimeAccessor(&HelixSocket::GetNotifyDelay,
+                                           &HelixSocket::SetNotifyDelay),
+                          MakeTimeChecker(Time(0)));
     return tid;
 }
 
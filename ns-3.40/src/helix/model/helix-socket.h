@@ -3,6 +3,7 @@
 #define HELIX_SOCKET_H
 
 
+#include "ns3/nstime.h"
 #include "ns3/socket.h"
 
 
@@ -29,9 +30,167 @@ class HelixSocket : public Socket
      */
     static TypeId GetTypeId();
 
+    /**
+     * \brief How a generation is decoded, mirrors the helix-rs decoder ids
+     */
+    enum DecoderType_t
+    {
+        INCREMENTAL = 0, //!< row reduce every symbol as it arrives
+        BATCH = 1,       //!< one elimination once enough symbols arrived
+    };
+
     HelixSocket();
     ~HelixSocket() override;
 
+  private:
+    // Indirect the attribute setting and getting through private virtual methods
+
+    /**
+     * \brief Set the number of source symbols per coding generation
+     * \param size source symbols per generation
+     */
+    virtual void SetGenerationSize(uint32_t size) = 0;
+    /**
+     * \brief Get the number of source symbols per coding generation
+     * \returns source symbols per generation
+     */
+    virtual uint32_t GetGenerationSize() const = 0;
+    /**
+     * \brief Set the repair symbols sent per round, as a fraction of
+     *        the generation size
+     * \param overhead repair overhead
+     */
+    virtual void SetRepairOverhead(double overhead) = 0;
+    /**
+     * \brief Get the repair symbols sent per round, as a fraction of
+     *        the generation size
+     * \returns repair overhead
+     */
+    virtual double GetRepairOverhead() const = 0;
+    /**
+     * \brief Set how long to wait for an ack before another repair round
+     * \param timeout repair timeout
+     */
+    virtual void SetRepairTimeout(Time timeout) = 0;
+    /**
+     * \brief Get how long to wait for an ack before another repair round
+     * \returns repair timeout
+     */
+    virtual Time GetRepairTimeout() const = 0;
+    /**
+     * \brief Set the repair rounds after which a generation is given up
+     * \param rounds maximum repair rounds
+     */
+    virtual void SetMaxRepairRounds(uint32_t rounds) = 0;
+    /**
+     * \brief Get the repair rounds after which a generation is given up
+     * \returns maximum repair rounds
+     */
+    virtual uint32_t GetMaxRepairRounds() const = 0;
+    /**
+     * \brief Set the decoder used for generations received from now on
+     * \param decoder decoder type
+     */
+    virtual void SetDecoder(DecoderType_t decoder) = 0;
+    /**
+     * \brief Get the decoder used for generations received from now on
+     * \returns decoder type
+     */
+    virtual DecoderType_t GetDecoder() const = 0;
+    /**
+     * \brief Set the longest time a generation stays open before it is
+     *        closed and its repairs sent
+     * \param timeout generation timeout
+     */
+    virtual void SetGenerationTimeout(Time timeout) = 0;
+    /**
+     * \brief Get the longest time a generation stays open before it is
+     *        closed and its repairs sent
+     * \returns generation timeout
+     */
+    virtual Time GetGenerationTimeout() const = 0;
+    /**
+     * \brief Set the number of generations consecutive symbols are
+     *        spread over
+     * \param depth interleave depth, 0 to follow the loss bursts
+     */
+    virtual void SetInterleaveDepth(uint32_t depth) = 0;
+    /**
+     * \brief Get the number of generations consecutive symbols are
+     *        spread over
+     * \returns interleave depth, 0 if it follows the loss bursts
+     */
+    virtual uint32_t GetInterleaveDepth() const = 0;
+    /**
+     * \brief Set the shortest time between two feedbacks to the sender
+     * \param interval feedback interval
+     */
+    virtual void SetFeedbackInterval(Time interval) = 0;
+    /**
+     * \brief Get the shortest time between two feedbacks to the sender
+     * \returns feedback interval
+     */
+    virtual Time GetFeedbackInterval() const = 0;
+    /**
+     * \brief Enable or disable pacing of coded frames
+     * \param pacing true to pace
+     */
+    virtual void SetPacing(bool pacing) = 0;
+    /**
+     * \brief Whether coded frames are paced
+     * \returns true if paced
+     */
+    virtual bool GetPacing() const = 0;
+    /**
+     * \brief Set the number of frames released per pacing timer
+     * \param frames burst size
+     */
+    virtual void SetPacingBurst(uint32_t frames) = 0;
+    /**
+     * \brief Get the number of frames released per pacing timer
+     * \returns burst size
+     */
+    virtual uint32_t GetPacingBurst() const = 0;
+    /**
+     * \brief Set the readable bytes the receive callback waits for
+     * \param bytes low-water mark
+     */
+    virtual void SetRcvLowat(uint32_t bytes) = 0;
+    /**
+     * \brief Get the readable bytes the receive callback waits for
+     * \returns low-water mark
+     */
+    virtual uint32_t GetRcvLowat() const = 0;
+    /**
+     * \brief Set how long receive notifications are held back
+     * \param delay coalescing delay, 0 to notify at once
+     */
+    virtual void SetNotifyDelay(Time delay) = 0;
+    /**
+     * \brief Get how long receive notifications are held back
+     * \returns coalescing delay
+     */
+    virtual Time GetNotifyDelay() const = 0;
+    /**
+     * \brief Set the send buffer size
+     * \param size the buffer size (in bytes)
+     */
+    virtual void SetSndBufSize(uint32_t size) = 0;
+    /**
+     * \brief Get the send buffer size
+     * \returns the buffer size (in bytes)
+     */
+    virtual uint32_t GetSndBufSize() const = 0;
+    /**
+     * \brief Set the receive buffer size
+     * \param size the buffer size (in bytes)
+     */
+    virtual void SetRcvBufSize(uint32_t size) = 0;
+    /**
+     * \brief Get the receive buffer size
+     * \returns the buffer size (in bytes)
+     */
+    virtual uint32_t GetRcvBufSize() const = 0;
 };
 
 } // namespace ns3
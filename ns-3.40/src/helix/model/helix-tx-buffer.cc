@@ -0,0 +1,141 @@
+
+#include "helix-tx-buffer.h"
+
+#include "ns3/log.h"
+
+#include <algorithm>
+
+namespace ns3
+{
+
+NS_LOG_COMPONENT_DEFINE("HelixTxBuffer");
+
+NS_OBJECT_ENSURE_REGISTERED(HelixTxBuffer);
+
+TypeId
+HelixTxBuffer::GetTypeId()
+{
+    static TypeId tid = TypeId("ns3::HelixTxBuffer")
+                            .SetParent<Object>()
+                            .SetGroupName("Internet")
+                            .AddConstructor<HelixTxBuffer>();
+    return tid;
+}
+
+HelixTxBuffer::HelixTxBuffer()
+    : m_maxSize(131072),
+      m_head(0),
+      m_size(0)
+{
+    NS_LOG_FUNCTION(this);
+}
+
+HelixTxBuffer::~HelixTxBuffer()
+{
+    NS_LOG_FUNCTION(this);
+}
+
+void
+HelixTxBuffer::SetMaxBufferSize(uint32_t size)
+{
+    NS_LOG_FUNCTION(this << size);
+    m_maxSize = size;
+    if (m_ring.size() > std::max(size, m_size))
+    {
+        Resize(std::max(size, m_size));
+    }
+}
+
+uint32_t
+HelixTxBuffer::GetMaxBufferSize() const
+{
+    return m_maxSize;
+}
+
+uint32_t
+HelixTxBuffer::Size() const
+{
+    return m_size;
+}
+
+uint32_t
+HelixTxBuffer::Available() const
+{
+    return m_maxSize > m_size ? m_maxSize - m_size : 0;
+}
+
+bool
+HelixTxBuffer::Add(Ptr<Packet> p)
+{
+    NS_LOG_FUNCTION(this << p);
+
+    uint32_t len = p->GetSize();
+    if (len > Available())
+    {
+        return false;
+    }
+    if (len == 0)
+    {
+        return true;
+    }
+
+    // the ring only grows to what is used, idle sockets stay small
+    if (m_size + len > m_ring.size())
+    {
+        uint64_t grown = std::max<uint64_t>(m_ring.size() * 2, m_size + len);
+        Resize(static_cast<uint32_t>(std::min<uint64_t>(grown, m_maxSize)));
+    }
+
+    uint32_t capacity = m_ring.size();
+    uint32_t tail = (m_head + m_size) % capacity;
+    uint32_t first = std::min(len, capacity - tail);
+    p->CopyData(&m_ring[tail], first);
+    if (first < len)
+    {
+        p->CreateFragment(first, len - first)->CopyData(&m_ring[0], len - first);
+    }
+    m_size += len;
+    return true;
+}
+
+Ptr<Packet>
+HelixTxBuffer::Remove(uint32_t maxBytes)
+{
+    NS_LOG_FUNCTION(this << maxBytes);
+
+    uint32_t len = std::min(maxBytes, m_size);
+    if (len == 0)
+    {
+        return nullptr;
+    }
+
+    uint32_t capacity = m_ring.size();
+    uint32_t first = std::min(len, capacity - m_head);
+    Ptr<Packet> p = Create<Packet>(&m_ring[m_head], first);
+    if (first < len)
+    {
+        p->AddAtEnd(Create<Packet>(&m_ring[0], len - first));
+    }
+    m_head = (m_head + len) % capacity;
+    m_size -= len;
+    if (m_size == 0)
+    {
+        m_head = 0;
+    }
+    return p;
+}
+
+void
+HelixTxBuffer::Resize(uint32_t capacity)
+{
+    NS_LOG_FUNCTION(this << capacity);
+
+    std::vector<uint8_t> ring(capacity);
+    uint32_t first = std::min<uint32_t>(m_size, m_ring.size() - m_head);
+    std::copy_n(m_ring.begin() + m_head, first, ring.begin());
+    std::copy_n(m_ring.begin(), m_size - first, ring.begin() + first);
+    m_ring.swap(ring);
+    m_head = 0;
+}
+
+} // namespace ns3
@@ -0,0 +1,94 @@
+/*
+ * Transmit buffer of HELIX sockets
+ *
+ * Holds the bytes an application wrote until the socket hands them to
+ * the encoder, which it only does once the frames queued before them
+ * went on the wire. The buffer is a fixed ring of SndBufSize bytes, so a
+ * socket never holds more unsent data than that no matter how fast the
+ * application writes.
+ */
+#ifndef HELIX_TX_BUFFER_H
+#define HELIX_TX_BUFFER_H
+
+#include "ns3/object.h"
+#include "ns3/packet.h"
+#include "ns3/ptr.h"
+
+#include <stdint.h>
+#include <vector>
+
+namespace ns3
+{
+
+/**
+ * \ingroup helix
+ *
+ * \brief Bounded ring buffer of application bytes waiting to be encoded
+ */
+class HelixTxBuffer : public Object
+{
+  public:
+    /**
+     * \brief Get the type ID.
+     * \return the object TypeId
+     */
+    static TypeId GetTypeId();
+
+    HelixTxBuffer();
+    ~HelixTxBuffer() override;
+
+    /**
+     * \brief Set the capacity, dropping nothing: a capacity below the
+     *        current size only takes effect as the buffer drains
+     * \param size capacity in bytes
+     */
+    void SetMaxBufferSize(uint32_t size);
+
+    /**
+     * \brief Get the capacity
+     * \return capacity in bytes
+     */
+    uint32_t GetMaxBufferSize() const;
+
+    /**
+     * \brief Get the number of buffered bytes
+     * \return bytes waiting to be encoded
+     */
+    uint32_t Size() const;
+
+    /**
+     * \brief Get the free space
+     * \return bytes Add() accepts
+     */
+    uint32_t Available() const;
+
+    /**
+     * \brief Append the bytes of a packet
+     * \param p packet
+     * \return false, without copying anything, if p does not fit
+     */
+    bool Add(Ptr<Packet> p);
+
+    /**
+     * \brief Take bytes from the front of the buffer
+     * \param maxBytes largest number of bytes to take
+     * \return a packet of min(maxBytes, Size()) bytes, nullptr if empty
+     */
+    Ptr<Packet> Remove(uint32_t maxBytes);
+
+  private:
+    /**
+     * \brief Re-lay the buffered bytes out in a ring of a new size
+     * \param capacity ring size, at least Size()
+     */
+    void Resize(uint32_t capacity);
+
+    uint32_t m_maxSize;          //!< capacity Available() is computed against
+    std::vector<uint8_t> m_ring; //!< storage, grown up to m_maxSize on demand
+    uint32_t m_head;             //!< offset of the first buffered byte in m_ring
+    uint32_t m_size;             //!< buffered bytes
+};
+
+} // namespace ns3
+
+#endif /* HELIX_TX_BUFFER_H */
@@ -1,6 +1,33 @@
 
 // Include a header file from your module to test.
 #include "ns3/helix.h"
+#include "ns3/helix-bbr.h"
+#include "ns3/helix-congestion-ops.h"
+#include "ns3/helix-end-point-demux.h"
+#include "ns3/helix-header.h"
+#include "ns3/helix-helper.h"
+#include "ns3/helix-l4-protocol.h"
+#include "ns3/helix-redundancy-controller.h"
+#include "ns3/helix-rx-buffer.h"
+#include "ns3/helix-socket-factory.h"
+#include "ns3/helix-socket-impl.h"
+#include "ns3/helix-tx-buffer.h"
+#include "ns3/inet-socket-address.h"
+#include "ns3/internet-stack-helper.h"
+#include "ns3/ipv4-address-helper.h"
+#include "ns3/ipv4-end-point.h"
+#include "ns3/point-to-point-helper.h"
+
+#include "ns3/boolean.h"
+#include "ns3/double.h"
+#include "ns3/nstime.h"
+#include "ns3/packet.h"
+#include "ns3/pointer.h"
+#include "ns3/simulator.h"
+#include "ns3/string.h"
+#include "ns3/uinteger.h"
+
+#include <vector>
 
 // An essential include is test.h
 #include "ns3/test.h"
@@ -57,6 +84,700 @@ HelixTestCase1::DoRun()
     NS_TEST_ASSERT_MSG_EQ_TOL(0.01, 0.01, 0.001, "Numbers are not equal within tolerance");
 }
 
+/**
+ * \ingroup helix-tests
+ * Check that a HelixHeader survives a trip through a packet
+ */
+class HelixHeaderTestCase : public TestCase
+{
+  public:
+    HelixHeaderTestCase();
+
+  private:
+    void DoRun() override;
+};
+
+HelixHeaderTestCase::HelixHeaderTestCase()
+    : TestCase("HelixHeader serialization round trip")
+{
+}
+
+void
+HelixHeaderTestCase::DoRun()
+{
+    Ptr<Packet> p = Create<Packet>(100);
+
+    HelixHeader header;
+    header.SetSourcePort(49153);
+    header.SetDestinationPort(50000);
+    header.SetPayloadLength(100);
+    p->AddHeader(header);
+    NS_TEST_ASSERT_MSG_EQ(p->GetSize(), 100 + HelixHeader::SERIALIZED_SIZE, "Wrong header size");
+
+    HelixHeader copy;
+    p->RemoveHeader(copy);
+    NS_TEST_ASSERT_MSG_EQ(copy.GetSourcePort(), 49153, "Source port changed");
+    NS_TEST_ASSERT_MSG_EQ(copy.GetDestinationPort(), 50000, "Destination port changed");
+    NS_TEST_ASSERT_MSG_EQ(copy.GetPayloadLength(), 100, "Payload length changed");
+    NS_TEST_ASSERT_MSG_EQ(p->GetSize(), 100, "Header not fully removed");
+}
+
+/**
+ * \ingroup helix-tests
+ * Check the lookup order of HelixEndPointDemux
+ */
+class HelixEndPointDemuxTestCase : public TestCase
+{
+  public:
+    HelixEndPointDemuxTestCase();
+
+  private:
+    void DoRun() override;
+};
+
+HelixEndPointDemuxTestCase::HelixEndPointDemuxTestCase()
+    : TestCase("HelixEndPointDemux lookup order")
+{
+}
+
+void
+HelixEndPointDemuxTestCase::DoRun()
+{
+    HelixEndPointDemux demux;
+    Ipv4Address local("10.0.0.1");
+    Ipv4Address peer("10.0.0.2");
+
+    Ipv4EndPoint* listener = demux.Allocate(nullptr, Ipv4Address::GetAny(), 9);
+    Ipv4EndPoint* bound = demux.Allocate(nullptr, local, 9);
+    Ipv4EndPoint* connected = demux.Allocate(nullptr, local, 9000);
+    Ipv4EndPoint* other = demux.Allocate(nullptr, local, 9001);
+    NS_TEST_ASSERT_MSG_EQ(demux.Allocate(nullptr, local, 9), nullptr, "Duplicate allocated");
+    NS_TEST_ASSERT_MSG_EQ(demux.GetNEndPoints(), 4, "Wrong endpoint count");
+
+    NS_TEST_ASSERT_MSG_EQ(demux.SetPeer(connected, peer, 5000), true, "Connect failed");
+    NS_TEST_ASSERT_MSG_EQ(demux.SetPeer(other, peer, 5000), true, "Connect failed");
+
+    NS_TEST_ASSERT_MSG_EQ(demux.Lookup(local, 9, peer, 1, nullptr), bound, "Specific address");
+    NS_TEST_ASSERT_MSG_EQ(demux.Lookup(Ipv4Address("10.0.0.3"), 9, peer, 1, nullptr),
+                          listener,
+                          "Any address");
+    NS_TEST_ASSERT_MSG_EQ(demux.Lookup(local, 9000, peer, 5000, nullptr), connected, "Connected");
+    NS_TEST_ASSERT_MSG_EQ(demux.Lookup(local, 9001, peer, 5000, nullptr), other, "Other port");
+    NS_TEST_ASSERT_MSG_EQ(demux.Lookup(local, 9000, peer, 5001, nullptr),
+                          nullptr,
+                          "Wrong peer port");
+
+    demux.DeAllocate(bound);
+    NS_TEST_ASSERT_MSG_EQ(demux.Lookup(local, 9, peer, 1, nullptr), listener, "Fallback");
+    NS_TEST_ASSERT_MSG_EQ(demux.GetNEndPoints(), 3, "Wrong endpoint count");
+}
+
+/**
+ * \ingroup helix-tests
+ * Check the repair ratios HelixRedundancyController picks from loss reports
+ */
+class HelixRedundancyControllerTestCase : public TestCase
+{
+  public:
+    HelixRedundancyControllerTestCase();
+
+  private:
+    void DoRun() override;
+};
+
+HelixRedundancyControllerTestCase::HelixRedundancyControllerTestCase()
+    : TestCase("HelixRedundancyController repair ratio")
+{
+}
+
+void
+HelixRedundancyControllerTestCase::DoRun()
+{
+    Ptr<HelixRedundancyController> lossless = CreateObject<HelixRedundancyController>();
+    NS_TEST_ASSERT_MSG_EQ(lossless->OnFeedback({100, 0, 0}, 32), true, "Ratio unchanged");
+    NS_TEST_ASSERT_MSG_EQ_TOL(lossless->GetRepairRatio(), 0.05, 1e-9, "Not at MinRepairRatio");
+    NS_TEST_ASSERT_MSG_EQ(lossless->OnFeedback({100, 0, 0}, 32), false, "Empty report used");
+
+    // 10% loss in single frame bursts
+    Ptr<HelixRedundancyController> random = CreateObject<HelixRedundancyController>();
+    random->OnFeedback({90, 10, 10}, 32);
+    NS_TEST_ASSERT_MSG_EQ_TOL(random->GetLossRate(), 0.1, 1e-9, "Wrong loss rate");
+    NS_TEST_ASSERT_MSG_GT(random->GetRepairRatio(), 0.1, "Ratio below the loss rate");
+
+    // the same loss in bursts of 5 needs more repairs per generation
+    Ptr<HelixRedundancyController> bursty = CreateObject<HelixRedundancyController>();
+    bursty->OnFeedback({90, 10, 2}, 32);
+    NS_TEST_ASSERT_MSG_EQ_TOL(bursty->GetBurstLength(), 5, 1e-9, "Wrong burst length");
+    NS_TEST_ASSERT_MSG_GT(bursty->RequiredRepairs(32),
+                          random->RequiredRepairs(32),
+                          "Bursts need more repairs");
+
+    // interleaving over the burst length spreads a burst over generations
+    NS_TEST_ASSERT_MSG_EQ(bursty->PickInterleaveDepth(), 5, "Wrong interleave depth");
+    uint32_t blockRepairs = bursty->RequiredRepairs(32);
+    bursty->SetInterleaveDepth(5);
+    NS_TEST_ASSERT_MSG_LT(bursty->RequiredRepairs(32),
+                          blockRepairs,
+                          "Interleaving did not lower the repairs");
+
+    // loss going away lowers the ratio again
+    double before = random->GetRepairRatio();
+    random->OnFeedback({1090, 10, 10}, 32);
+    NS_TEST_ASSERT_MSG_LT(random->GetRepairRatio(), before, "Ratio did not fall");
+}
+
+/**
+ * \ingroup helix-tests
+ * Check how HelixNewReno and HelixBbr react to acks and repair rounds
+ */
+class HelixCongestionOpsTestCase : public TestCase
+{
+  public:
+    HelixCongestionOpsTestCase();
+
+  private:
+    void DoRun() override;
+};
+
+HelixCongestionOpsTestCase::HelixCongestionOpsTestCase()
+    : TestCase("HelixCongestionOps window updates")
+{
+}
+
+void
+HelixCongestionOpsTestCase::DoRun()
+{
+    // FFICongestionSample is {acked_bytes, lost_bytes, in_flight, rtt_ns, repair_rounds}
+    Ptr<HelixNewReno> reno = CreateObject<HelixNewReno>();
+    reno->SetSegmentSize(1000);
+    NS_TEST_ASSERT_MSG_EQ(reno->GetCwnd(), 10000, "Wrong initial window");
+    reno->OnSample({5000, 0, 5000, 10000000, 0}, MilliSeconds(10));
+    NS_TEST_ASSERT_MSG_EQ(reno->GetCwnd(), 15000, "No slow start");
+    reno->OnSample({0, 3000, 12000, 0, 1}, MilliSeconds(100));
+    NS_TEST_ASSERT_MSG_EQ(reno->GetCwnd(), 7500, "Repair round did not halve");
+    reno->OnSample({0, 3000, 9000, 0, 1}, MilliSeconds(105));
+    NS_TEST_ASSERT_MSG_EQ(reno->GetCwnd(), 7500, "Halved twice in one rtt");
+    reno->OnSample({7500, 0, 7500, 10000000, 0}, MilliSeconds(120));
+    NS_TEST_ASSERT_MSG_EQ(reno->GetCwnd(), 8500, "No congestion avoidance");
+
+    // 10 Mb/s delivered over a 20 ms path, one ack every ms
+    Ptr<HelixBbr> bbr = CreateObject<HelixBbr>();
+    bbr->SetSegmentSize(1000);
+    for (uint32_t i = 1; i <= 400; i++)
+    {
+        bbr->OnSample({1250, 0, 25000, 20000000, 0}, MilliSeconds(i));
+    }
+    NS_TEST_ASSERT_MSG_EQ(bbr->GetMode(), HelixBbr::PROBE_BW, "STARTUP did not end");
+    NS_TEST_ASSERT_MSG_EQ(bbr->GetMinRtt(), MilliSeconds(20), "Wrong min rtt");
+    NS_TEST_ASSERT_MSG_EQ_TOL(bbr->GetBottleneckBandwidth().GetBitRate(),
+                              10000000,
+                              100000,
+                              "Wrong bottleneck bandwidth");
+    NS_TEST_ASSERT_MSG_EQ_TOL(bbr->GetCwnd(), 50000, 1000, "Cwnd is not 2 BDP");
+    uint32_t cwnd = bbr->GetCwnd();
+    bbr->OnSample({0, 25000, 0, 0, 1}, MilliSeconds(401));
+    NS_TEST_ASSERT_MSG_EQ(bbr->GetCwnd(), cwnd, "Loss shrank the window");
+}
+
+/**
+ * \ingroup helix-tests
+ * Check that HelixTxBuffer is bounded and keeps bytes in order across
+ * the end of its ring
+ */
+class HelixTxBufferTestCase : public TestCase
+{
+  public:
+    HelixTxBufferTestCase();
+
+  private:
+    void DoRun() override;
+};
+
+HelixTxBufferTestCase::HelixTxBufferTestCase()
+    : TestCase("HelixTxBuffer ring")
+{
+}
+
+void
+HelixTxBufferTestCase::DoRun()
+{
+    uint8_t data[32];
+    for (uint8_t i = 0; i < 32; i++)
+    {
+        data[i] = i;
+    }
+
+    Ptr<HelixTxBuffer> buffer = CreateObject<HelixTxBuffer>();
+    buffer->SetMaxBufferSize(10);
+    NS_TEST_ASSERT_MSG_EQ(buffer->Add(Create<Packet>(data, 6)), true, "Add failed");
+    NS_TEST_ASSERT_MSG_EQ(buffer->Add(Create<Packet>(data + 6, 6)), false, "Overfilled");
+    NS_TEST_ASSERT_MSG_EQ(buffer->Add(Create<Packet>(data + 6, 4)), true, "Add failed");
+    NS_TEST_ASSERT_MSG_EQ(buffer->Available(), 0, "Wrong free space");
+
+    // the ring is now at its full capacity of 10, from here on it only wraps
+    uint8_t out[10];
+    Ptr<Packet> p = buffer->Remove(7);
+    NS_TEST_ASSERT_MSG_EQ(p->GetSize(), 7, "Wrong removed size");
+    p->CopyData(out, 7);
+    for (uint8_t i = 0; i < 7; i++)
+    {
+        NS_TEST_ASSERT_MSG_EQ(out[i], data[i], "Bytes out of order");
+    }
+
+    // the tail is back at the start of the ring
+    NS_TEST_ASSERT_MSG_EQ(buffer->Add(Create<Packet>(data + 10, 3)), true, "Add failed");
+    p = buffer->Remove(5);
+    NS_TEST_ASSERT_MSG_EQ(p->GetSize(), 5, "Wrong removed size");
+    p->CopyData(out, 5);
+    for (uint8_t i = 0; i < 5; i++)
+    {
+        NS_TEST_ASSERT_MSG_EQ(out[i], data[i + 7], "Bytes out of order across the wrap");
+    }
+
+    // one add split between the end and the start of the ring
+    NS_TEST_ASSERT_MSG_EQ(buffer->Available(), 9, "Wrong free space");
+    NS_TEST_ASSERT_MSG_EQ(buffer->Add(Create<Packet>(data + 13, 9)), true, "Wrapping add failed");
+    NS_TEST_ASSERT_MSG_EQ(buffer->Available(), 0, "Wrong free space");
+
+    p = buffer->Remove(100);
+    NS_TEST_ASSERT_MSG_EQ(p->GetSize(), 10, "Wrong removed size");
+    p->CopyData(out, 10);
+    for (uint8_t i = 0; i < 10; i++)
+    {
+        NS_TEST_ASSERT_MSG_EQ(out[i], data[i + 12], "Bytes out of order across the wrap");
+    }
+    NS_TEST_ASSERT_MSG_EQ(buffer->Remove(1), nullptr, "Buffer not empty");
+}
+
+/**
+ * \ingroup helix-tests
+ * Check that HelixRxBuffer delivers chunks written out of order as one
+ * in-order stream, including chunks that arrive beyond the ring.
+ */
+class HelixRxBufferTestCase : public TestCase
+{
+  public:
+    HelixRxBufferTestCase();
+
+  private:
+    void DoRun() override;
+};
+
+HelixRxBufferTestCase::HelixRxBufferTestCase()
+    : TestCase("HelixRxBuffer reassembly")
+{
+}
+
+void
+HelixRxBufferTestCase::DoRun()
+{
+    uint8_t data[32];
+    for (uint8_t i = 0; i < 32; i++)
+    {
+        data[i] = i;
+    }
+
+    Ptr<HelixRxBuffer> buffer = CreateObject<HelixRxBuffer>();
+    buffer->SetMaxBufferSize(16);
+    buffer->Write(8, data + 8, 8);
+    NS_TEST_ASSERT_MSG_EQ(buffer->Available(), 0, "Bytes after a gap are readable");
+    NS_TEST_ASSERT_MSG_EQ(buffer->GetLimit(), 16, "Wrong limit");
+    NS_TEST_ASSERT_MSG_EQ(buffer->Write(20, data + 20, 12), 12, "Bytes beyond the ring kept");
+    buffer->Write(0, data, 8);
+    buffer->Write(4, data + 4, 8); // duplicate
+    NS_TEST_ASSERT_MSG_EQ(buffer->Available(), 16, "Gap not filled");
+
+    Ptr<Packet> p = buffer->Read(6);
+    NS_TEST_ASSERT_MSG_EQ(p->GetSize(), 6, "Wrong partial read");
+    NS_TEST_ASSERT_MSG_EQ(buffer->NextOffset(), 6, "Wrong next offset");
+    buffer->Write(16, data + 16, 4);
+    NS_TEST_ASSERT_MSG_EQ(buffer->Available(), 14, "Bytes past the gap not readable");
+    NS_TEST_ASSERT_MSG_EQ(buffer->Write(20, data + 20, 12), 10, "Ring not filled up to the limit");
+    NS_TEST_ASSERT_MSG_EQ(buffer->Available(), 16, "Ring not full");
+
+    uint8_t out[32];
+    p->CopyData(out, 6);
+    p = buffer->Read(100);
+    p->CopyData(out + 6, 16);
+    NS_TEST_ASSERT_MSG_EQ(buffer->Write(22, data + 22, 10), 0, "Bytes within the ring dropped");
+    p = buffer->Read(100);
+    p->CopyData(out + 22, 10);
+    for (uint8_t i = 0; i < 32; i++)
+    {
+        NS_TEST_ASSERT_MSG_EQ(out[i], data[i], "Bytes out of order");
+    }
+    NS_TEST_ASSERT_MSG_EQ(buffer->Read(1), nullptr, "Buffer not empty");
+}
+
+/**
+ * \ingroup helix-tests
+ * Check that a HelixSocketImpl made by CreateObject keeps the objects its
+ * constructor created once the attribute defaults are applied
+ */
+class HelixSocketAttributesTestCase : public TestCase
+{
+  public:
+    HelixSocketAttributesTestCase();
+
+  private:
+    void DoRun() override;
+};
+
+HelixSocketAttributesTestCase::HelixSocketAttributesTestCase()
+    : TestCase("HelixSocketImpl attribute construction")
+{
+}
+
+void
+HelixSocketAttributesTestCase::DoRun()
+{
+    Ptr<HelixSocketImpl> socket = CreateObject<HelixSocketImpl>();
+    NS_TEST_ASSERT_MSG_NE(socket->GetRedundancyController(),
+                          nullptr,
+                          "Redundancy controller lost during construction");
+    NS_TEST_ASSERT_MSG_NE(socket->GetCongestionControlAlgorithm(),
+                          nullptr,
+                          "Congestion control lost during construction");
+
+    socket->SetAttribute("RepairOverhead", DoubleValue(0.5));
+    DoubleValue overhead;
+    socket->GetAttribute("RepairOverhead", overhead);
+    NS_TEST_ASSERT_MSG_EQ_TOL(overhead.Get(), 0.5, 1e-9, "RepairOverhead not kept");
+    NS_TEST_ASSERT_MSG_EQ_TOL(socket->GetRedundancyController()->GetRepairRatio(),
+                              0.5,
+                              1e-9,
+                              "RepairOverhead not passed to the controller");
+
+    PointerValue redundancy;
+    socket->GetAttribute("RedundancyController", redundancy);
+    NS_TEST_ASSERT_MSG_EQ(redundancy.Get<HelixRedundancyController>(),
+                          socket->GetRedundancyController(),
+                          "Attribute does not expose the controller");
+}
+
+/**
+ * \ingroup helix-tests
+ * Check that HelixStackHelper gives every node one protocol and one
+ * socket factory, whether HELIX or the IP stack is installed first
+ */
+class HelixStackHelperTestCase : public TestCase
+{
+  public:
+    HelixStackHelperTestCase();
+
+  private:
+    void DoRun() override;
+};
+
+HelixStackHelperTestCase::HelixStackHelperTestCase()
+    : TestCase("HelixStackHelper install")
+{
+}
+
+void
+HelixStackHelperTestCase::DoRun()
+{
+    NodeContainer nodes;
+    nodes.Create(3);
+
+    HelixStackHelper helix;
+    helix.Install(nodes.Get(0));
+    InternetStackHelper internet;
+    internet.Install(nodes);
+    helix.Install(nodes);
+
+    for (uint32_t i = 0; i < nodes.GetN(); i++)
+    {
+        Ptr<Node> node = nodes.Get(i);
+        Ptr<HelixL4Protocol> protocol = node->GetObject<HelixL4Protocol>();
+        NS_TEST_ASSERT_MSG_NE(protocol, nullptr, "No protocol on node " << i);
+        NS_TEST_ASSERT_MSG_NE(node->GetObject<HelixSocketFactory>(),
+                              nullptr,
+                              "No socket factory on node " << i);
+
+        Ptr<Socket> socket = protocol->CreateSocket();
+        protocol->CreateSocket();
+        NS_TEST_ASSERT_MSG_EQ(socket->GetNode(), node, "Socket on the wrong node");
+        NS_TEST_ASSERT_MSG_EQ(protocol->GetNSockets(), 2, "Wrong socket count");
+    }
+    Simulator::Destroy();
+}
+
+/**
+ * \ingroup helix-tests
+ * Check that a socket only holds a helix-rs connection between its first
+ * bind or connect and its close
+ */
+class HelixSocketLifetimeTestCase : public TestCase
+{
+  public:
+    HelixSocketLifetimeTestCase();
+
+  private:
+    void DoRun() override;
+};
+
+HelixSocketLifetimeTestCase::HelixSocketLifetimeTestCase()
+    : TestCase("HelixSocketImpl lazy connection")
+{
+}
+
+void
+HelixSocketLifetimeTestCase::DoRun()
+{
+    Ptr<Node> node = CreateObject<Node>();
+    InternetStackHelper internet;
+    internet.Install(node);
+    HelixStackHelper helix;
+    helix.Install(node);
+    Ptr<HelixL4Protocol> protocol = node->GetObject<HelixL4Protocol>();
+
+    Ptr<Socket> socket = protocol->CreateSocket();
+    PointerValue rs;
+    socket->GetAttribute("RsInterface", rs);
+    NS_TEST_ASSERT_MSG_EQ(rs.Get<Object>(), nullptr, "Connection created before bind");
+    NS_TEST_ASSERT_MSG_EQ(socket->Bind(), 0, "Bind failed");
+    socket->GetAttribute("RsInterface", rs);
+    NS_TEST_ASSERT_MSG_NE(rs.Get<Object>(), nullptr, "No connection after bind");
+    NS_TEST_ASSERT_MSG_EQ(socket->Close(), 0, "Close failed");
+    socket->GetAttribute("RsInterface", rs);
+    NS_TEST_ASSERT_MSG_EQ(rs.Get<Object>(), nullptr, "Connection kept after close");
+    NS_TEST_ASSERT_MSG_EQ(socket->Bind(), -1, "Closed socket bound again");
+
+    // the udp socket is gone with the connection, the socket still
+    // answers as a closed udp-mode socket
+    NS_TEST_ASSERT_MSG_EQ(socket->Send(Create<Packet>(100)), -1, "Closed socket sent");
+    NS_TEST_ASSERT_MSG_EQ(socket->GetErrno(), Socket::ERROR_SHUTDOWN, "Wrong errno after close");
+    Address peer;
+    NS_TEST_ASSERT_MSG_EQ(socket->GetPeerName(peer), -1, "Closed socket has a peer");
+    NS_TEST_ASSERT_MSG_EQ(socket->GetNode(), node, "Closed socket lost its node");
+
+    // and one not bound yet as an unconnected one
+    socket = protocol->CreateSocket();
+    NS_TEST_ASSERT_MSG_EQ(socket->Send(Create<Packet>(100)), -1, "Unbound socket sent");
+    NS_TEST_ASSERT_MSG_EQ(socket->GetErrno(), Socket::ERROR_NOTCONN, "Wrong errno before bind");
+
+    socket = protocol->CreateSocket();
+    NS_TEST_ASSERT_MSG_EQ(socket->Connect(InetSocketAddress(Ipv4Address("10.1.1.2"), 9)),
+                          0,
+                          "Connect failed");
+    socket->GetAttribute("RsInterface", rs);
+    NS_TEST_ASSERT_MSG_NE(rs.Get<Object>(), nullptr, "No connection after connect");
+    Simulator::Destroy();
+}
+
+/**
+ * \ingroup helix-tests
+ * Check when the receive callback runs with RcvLowat and NotifyDelay
+ */
+class HelixRcvLowatTestCase : public TestCase
+{
+  public:
+    HelixRcvLowatTestCase();
+
+  private:
+    void DoRun() override;
+
+    /**
+     * Send 5000 bytes over a point to point link and record the reads
+     * of the receiver
+     * \param lowat RcvLowat of the receiver
+     * \param notifyDelay NotifyDelay of the receiver
+     */
+    void Transfer(uint32_t lowat, Time notifyDelay);
+
+    /**
+     * Read everything the receiver holds
+     * \param socket the receiver
+     */
+    void HandleRead(Ptr<Socket> socket);
+
+    std::vector<uint32_t> m_reads; //!< bytes read by each receive callback
+    std::vector<Time> m_readTimes; //!< when each receive callback ran
+};
+
+HelixRcvLowatTestCase::HelixRcvLowatTestCase()
+    : TestCase("HelixSocketImpl RcvLowat and NotifyDelay")
+{
+}
+
+void
+HelixRcvLowatTestCase::Transfer(uint32_t lowat, Time notifyDelay)
+{
+    m_reads.clear();
+    m_readTimes.clear();
+
+    NodeContainer nodes;
+    nodes.Create(2);
+    PointToPointHelper link;
+    link.SetDeviceAttribute("DataRate", StringValue("100Mbps"));
+    link.SetChannelAttribute("Delay", StringValue("1ms"));
+    NetDeviceContainer devices = link.Install(nodes);
+    InternetStackHelper internet;
+    internet.Install(nodes);
+    Ipv4AddressHelper address("10.1.1.0", "255.255.255.0");
+    Ipv4InterfaceContainer interfaces = address.Assign(devices);
+    HelixStackHelper helix;
+    helix.Install(nodes);
+
+    Ptr<Socket> sink = Socket::CreateSocket(nodes.Get(1), HelixSocketFactory::GetTypeId());
+    sink->SetAttribute("RcvLowat", UintegerValue(lowat));
+    sink->SetAttribute("NotifyDelay", TimeValue(notifyDelay));
+    sink->Bind(InetSocketAddress(Ipv4Address::GetAny(), 9));
+    sink->Listen();
+    sink->SetRecvCallback(MakeCallback(&HelixRcvLowatTestCase::HandleRead, this));
+
+    // unpaced, so all source symbols arrive within a millisecond
+    Ptr<Socket> source = Socket::CreateSocket(nodes.Get(0), HelixSocketFactory::GetTypeId());
+    source->SetAttribute("Pacing", BooleanValue(false));
+    source->Connect(InetSocketAddress(interfaces.GetAddress(1), 9));
+    Simulator::Schedule(Seconds(1), [source]() { source->Send(Create<Packet>(5000)); });
+
+    Simulator::Stop(Seconds(3));
+    Simulator::Run();
+    Simulator::Destroy();
+}
+
+void
+HelixRcvLowatTestCase::HandleRead(Ptr<Socket> socket)
+{
+    uint32_t bytes = 0;
+    for (Ptr<Packet> p = socket->Recv(); p; p = socket->Recv())
+    {
+        bytes += p->GetSize();
+    }
+    m_reads.push_back(bytes);
+    m_readTimes.push_back(Simulator::Now());
+}
+
+void
+HelixRcvLowatTestCase::DoRun()
+{
+    // four source symbols of 1014 bytes reach the mark, the fifth is a
+    // tail the peer never completes
+    Transfer(4000, Time(0));
+    NS_TEST_ASSERT_MSG_EQ(m_reads.size(), 2, "Wrong number of receive callbacks");
+    NS_TEST_ASSERT_MSG_GT_OR_EQ(m_reads[0], 4000, "Callback below RcvLowat");
+    NS_TEST_ASSERT_MSG_LT(m_reads[1], 4000, "Tail not announced on its own");
+    NS_TEST_ASSERT_MSG_EQ(m_reads[0] + m_reads[1], 5000, "Bytes lost");
+    NS_TEST_ASSERT_MSG_GT_OR_EQ(m_readTimes[1] - m_readTimes[0],
+                                MilliSeconds(100),
+                                "Tail announced before RepairTimeout");
+
+    // every symbol decoded within the delay is announced by one callback
+    Transfer(1, MilliSeconds(50));
+    NS_TEST_ASSERT_MSG_EQ(m_reads.size(), 1, "Notifications not batched");
+    NS_TEST_ASSERT_MSG_EQ(m_reads[0], 5000, "Batch incomplete");
+}
+
+/**
+ * \ingroup helix-tests
+ * Check that a reader pausing longer than RepairTimeout times
+ * MaxRepairRounds loses nothing and does not shrink the congestion
+ * window of the sender
+ */
+class HelixSlowReaderTestCase : public TestCase
+{
+  public:
+    HelixSlowReaderTestCase();
+
+  private:
+    void DoRun() override;
+
+    /**
+     * Read everything the receiver holds once the pause is over
+     * \param socket the receiver
+     */
+    void HandleRead(Ptr<Socket> socket);
+
+    /**
+     * Count the decreases of the congestion window of the sender
+     * \param oldValue previous window
+     * \param newValue new window
+     */
+    void CwndChange(uint32_t oldValue, uint32_t newValue);
+
+    Time m_pauseEnd;      //!< time the receiver starts reading
+    uint32_t m_read;      //!< bytes read by the receiver
+    uint32_t m_decreases; //!< times the congestion window shrank
+};
+
+HelixSlowReaderTestCase::HelixSlowReaderTestCase()
+    : TestCase("HelixSocketImpl slow reader"),
+      m_read(0),
+      m_decreases(0)
+{
+}
+
+void
+HelixSlowReaderTestCase::HandleRead(Ptr<Socket> socket)
+{
+    if (Simulator::Now() < m_pauseEnd)
+    {
+        return;
+    }
+    for (Ptr<Packet> p = socket->Recv(); p; p = socket->Recv())
+    {
+        m_read += p->GetSize();
+    }
+}
+
+void
+HelixSlowReaderTestCase::CwndChange(uint32_t oldValue, uint32_t newValue)
+{
+    if (newValue < oldValue)
+    {
+        m_decreases++;
+    }
+}
+
+void
+HelixSlowReaderTestCase::DoRun()
+{
+    NodeContainer nodes;
+    nodes.Create(2);
+    PointToPointHelper link;
+    link.SetDeviceAttribute("DataRate", StringValue("100Mbps"));
+    link.SetChannelAttribute("Delay", StringValue("1ms"));
+    NetDeviceContainer devices = link.Install(nodes);
+    InternetStackHelper internet;
+    internet.Install(nodes);
+    Ipv4AddressHelper address("10.1.1.0", "255.255.255.0");
+    Ipv4InterfaceContainer interfaces = address.Assign(devices);
+    HelixStackHelper helix;
+    helix.Install(nodes);
+
+    // the receive buffer fills within the first milliseconds
+    Ptr<Socket> sink = Socket::CreateSocket(nodes.Get(1), HelixSocketFactory::GetTypeId());
+    sink->SetAttribute("RcvBufSize", UintegerValue(8192));
+    sink->Bind(InetSocketAddress(Ipv4Address::GetAny(), 9));
+    sink->Listen();
+    sink->SetRecvCallback(MakeCallback(&HelixSlowReaderTestCase::HandleRead, this));
+
+    Ptr<Socket> source = Socket::CreateSocket(nodes.Get(0), HelixSocketFactory::GetTypeId());
+    source->Connect(InetSocketAddress(interfaces.GetAddress(1), 9));
+    source->TraceConnectWithoutContext(
+        "CongestionWindow",
+        MakeCallback(&HelixSlowReaderTestCase::CwndChange, this));
+    TimeValue timeout;
+    source->GetAttribute("RepairTimeout", timeout);
+    UintegerValue rounds;
+    source->GetAttribute("MaxRepairRounds", rounds);
+    Time pause = timeout.Get() * static_cast<int64_t>(rounds.Get() + 4);
+
+    const uint32_t total = 100000;
+    m_pauseEnd = Seconds(1) + pause;
+    Simulator::Schedule(Seconds(1), [source, total]() { source->Send(Create<Packet>(total)); });
+    Simulator::Schedule(m_pauseEnd, &HelixSlowReaderTestCase::HandleRead, this, sink);
+
+    Simulator::Stop(m_pauseEnd + Seconds(5));
+    Simulator::Run();
+    Simulator::Destroy();
+
+    NS_TEST_ASSERT_MSG_EQ(m_read, total, "Bytes lost while the reader paused");
+    NS_TEST_ASSERT_MSG_EQ(m_decreases, 0, "The pause was taken for congestion");
+}
+
 // The TestSuite class names the TestSuite, identifies what type of TestSuite,
 // and enables the TestCases to be run.  Typically, only the constructor for
 // this class must be defined
@@ -76,6 +797,17 @@ HelixTestSuite::HelixTestSuite()
 {
     // TestDuration for TestCase can be QUICK, EXTENSIVE or TAKES_FOREVER
     AddTestCase(new HelixTestCase1, TestCase::QUICK);
+    AddTestCase(new HelixHeaderTestCase, TestCase::QUICK);
+    AddTestCase(new HelixEndPointDemuxTestCase, TestCase::QUICK);
+    AddTestCase(new HelixRedundancyControllerTestCase, TestCase::QUICK);
+    AddTestCase(new HelixCongestionOpsTestCase, TestCase::QUICK);
+    AddTestCase(new HelixTxBufferTestCase, TestCase::QUICK);
+    AddTestCase(new HelixRxBufferTestCase, TestCase::QUICK);
+    AddTestCase(new HelixSocketAttributesTestCase, TestCase::QUICK);
+    AddTestCase(new HelixStackHelperTestCase, TestCase::QUICK);
+    AddTestCase(new HelixSocketLifetimeTestCase, TestCase::QUICK);
+    AddTestCase(new HelixRcvLowatTestCase, TestCase::QUICK);
+    AddTestCase(new HelixSlowReaderTestCase, TestCase::QUICK);
 }
 
 // Do not forget to allocate an instance of this TestSuite